@@ -0,0 +1,116 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  browse_cache.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file browse_cache.cc
+
+#include "browse_cache.h"
+
+// estimated bookkeeping of an entry besides its key and DIDL-Lite
+#define BROWSE_CACHE_ENTRY_OVERHEAD 128
+
+using namespace zmm;
+using namespace std;
+
+BrowseCache::BrowseCache(size_t memoryLimit)
+{
+    this->memoryLimit = memoryLimit;
+    memoryUsage = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+bool BrowseCache::get(const string& key, unsigned long long generation, Result& result)
+{
+    AutoLock lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        misses++;
+        return false;
+    }
+    if (it->second.generation != generation) {
+        remove(it);
+        misses++;
+        return false;
+    }
+    lru.splice(lru.begin(), lru, it->second.pos);
+    result = it->second.result;
+    hits++;
+    return true;
+}
+
+void BrowseCache::put(const string& key, unsigned long long generation, const Result& result)
+{
+    String didl = result.didl;
+    size_t size = key.length() + didl.length() + BROWSE_CACHE_ENTRY_OVERHEAD;
+    if (size > memoryLimit)
+        return;
+
+    AutoLock lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        // a newer result rendered by a concurrent request wins
+        if (it->second.generation > generation)
+            return;
+        remove(it);
+    }
+
+    while (memoryUsage + size > memoryLimit && !lru.empty()) {
+        remove(entries.find(lru.back()));
+        evictions++;
+    }
+
+    lru.push_front(key);
+    Entry& entry = entries[key];
+    entry.result = result;
+    entry.generation = generation;
+    entry.size = size;
+    entry.pos = lru.begin();
+    memoryUsage += size;
+}
+
+void BrowseCache::clear()
+{
+    AutoLock lock(mutex);
+    entries.clear();
+    lru.clear();
+    memoryUsage = 0;
+}
+
+size_t BrowseCache::getEntryCount()
+{
+    AutoLock lock(mutex);
+    return entries.size();
+}
+
+size_t BrowseCache::getMemoryUsage()
+{
+    AutoLock lock(mutex);
+    return memoryUsage;
+}
+
+void BrowseCache::remove(unordered_map<string, Entry>::iterator it)
+{
+    memoryUsage -= it->second.size;
+    lru.erase(it->second.pos);
+    entries.erase(it);
+}
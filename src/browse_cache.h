@@ -0,0 +1,103 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  browse_cache.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file browse_cache.h
+/// \brief Cache of rendered CDS Browse responses.
+
+#ifndef __BROWSE_CACHE_H__
+#define __BROWSE_CACHE_H__
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "zmm/zmmf.h"
+
+/// \brief Cache of the results of Browse actions.
+///
+/// An entry holds the DIDL-Lite of one Browse request together with the
+/// content generation of the storage it was rendered at. Every change of
+/// the content starts a new generation, so an entry is only returned while
+/// the generation is the same, older entries count as misses and are
+/// dropped. The cache is limited by the memory of its entries and evicts
+/// the least recently used ones first.
+class BrowseCache : public zmm::Object
+{
+public:
+    class Result
+    {
+    public:
+        /// \brief the escaped DIDL-Lite of the Result element
+        zmm::String didl;
+        int numberReturned;
+        int totalMatches;
+    };
+
+    /// \param memoryLimit size of the cache in bytes
+    explicit BrowseCache(size_t memoryLimit);
+
+    /// \brief looks up the result of a request
+    /// \return false if there is no result rendered in the generation
+    bool get(const std::string& key, unsigned long long generation, Result& result);
+
+    /// \brief stores the result of a request rendered from objects loaded
+    /// in the generation
+    void put(const std::string& key, unsigned long long generation, const Result& result);
+
+    /// \brief drops all entries
+    void clear();
+
+    unsigned long long getHits() { return hits; }
+    unsigned long long getMisses() { return misses; }
+    unsigned long long getEvictions() { return evictions; }
+    size_t getEntryCount();
+    size_t getMemoryUsage();
+
+private:
+    class Entry
+    {
+    public:
+        Result result;
+        unsigned long long generation;
+        size_t size;
+        std::list<std::string>::iterator pos;
+    };
+
+    using AutoLock = std::lock_guard<std::mutex>;
+
+    void remove(std::unordered_map<std::string, Entry>::iterator it);
+
+    size_t memoryLimit;
+    size_t memoryUsage;
+    std::unordered_map<std::string, Entry> entries;
+    /// keys from the most to the least recently used
+    std::list<std::string> lru;
+    std::mutex mutex;
+
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+    std::atomic<unsigned long long> evictions;
+};
+
+#endif // __BROWSE_CACHE_H__
@@ -39,9 +39,6 @@ using namespace mxml;
 
 CdsObject::CdsObject() : Object()
 {
-    metadata = Ref<Dictionary>(new Dictionary());
-    auxdata = Ref<Dictionary>(new Dictionary());
-    resources = Ref<Array<CdsResource> >(new Array<CdsResource>);
     id = INVALID_OBJECT_ID;
     parentID = INVALID_OBJECT_ID;
     refID = INVALID_OBJECT_ID;
@@ -50,6 +47,9 @@ CdsObject::CdsObject() : Object()
     virt = 0;
     sortPriority = 0;
     objectFlags = OBJECT_FLAG_RESTRICTED;
+    metadataDecoded = false;
+    auxdataDecoded = false;
+    resourcesDecoded = false;
 }
 
 void CdsObject::copyTo(Ref<CdsObject> obj)
@@ -63,12 +63,28 @@ void CdsObject::copyTo(Ref<CdsObject> obj)
     obj->setMTime(mtime);
     obj->setSizeOnDisk(sizeOnDisk);
     obj->setVirtual(virt);
-    obj->setMetadata(metadata->clone());
-    obj->setAuxData(auxdata->clone());
     obj->setFlags(objectFlags);
     obj->setSortPriority(sortPriority);
-    for (int i = 0; i < resources->size(); i++)
-        obj->addResource(resources->get(i)->clone());
+
+    // parts that were not decoded yet are copied in their encoding
+    String metadataCopy, auxdataCopy, resourcesCopy;
+    {
+        std::lock_guard<std::mutex> lock(decodeMutex);
+        metadataCopy = isMetadataLoaded() ? nullptr : metadataSerial;
+        auxdataCopy = isAuxDataLoaded() ? nullptr : auxdataSerial;
+        resourcesCopy = areResourcesLoaded() ? nullptr : resourcesSerial;
+    }
+    obj->setSerializedData(metadataCopy, auxdataCopy, resourcesCopy);
+    if (isMetadataLoaded())
+        obj->setMetadata(metadata->clone());
+    if (isAuxDataLoaded())
+        obj->setAuxData(auxdata->clone());
+    if (areResourcesLoaded()) {
+        Ref<Array<CdsResource> > copy(new Array<CdsResource>(resources->size()));
+        for (int i = 0; i < resources->size(); i++)
+            copy->append(resources->get(i)->clone());
+        obj->setResources(copy);
+    }
 }
 int CdsObject::equals(Ref<CdsObject> obj, bool exactly)
 {
@@ -85,7 +101,7 @@ int CdsObject::equals(Ref<CdsObject> obj, bool exactly)
     if (! resourcesEqual(obj))
         return 0;
     
-    if (! metadata->equals(obj->getMetadata()))
+    if (! getMetadata()->equals(obj->getMetadata()))
         return 0;
     
     if (exactly && !
@@ -93,7 +109,7 @@ int CdsObject::equals(Ref<CdsObject> obj, bool exactly)
          mtime == obj->getMTime() &&
          sizeOnDisk == obj->getSizeOnDisk() &&
          virt == obj->isVirtual() &&
-         auxdata->equals(obj->auxdata) &&
+         getAuxData()->equals(obj->getAuxData()) &&
          objectFlags == obj->getFlags()
         ))
         return 0;
@@ -102,18 +118,81 @@ int CdsObject::equals(Ref<CdsObject> obj, bool exactly)
 
 int CdsObject::resourcesEqual(Ref<CdsObject> obj)
 {
-    if (resources->size() != obj->resources->size())
+    loadResources();
+    Ref<Array<CdsResource> > objResources = obj->getResources();
+    if (resources->size() != objResources->size())
         return 0;
     
     // compare all resources
     for (int i = 0; i < resources->size(); i++)
     {
-        if (! resources->get(i)->equals(obj->resources->get(i)))
+        if (! resources->get(i)->equals(objResources->get(i)))
             return 0;
     }
     return 1;
 }
 
+void CdsObject::setSerializedData(String metadata, String auxdata, String resources)
+{
+    metadataDecoded = false;
+    auxdataDecoded = false;
+    resourcesDecoded = false;
+    this->metadata = nullptr;
+    this->auxdata = nullptr;
+    this->resources = nullptr;
+    metadataSerial = metadata;
+    auxdataSerial = auxdata;
+    resourcesSerial = resources;
+}
+
+size_t CdsObject::getSerializedSize()
+{
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    size_t size = 0;
+    if (!isMetadataLoaded() && metadataSerial != nullptr)
+        size += metadataSerial.length();
+    if (!isAuxDataLoaded() && auxdataSerial != nullptr)
+        size += auxdataSerial.length();
+    if (!areResourcesLoaded() && resourcesSerial != nullptr)
+        size += resourcesSerial.length();
+    return size;
+}
+
+void CdsObject::decodeMetadata()
+{
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    if (isMetadataLoaded())
+        return;
+    Ref<Dictionary> dict(new Dictionary());
+    dict->decodeCompact(metadataSerial);
+    metadataSerial = nullptr;
+    metadata = dict;
+    metadataDecoded.store(true, std::memory_order_release);
+}
+
+void CdsObject::decodeAuxData()
+{
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    if (isAuxDataLoaded())
+        return;
+    Ref<Dictionary> dict(new Dictionary());
+    dict->decodeCompact(auxdataSerial);
+    auxdataSerial = nullptr;
+    auxdata = dict;
+    auxdataDecoded.store(true, std::memory_order_release);
+}
+
+void CdsObject::decodeResources()
+{
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    if (areResourcesLoaded())
+        return;
+    Ref<Array<CdsResource> > list = CdsResource::decodeList(resourcesSerial);
+    resourcesSerial = nullptr;
+    resources = list;
+    resourcesDecoded.store(true, std::memory_order_release);
+}
+
 void CdsObject::validate()
 {
     if (!string_ok(this->title))
@@ -209,6 +288,14 @@ CdsActiveItem::CdsActiveItem() : CdsItem()
 
     upnpClass = _(UPNP_DEFAULT_CLASS_ACTIVE_ITEM);
     mimeType = _(MIMETYPE_DEFAULT);
+    activeDataPending = false;
+}
+
+void CdsActiveItem::setActiveDataLoader(std::function<void(String& action, String& state)> loader)
+{
+    std::lock_guard<std::mutex> lock(activeDataMutex);
+    activeDataLoader = loader;
+    activeDataPending.store(loader != nullptr, std::memory_order_release);
 }
 
 void CdsActiveItem::copyTo(Ref<CdsObject> obj)
@@ -217,14 +304,38 @@ void CdsActiveItem::copyTo(Ref<CdsObject> obj)
     if (! IS_CDS_ACTIVE_ITEM(obj->getObjectType()))
         return;
     Ref<CdsActiveItem> item = RefCast(obj, CdsActiveItem);
+    std::function<void(String& action, String& state)> loader;
+    {
+        std::lock_guard<std::mutex> lock(activeDataMutex);
+        loader = activeDataLoader;
+    }
+    if (loader) {
+        item->setActiveDataLoader(loader);
+        return;
+    }
     item->setAction(action);
     item->setState(state);
 }
+
+void CdsActiveItem::fetchActiveData()
+{
+    // only this item waits for the database, a failed fetch is retried
+    std::lock_guard<std::mutex> lock(activeDataMutex);
+    if (!activeDataPending.load(std::memory_order_relaxed))
+        return;
+    String fetchedAction, fetchedState;
+    activeDataLoader(fetchedAction, fetchedState);
+    action = fetchedAction;
+    state = fetchedState;
+    activeDataLoader = nullptr;
+    activeDataPending.store(false, std::memory_order_release);
+}
 int CdsActiveItem::equals(Ref<CdsObject> obj, bool exactly)
 {
     Ref<CdsActiveItem> item = RefCast(obj, CdsActiveItem);
     if (! CdsItem::equals(obj, exactly))
         return 0;
+    loadActiveData();
     if (exactly &&
        (action != item->getAction() ||
         state != item->getState())
@@ -236,6 +347,7 @@ int CdsActiveItem::equals(Ref<CdsObject> obj, bool exactly)
 void CdsActiveItem::validate()
 {
     CdsItem::validate();
+    loadActiveData();
     if (!string_ok(this->action))
         throw _Exception(_("Active Item validation failed: missing action\n"));
        
@@ -316,6 +428,9 @@ void CdsContainer::validate()
 }
 void CdsObject::optimize()
 {
+    loadMetadata();
+    loadAuxData();
+    loadResources();
     metadata->optimize();
     auxdata->optimize();
     resources->optimize();
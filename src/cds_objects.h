@@ -32,6 +32,9 @@
 #ifndef __CDS_OBJECTS_H__
 #define __CDS_OBJECTS_H__
 
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <sys/types.h>
 
 #include "common.h"
@@ -115,10 +118,38 @@ protected:
     /// \brief flag that allows to sort objects within a container
     int sortPriority;
 
+    /// \brief nullptr until they are set or decoded, objects loaded from
+    /// the database only allocate what is accessed
     zmm::Ref<Dictionary> metadata;
     zmm::Ref<Dictionary> auxdata;
     zmm::Ref<zmm::Array<CdsResource> > resources;
-    
+
+    /// \brief metadata, auxdata and resources as read from the database,
+    /// they are decoded on first access
+    zmm::String metadataSerial;
+    zmm::String auxdataSerial;
+    zmm::String resourcesSerial;
+
+    /// \brief set once the part above is decoded, it is published with
+    /// release semantics so the decoded part can be read without a lock
+    std::atomic<bool> metadataDecoded;
+    std::atomic<bool> auxdataDecoded;
+    std::atomic<bool> resourcesDecoded;
+
+    /// \brief serializes decoding of this object, cached objects are
+    /// shared between threads
+    std::mutex decodeMutex;
+
+    void decodeMetadata();
+    void decodeAuxData();
+    void decodeResources();
+
+    inline void loadMetadata()
+    { if (!metadataDecoded.load(std::memory_order_acquire)) decodeMetadata(); }
+    inline void loadAuxData()
+    { if (!auxdataDecoded.load(std::memory_order_acquire)) decodeAuxData(); }
+    inline void loadResources()
+    { if (!resourcesDecoded.load(std::memory_order_acquire)) decodeResources(); }
 
 public:
     /// \brief Constructor. Sets the default values.
@@ -223,66 +254,77 @@ public:
     
     /// \brief Query single metadata value.
     inline zmm::String getMetadata(zmm::String key)
-    { return metadata->get(key); }
+    { loadMetadata(); return metadata->get(key); }
 
     /// \brief Query entire metadata dictionary.
-    inline zmm::Ref<Dictionary> getMetadata() { return metadata; }
+    inline zmm::Ref<Dictionary> getMetadata() { loadMetadata(); return metadata; }
     
     /// \brief Set entire metadata dictionary.
     inline void setMetadata(zmm::Ref<Dictionary> metadata)
-    { this->metadata = metadata; }
+    { metadataSerial = nullptr; this->metadata = metadata; metadataDecoded.store(true, std::memory_order_release); }
 
     /// \brief Set a single metadata value.
     inline void setMetadata(zmm::String key, zmm::String value)
-    { metadata->put(key, value); }
+    { loadMetadata(); metadata->put(key, value); }
 
     /// \brief Removes metadata with the given key
     inline void removeMetadata(zmm::String key)
-    { metadata->remove(key); }
+    { loadMetadata(); metadata->remove(key); }
     
 
     /// \brief Query single auxdata value.
     inline zmm::String getAuxData(zmm::String key)
-    { return auxdata->get(key); }
+    { loadAuxData(); return auxdata->get(key); }
 
     /// \brief Query entire auxdata dictionary.
-    inline zmm::Ref<Dictionary> getAuxData() { return auxdata; }
+    inline zmm::Ref<Dictionary> getAuxData() { loadAuxData(); return auxdata; }
 
     /// \brief Set a single auxdata value.
     inline void setAuxData(zmm::String key, zmm::String value)
-    { auxdata->put(key, value); }
+    { loadAuxData(); auxdata->put(key, value); }
     
     /// \brief Set entire auxdata dictionary.
     inline void setAuxData(zmm::Ref<Dictionary> auxdata)
-    { this->auxdata = auxdata; }
+    { auxdataSerial = nullptr; this->auxdata = auxdata; auxdataDecoded.store(true, std::memory_order_release); }
 
     /// \brief Removes auxdata with the given key
     inline void removeAuxData(zmm::String key)
-    { auxdata->remove(key); }
+    { loadAuxData(); auxdata->remove(key); }
     
     
     /// \brief Get number of resource tags
-    inline int getResourceCount() { return resources->size(); }
+    inline int getResourceCount() { loadResources(); return resources->size(); }
 
     /// \brief Query resources
     inline zmm::Ref<zmm::Array<CdsResource> > getResources()
-    { return resources; }
+    { loadResources(); return resources; }
  
     /// \brief Set resources
     inline void setResources(zmm::Ref<zmm::Array<CdsResource> > res) 
-    { resources = res; }
+    { resourcesSerial = nullptr; resources = res; resourcesDecoded.store(true, std::memory_order_release); }
     
     /// \brief Query resource tag with the given index
     inline zmm::Ref<CdsResource> getResource(int index)
-    { return resources->get(index); }
+    { loadResources(); return resources->get(index); }
     
     /// \brief Add resource tag
     inline void addResource(zmm::Ref<CdsResource> resource)
-    { resources->append(resource); } 
+    { loadResources(); resources->append(resource); } 
   
     /// \brief Insert resource tag at index
     inline void insertResource(int index, zmm::Ref<CdsResource> resource)
-    { resources->insert(index, resource); }
+    { loadResources(); resources->insert(index, resource); }
+
+    /// \brief Set metadata, auxdata and resources as they are stored in
+    /// the database, either of them is decoded when it is accessed first.
+    void setSerializedData(zmm::String metadata, zmm::String auxdata, zmm::String resources);
+
+    /// \brief length of the parts that are still in their database encoding
+    size_t getSerializedSize();
+
+    inline bool isMetadataLoaded() { return metadataDecoded.load(std::memory_order_acquire); }
+    inline bool isAuxDataLoaded() { return auxdataDecoded.load(std::memory_order_acquire); }
+    inline bool areResourcesLoaded() { return resourcesDecoded.load(std::memory_order_acquire); }
 
     /// \brief Copies all object properties to another object.
     /// \param obj target object (clone)
@@ -396,6 +438,19 @@ protected:
 
     /// \brief a field where you can save any string you wnat.
     zmm::String state;
+
+    /// \brief fetches action and state of an item loaded from the
+    /// database, it is dropped after the first successful call
+    std::function<void(zmm::String& action, zmm::String& state)> activeDataLoader;
+
+    /// \brief set while the loader has not run, the fetch is serialized
+    /// per item by activeDataMutex
+    std::atomic<bool> activeDataPending;
+    std::mutex activeDataMutex;
+
+    void fetchActiveData();
+    inline void loadActiveData()
+    { if (activeDataPending.load(std::memory_order_acquire)) fetchActiveData(); }
 public:
 
     /// \brief Constructor, sets the object type.
@@ -403,20 +458,23 @@ public:
 
     /// \brief Sets the action for the item.
     /// \param action absolute path to the script that will process the XML data.
-    inline void setAction(zmm::String action) { this->action = action; }
+    inline void setAction(zmm::String action) { loadActiveData(); this->action = action; }
 
     /// \brief Get the path of the action script.
-    inline zmm::String getAction() { return action; }
+    inline zmm::String getAction() { loadActiveData(); return action; }
 
     /// \brief Set action state.
     /// \param state any string you want.
     ///
     /// This is quite useful to let the script identify what state the item is in.
     /// Think of it as a cookie (did I already mention that I hate web cookies?)
-    inline void setState(zmm::String state) { this->state = state; }
+    inline void setState(zmm::String state) { loadActiveData(); this->state = state; }
 
     /// \brief Retrieve the item state.
-    inline zmm::String getState() { return state; }
+    inline zmm::String getState() { loadActiveData(); return state; }
+
+    /// \brief Lets action and state be fetched when they are accessed first.
+    void setActiveDataLoader(std::function<void(zmm::String& action, zmm::String& state)> loader);
 
     /// \brief Copies all object properties to another object.
     /// \param obj target object (clone)
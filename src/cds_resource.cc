@@ -29,10 +29,13 @@
 
 /// \file cds_resource.cc
 
+#include <cstring>
+
 #include "tools.h"
 #include "cds_resource.h"
 
 #define RESOURCE_PART_SEP '~'
+#define RESOURCE_SEP '|'
 
 using namespace zmm;
 
@@ -174,6 +177,75 @@ Ref<CdsResource> CdsResource::decode(String serial)
     return resource;
 }
 
+void CdsResource::encodeCompact(Ref<StringBuffer> buf)
+{
+    Dictionary::compactAppend(buf, handlerType);
+    attributes->encodeCompact(buf);
+    parameters->encodeCompact(buf);
+    options->encodeCompact(buf);
+}
+
+Ref<CdsResource> CdsResource::decodeCompact(const char **data, const char *end)
+{
+    int handlerType;
+    if (!Dictionary::compactReadInt(data, end, &handlerType))
+        return nullptr;
+
+    Ref<Dictionary> attr(new Dictionary());
+    Ref<Dictionary> par(new Dictionary());
+    Ref<Dictionary> opt(new Dictionary());
+    if (!attr->decodeCompact(data, end)
+        || !par->decodeCompact(data, end)
+        || !opt->decodeCompact(data, end))
+        return nullptr;
+
+    return Ref<CdsResource>(new CdsResource(handlerType, attr, par, opt));
+}
+
+// <count>:<resource>...
+String CdsResource::encodeList(Ref<Array<CdsResource> > resources)
+{
+    int len = resources->size();
+    if (len == 0)
+        return nullptr;
+
+    Ref<StringBuffer> buf(new StringBuffer());
+    *buf << DICTIONARY_COMPACT_PREFIX;
+    Dictionary::compactAppend(buf, len);
+    for (int i = 0; i < len; i++)
+        resources->get(i)->encodeCompact(buf);
+    return buf->toString();
+}
+
+Ref<Array<CdsResource> > CdsResource::decodeList(String serial)
+{
+    Ref<Array<CdsResource> > resources(new Array<CdsResource>());
+    if (!string_ok(serial))
+        return resources;
+
+    if (!serial.startsWith(_(DICTIONARY_COMPACT_PREFIX)))
+    {
+        Ref<Array<StringBase> > parts = split_string(serial, RESOURCE_SEP);
+        for (int i = 0; i < parts->size(); i++)
+            resources->append(decode(parts->get(i)));
+        return resources;
+    }
+
+    const char *data = serial.c_str() + strlen(DICTIONARY_COMPACT_PREFIX);
+    const char *end = serial.c_str() + serial.length();
+    int count;
+    if (!Dictionary::compactReadInt(&data, end, &count))
+        throw _Exception(_("CdsResource::decodeList: Could not parse resources"));
+    for (int i = 0; i < count; i++)
+    {
+        Ref<CdsResource> resource = decodeCompact(&data, end);
+        if (resource == nullptr)
+            throw _Exception(_("CdsResource::decodeList: Could not parse resources"));
+        resources->append(resource);
+    }
+    return resources;
+}
+
 void CdsResource::optimize()
 {
     attributes->optimize();
@@ -113,6 +113,21 @@ public:
     zmm::String encode();
     static zmm::Ref<CdsResource> decode(zmm::String serial);
 
+    /// \brief Appends the compact encoding of the resource.
+    void encodeCompact(zmm::Ref<zmm::StringBuffer> buf);
+
+    /// \brief Reads a compact encoded resource starting at data, returns
+    /// nullptr if the data is malformed.
+    static zmm::Ref<CdsResource> decodeCompact(const char **data, const char *end);
+
+    /// \brief Encodes all resources of an object for storage, returns
+    /// nullptr if there are none.
+    static zmm::String encodeList(zmm::Ref<zmm::Array<CdsResource> > resources);
+
+    /// \brief Decodes the resources of an object, either compact or url
+    /// encoded.
+    static zmm::Ref<zmm::Array<CdsResource> > decodeList(zmm::String serial);
+
     /// \brief Frees unnecessary memory
     void optimize();
 };
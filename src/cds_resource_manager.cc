@@ -31,6 +31,7 @@
 
 #include "cds_resource_manager.h"
 #include "dictionary.h"
+#include "didl_writer.h"
 #include "object_dictionary.h"
 #include "server.h"
 #include "common.h"
@@ -76,20 +77,113 @@ String CdsResourceManager::renderExtension(String contentType, String location)
 
 void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
 {
-    Ref<UrlBase> urlBase = addResources_getUrlBase(item);
-    Ref<ConfigManager> config = ConfigManager::getInstance();
+    renderResources(item, element, nullptr);
+}
+
+void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<DIDLWriter> writer)
+{
+    renderResources(item, nullptr, writer);
+}
+
+Ref<CdsResourceManager::ResourcePlans> CdsResourceManager::resourcePlans;
+std::mutex CdsResourceManager::resourcePlansMutex;
+
+CdsResourceManager::ResourcePlans::ResourcePlans(std::shared_ptr<const ConfigSnapshot> config)
+    : config(config)
+{
+    String virtualURL = Server::getInstance()->getVirtualURL();
+    mediaURL = virtualURL + _(_URL_PARAM_SEPARATOR) + CONTENT_MEDIA_HANDLER + _(_URL_PARAM_SEPARATOR);
+    onlineURL = virtualURL + _(_URL_PARAM_SEPARATOR) + CONTENT_ONLINE_HANDLER + _(_URL_PARAM_SEPARATOR);
+    serveURL = virtualURL + _(_URL_PARAM_SEPARATOR) + CONTENT_SERVE_HANDLER + _(_URL_PARAM_SEPARATOR);
+
+    String thumbMimeType = config->mimetypeContentType->get(_(CONTENT_TYPE_JPG));
+    if (!string_ok(thumbMimeType))
+        thumbMimeType = _("image/jpeg");
+    thumbnailProtocolInfo = renderProtocolInfo(thumbMimeType);
+}
+
+Ref<CdsResourceManager::ResourcePlan> CdsResourceManager::ResourcePlans::get(String mimeType)
+{
+    std::string key(string_ok(mimeType) ? mimeType.c_str() : "");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = plans.find(key);
+        if (it != plans.end())
+            return it->second;
+    }
+
+    Ref<ResourcePlan> plan(new ResourcePlan());
+    plan->contentType = config->mimetypeContentType->get(mimeType);
+    plan->extension = renderExtension(plan->contentType, nullptr);
+    plan->audio = mimeType.startsWith(_("audio"));
+    plan->video = mimeType.startsWith(_("video"));
+#ifdef EXTEND_PROTOCOLINFO
+    if (plan->contentType == CONTENT_TYPE_MP3)
+        plan->dlnaProfile = _(D_PROFILE) + "=" + D_MP3 + ";";
+    else if (plan->contentType == CONTENT_TYPE_PCM)
+        plan->dlnaProfile = _(D_PROFILE) + "=" + D_LPCM + ";";
+#endif
+
+    Ref<ObjectDictionary<TranscodingProfile> > tp_mt = config->transcodingProfiles->get(mimeType);
+    plan->transcoding = (tp_mt != nullptr);
+    if (tp_mt != nullptr) {
+        Ref<Array<ObjectDictionaryElement<TranscodingProfile> > > profiles = tp_mt->getElements();
+        for (int p = 0; p < profiles->size(); p++) {
+            Ref<TranscodingProfile> tp = profiles->get(p)->getValue();
+            if (tp == nullptr)
+                throw _Exception(_("Invalid profile encountered!"));
+
+            ProfilePlan profilePlan;
+            profilePlan.profile = tp;
+            // without values of the item the protocolInfo is always the same
+            if (tp->isThumbnail() || (tp->getSampleFreq() != SOURCE && tp->getNumChannels() != SOURCE)) {
+                String targetMimeType = tp->getTargetMimeType();
+                if (!tp->isThumbnail()) {
+                    if (tp->getSampleFreq() != OFF)
+                        targetMimeType = targetMimeType + _(";rate=") + String::from(tp->getSampleFreq());
+                    if (tp->getNumChannels() != OFF)
+                        targetMimeType = targetMimeType + _(";channels=") + String::from(tp->getNumChannels());
+                }
+                profilePlan.protocolInfo = renderProtocolInfo(targetMimeType);
+            }
+
+            // Ogg profiles are either for Theora or for Vorbis
+            for (int theora = 0; theora < 2; theora++) {
+                if (plan->contentType == CONTENT_TYPE_OGG && (theora == 1) != tp->isTheora())
+                    continue;
+                plan->profiles[theora].push_back(profilePlan);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    plans[key] = plan;
+    return plan;
+}
+
+Ref<CdsResourceManager::ResourcePlans> CdsResourceManager::getPlans()
+{
+    std::shared_ptr<const ConfigSnapshot> config = ConfigManager::getSnapshot();
+    std::lock_guard<std::mutex> lock(resourcePlansMutex);
+    if (resourcePlans == nullptr || resourcePlans->config != config)
+        resourcePlans = Ref<ResourcePlans>(new ResourcePlans(config));
+    return resourcePlans;
+}
+
+void CdsResourceManager::renderResources(Ref<CdsItem> item, Ref<Element> element, Ref<DIDLWriter> writer)
+{
+    Ref<ResourcePlans> plans = getPlans();
+    Ref<UrlBase> urlBase = addResources_getUrlBase(item, false, plans);
     bool skipURL = ((IS_CDS_ITEM_INTERNAL_URL(item->getObjectType()) || 
                     IS_CDS_ITEM_EXTERNAL_URL(item->getObjectType())) &&
                     (!item->getFlag(OBJECT_FLAG_PROXY_URL)));
 
     bool isExtThumbnail = false; // this sucks
-    Ref<Dictionary> mappings = config->getDictionaryOption(
-                        CFG_IMPORT_MAPPINGS_MIMETYPE_TO_CONTENTTYPE_LIST);
+    bool theora = item->getFlag(OBJECT_FLAG_OGG_THEORA);
+    Ref<ResourcePlan> itemPlan = plans->get(item->getMimeType());
 
 #if defined(HAVE_FFMPEG) && defined(HAVE_FFMPEGTHUMBNAILER)
-    if (config->getBoolOption(CFG_SERVER_EXTOPTS_FFMPEGTHUMBNAILER_ENABLED) && 
-       (item->getMimeType().startsWith(_("video")) || 
-        item->getFlag(OBJECT_FLAG_OGG_THEORA)))
+    if (plans->config->ffmpegThumbnailer && (itemPlan->video || theora))
     {
         String videoresolution = item->getResource(0)->getAttribute(MetadataHandler::getResAttrName(R_RESOLUTION));
         int x;
@@ -98,18 +192,14 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
         if (string_ok(videoresolution) && 
             check_resolution(videoresolution, &x, &y))
         {
-            String thumb_mimetype = mappings->get(_(CONTENT_TYPE_JPG));
-            if (!string_ok(thumb_mimetype))
-                thumb_mimetype = _("image/jpeg");
-
             Ref<CdsResource> ffres(new CdsResource(CH_FFTH));
             ffres->addParameter(_(RESOURCE_HANDLER), String::from(CH_FFTH));
             ffres->addAttribute(MetadataHandler::getResAttrName(R_PROTOCOLINFO),
-                    renderProtocolInfo(thumb_mimetype));
+                    plans->thumbnailProtocolInfo);
             ffres->addOption(_(RESOURCE_CONTENT_TYPE), _(THUMBNAIL));
 
-            y = config->getIntOption(CFG_SERVER_EXTOPTS_FFMPEGTHUMBNAILER_THUMBSIZE) * y / x;
-            x = config->getIntOption(CFG_SERVER_EXTOPTS_FFMPEGTHUMBNAILER_THUMBSIZE);
+            y = plans->config->ffmpegThumbnailerSize * y / x;
+            x = plans->config->ffmpegThumbnailerSize;
             String resolution = String::from(x) + "x" + String::from(y);
             ffres->addAttribute(MetadataHandler::getResAttrName(R_RESOLUTION),
                     resolution);
@@ -132,33 +222,15 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
     //
     // TODO: allow transcoding for URLs
         
-    // now get the profile
-    Ref<TranscodingProfileList> tlist = config->getTranscodingProfileListOption(
-            CFG_TRANSCODING_PROFILE_LIST);
-    Ref<ObjectDictionary<TranscodingProfile> > tp_mt = tlist->get(item->getMimeType());
-    if (tp_mt != nullptr)
+    // the profiles that apply to the mimetype were picked in advance
+    if (itemPlan->transcoding)
     {
-        Ref<Array<ObjectDictionaryElement<TranscodingProfile> > > profiles = tp_mt->getElements();
-        for (int p = 0; p < profiles->size(); p++)
+        for (const ProfilePlan& profilePlan : itemPlan->profiles[theora ? 1 : 0])
         {
-            Ref<TranscodingProfile> tp = profiles->get(p)->getValue();
-
-            if (tp == nullptr)
-                throw _Exception(_("Invalid profile encountered!"));
+            Ref<TranscodingProfile> tp = profilePlan.profile;
 
-            String ct = mappings->get(item->getMimeType());
-            if (ct == CONTENT_TYPE_OGG) 
-            {
-                if (((item->getFlag(OBJECT_FLAG_OGG_THEORA)) && 
-                     (!tp->isTheora())) ||
-                    (!item->getFlag(OBJECT_FLAG_OGG_THEORA) && 
-                    (tp->isTheora())))
-                     {
-                         continue;
-                     }
-            }
             // check user fourcc settings
-            else if (ct == CONTENT_TYPE_AVI)
+            if (itemPlan->contentType == CONTENT_TYPE_AVI)
             {
                 avi_fourcc_listmode_t fcc_mode = tp->getAVIFourCCListMode();
 
@@ -254,8 +326,11 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
                 }
             }
 
+            String protocolInfo = profilePlan.protocolInfo;
+            if (protocolInfo == nullptr)
+                protocolInfo = renderProtocolInfo(targetMimeType);
             t_res->addAttribute(MetadataHandler::getResAttrName(R_PROTOCOLINFO),
-                    renderProtocolInfo(targetMimeType));
+                    protocolInfo);
 
             if (tp->isThumbnail())
                 t_res->addOption(_(RESOURCE_CONTENT_TYPE), _(EXIF_THUMBNAIL));
@@ -275,7 +350,7 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
         }
 
         if (skipURL)
-            urlBase_tr = addResources_getUrlBase(item, true);
+            urlBase_tr = addResources_getUrlBase(item, true, plans);
     }
 
     int resCount = item->getResourceCount();
@@ -298,7 +373,8 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
         }
 
         assert(string_ok(mimeType));
-        String contentType = mappings->get(mimeType);
+        Ref<ResourcePlan> plan = (mimeType == item->getMimeType()) ? itemPlan : plans->get(mimeType);
+        String contentType = plan->contentType;
         String url;
 
         /// \todo who will sync mimetype that is part of the protocol info and
@@ -372,17 +448,23 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
                 else
                     rct = res->getParameter(_(RESOURCE_CONTENT_TYPE));
                 if (rct == ID3_ALBUM_ART) {
+                    bool dlnaProfile = false;
+#ifdef EXTEND_PROTOCOLINFO
+                    /// \todo clean this up, make sure to check the mimetype and
+                    /// provide the profile correctly
+                    dlnaProfile = plans->config->extendProtocolInfo;
+#endif
+                    if (writer != nullptr) {
+                        writer->writeAlbumArtURI(url, dlnaProfile);
+                        continue;
+                    }
                     Ref<Element> aa(new Element(MetadataHandler::getMetaFieldName(M_ALBUMARTURI)));
                     aa->setText(url);
-#ifdef EXTEND_PROTOCOLINFO
-                    if (config->getBoolOption(CFG_SERVER_EXTEND_PROTOCOLINFO)) {
-                        /// \todo clean this up, make sure to check the mimetype and
-                        /// provide the profile correctly
+                    if (dlnaProfile) {
                         aa->setAttribute(_("xmlns:dlna"),
                                          _("urn:schemas-dlna-org:metadata-1-0"));
                         aa->setAttribute(_("dlna:profileID"), _("JPEG_TN"));
                     }
-#endif
                     element->appendElementChild(aa);
                     continue;
                 }
@@ -397,21 +479,17 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
             // first resource
             if (!skipURL)
             {
-                if (transcoded)
-                    url = url + renderExtension(contentType, nullptr);
+                if (transcoded || plan->extension != nullptr)
+                    url = url + plan->extension;
                 else
                     url = url + renderExtension(contentType, item->getLocation()); 
             }
         }
 #ifdef EXTEND_PROTOCOLINFO
-        if (config->getBoolOption(CFG_SERVER_EXTEND_PROTOCOLINFO))
+        if (plans->config->extendProtocolInfo)
         {
-            String extend;
-            if (contentType == CONTENT_TYPE_MP3)
-                extend = _(D_PROFILE) + "=" + D_MP3 + ";";
-            else if (contentType == CONTENT_TYPE_PCM)
-                extend = _(D_PROFILE) + "=" + D_LPCM + ";";
-            else if (contentType == CONTENT_TYPE_JPG)
+            String extend = plan->dlnaProfile;
+            if (contentType == CONTENT_TYPE_JPG)
             {
                 String resolution = res_attrs->get(MetadataHandler::getResAttrName(R_RESOLUTION));
                 int x;
@@ -446,8 +524,7 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
             extend = extend + D_OP + "=10;" +
                      D_CONVERSION_INDICATOR + "=" D_CONVERSION;
 
-            if (mimeType.startsWith(_("audio")) || 
-                mimeType.startsWith(_("video")))
+            if (plan->audio || plan->video)
                 extend = extend + ";" D_FLAGS "=" D_TR_FLAGS_AV;
         }
         else
@@ -459,11 +536,14 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
         res_attrs->put(MetadataHandler::getResAttrName(R_PROTOCOLINFO),
                        protocolInfo);
 
-        if (config->getBoolOption(CFG_SERVER_EXTEND_PROTOCOLINFO_SM_HACK))
+        if (plans->config->samsungHack)
         {
-            if (mimeType.startsWith(_("video")))
+            if (plan->video)
             {
-                element->appendElementChild(UpnpXML_DIDLRenderCaptionInfo(url));
+                if (writer != nullptr)
+                    writer->writeCaptionInfo(url);
+                else
+                    element->appendElementChild(UpnpXML_DIDLRenderCaptionInfo(url));
             }
         }
 
@@ -472,19 +552,27 @@ void CdsResourceManager::addResources(Ref<CdsItem> item, Ref<Element> element)
 #endif
         if (!hide_original_resource || transcoded || 
            (hide_original_resource && (original_resource != i)))
-            element->appendElementChild(UpnpXML_DIDLRenderResource(url, res_attrs));
+        {
+            if (writer != nullptr)
+                writer->writeResource(url, res_attrs);
+            else
+                element->appendElementChild(UpnpXML_DIDLRenderResource(url, res_attrs));
+        }
     }
 }
 
-Ref<CdsResourceManager::UrlBase> CdsResourceManager::addResources_getUrlBase(Ref<CdsItem> item, bool forceLocal)
+Ref<CdsResourceManager::UrlBase> CdsResourceManager::addResources_getUrlBase(Ref<CdsItem> item, bool forceLocal, Ref<ResourcePlans> plans)
 {
-    Ref<Element> res;
+    if (plans == nullptr)
+        plans = getPlans();
 
     Ref<UrlBase> urlBase(new UrlBase);
     /// \todo resource options must be read from configuration files
 
-    Ref<Dictionary> dict(new Dictionary());
-    dict->put(_(URL_OBJECT_ID), String::from(item->getID()));
+    // same as encodeSimple() of a dictionary with the object ID
+    String objectResource = _(URL_OBJECT_ID) + _(_URL_PARAM_SEPARATOR) +
+                            item->getID() + _(_URL_PARAM_SEPARATOR) +
+                            _(URL_RESOURCE_ID) + _(_URL_PARAM_SEPARATOR);
 
     urlBase->addResID = false;
     /// \todo move this down into the "for" loop and create different urls 
@@ -492,10 +580,7 @@ Ref<CdsResourceManager::UrlBase> CdsResourceManager::addResources_getUrlBase(Ref
     int objectType = item->getObjectType();
     if (IS_CDS_ITEM_INTERNAL_URL(objectType))
     {
-        urlBase->urlBase = Server::getInstance()->getVirtualURL() + 
-                           _(_URL_PARAM_SEPARATOR) + 
-                           CONTENT_SERVE_HANDLER + 
-                           _(_URL_PARAM_SEPARATOR) + item->getLocation();
+        urlBase->urlBase = plans->serveURL + item->getLocation();
         return urlBase;
     }
 
@@ -510,21 +595,13 @@ Ref<CdsResourceManager::UrlBase> CdsResourceManager::addResources_getUrlBase(Ref
         if ((item->getFlag(OBJECT_FLAG_ONLINE_SERVICE) && 
                 item->getFlag(OBJECT_FLAG_PROXY_URL)) || forceLocal)
         {
-            urlBase->urlBase = Server::getInstance()->getVirtualURL() + 
-                _(_URL_PARAM_SEPARATOR) +
-                CONTENT_ONLINE_HANDLER + _(_URL_PARAM_SEPARATOR) +
-                dict->encodeSimple() + _(_URL_PARAM_SEPARATOR) +
-                _(URL_RESOURCE_ID) + _(_URL_PARAM_SEPARATOR);
+            urlBase->urlBase = plans->onlineURL + objectResource;
             urlBase->addResID = true;
             return urlBase;
         }
     }
 
-    urlBase->urlBase = Server::getInstance()->getVirtualURL() +
-                       _(_URL_PARAM_SEPARATOR) +
-                       CONTENT_MEDIA_HANDLER + _(_URL_PARAM_SEPARATOR) + 
-                       dict->encodeSimple() + _(_URL_PARAM_SEPARATOR) + 
-                       _(URL_RESOURCE_ID) + _(_URL_PARAM_SEPARATOR);
+    urlBase->urlBase = plans->mediaURL + objectResource;
     urlBase->addResID = true;
     return urlBase;
 }
@@ -32,11 +32,21 @@
 #ifndef __CDS_RESOURCE_MANAGER_H__
 #define __CDS_RESOURCE_MANAGER_H__
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "singleton.h"
 #include "mxml/mxml.h"
 #include "common.h"
 #include "cds_objects.h"
+#include "config_manager.h"
+#include "dictionary.h"
 #include "strings.h"
+#include "transcoding/transcoding.h"
+
+class DIDLWriter;
 
 /// \brief This class is responsible for handling the DIDL-Lite res tags.
 class CdsResourceManager : public zmm::Object
@@ -55,6 +65,9 @@ public:
     /// function would do it. Also, when transcoding will be implemented, the
     /// various transcoded streams will be identified here.
     static void addResources(zmm::Ref<CdsItem> item, zmm::Ref<mxml::Element> element);
+
+    /// \brief Writes the resource tags of the item, like addResources() above.
+    static void addResources(zmm::Ref<CdsItem> item, zmm::Ref<DIDLWriter> writer);
     
     /// \brief Gets the URL of the first resource of the CfsItem.
     /// \param item Item for which the resources should be built.
@@ -67,6 +80,71 @@ public:
     static zmm::String getArtworkUrl(zmm::Ref<CdsItem> item);
 
 protected:
+    /// \brief a transcoding profile that applies to a mimetype
+    class ProfilePlan
+    {
+    public:
+        zmm::Ref<TranscodingProfile> profile;
+        /// protocolInfo of the transcoded resource, nullptr if it takes
+        /// the sample frequency or the channels from the item
+        zmm::String protocolInfo;
+    };
+
+    /// \brief everything about the resources of a mimetype that only
+    /// depends on the configuration
+    class ResourcePlan : public zmm::Object
+    {
+    public:
+        zmm::String contentType;
+        /// ext parameter of the URL, nullptr if the content type does not
+        /// give one and the location has to be used
+        zmm::String extension;
+        bool audio;
+        bool video;
+        /// the mimetype has a transcoding profile list, even if no profile
+        /// is left for an item
+        bool transcoding;
+        /// profiles for items without and with OBJECT_FLAG_OGG_THEORA
+        std::vector<ProfilePlan> profiles[2];
+#ifdef EXTEND_PROTOCOLINFO
+        /// DLNA profile of the content type, nullptr if there is none
+        zmm::String dlnaProfile;
+#endif
+    };
+
+    /// \brief The plans for the mimetypes seen so far, compiled from one
+    /// configuration snapshot.
+    class ResourcePlans : public zmm::Object
+    {
+    public:
+        explicit ResourcePlans(std::shared_ptr<const ConfigSnapshot> config);
+
+        /// \brief returns the plan of a mimetype, compiling it on first use
+        zmm::Ref<ResourcePlan> get(zmm::String mimeType);
+
+        std::shared_ptr<const ConfigSnapshot> config;
+
+        /* beginnings of the resource URLs */
+        zmm::String mediaURL;
+        zmm::String onlineURL;
+        zmm::String serveURL;
+
+        zmm::String thumbnailProtocolInfo;
+
+    protected:
+        std::unordered_map<std::string, zmm::Ref<ResourcePlan> > plans;
+        std::mutex mutex;
+    };
+
+    /// \brief returns the plans of the current configuration snapshot,
+    /// they are compiled again once a new snapshot is published
+    static zmm::Ref<ResourcePlans> getPlans();
+    static zmm::Ref<ResourcePlans> resourcePlans;
+    static std::mutex resourcePlansMutex;
+
+    /// \brief the resources go either to the element or to the writer
+    static void renderResources(zmm::Ref<CdsItem> item, zmm::Ref<mxml::Element> element, zmm::Ref<DIDLWriter> writer);
+
     class UrlBase : public zmm::Object
     {
         public:
@@ -80,7 +158,7 @@ protected:
     /// This function gets the baseUrl for the CdsItem and sets addResID
     /// to true if the resource id needs to be added to the URL.
     static zmm::Ref<UrlBase> addResources_getUrlBase(zmm::Ref<CdsItem> item,
-            bool forceLocal = false);
+            bool forceLocal = false, zmm::Ref<ResourcePlans> plans = nullptr);
    
     /// \brief renders an ext=.extension string, where the extension is 
     /// determined either from content type or from the filename
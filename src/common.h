@@ -48,6 +48,9 @@
 /// \brief UPnP specific error code.
 #define UPNP_E_NO_SUCH_ID               701
 #define UPNP_E_NOT_EXIST                706
+#define UPNP_E_INVALID_SEARCH_CRITERIA  708
+#define UPNP_E_INVALID_SORT_CRITERIA    709
+#define UPNP_E_NO_SUCH_CONTAINER        710
 
 // UPnP default classes
 #define UPNP_DEFAULT_CLASS_CONTAINER    "object.container"
@@ -222,6 +225,8 @@
 #define DEFAULT_JS_DIR                  "js"
 #define DEFAULT_HIDDEN_FILES_VALUE      NO
 #define DEFAULT_UPNP_STRING_LIMIT       (-1)
+#define DEFAULT_UPNP_BROWSE_CACHE_MEMORY 8 // MB
+#define DEFAULT_UPNP_FRAGMENT_CACHE_MEMORY 16 // MB
 #define DEFAULT_SESSION_TIMEOUT         30
 #define SESSION_TIMEOUT_CHECK_INTERVAL  (5 * 60)
 #define DEFAULT_PRES_URL_APPENDTO_ATTR  "none"
@@ -263,11 +268,19 @@
 
     #define URL_VALUE_TRANSCODE              "1"
 #define DEFAULT_STORAGE_CACHING_ENABLED YES
+#define DEFAULT_STORAGE_CACHE_MEMORY    64 // MB
+#define DEFAULT_STORAGE_QUERY_STATS_ENABLED YES
+#define DEFAULT_STORAGE_SLOW_QUERY      200 // ms
 #ifdef HAVE_SQLITE3
     #define MT_SQLITE_SYNC_FULL            2
     #define MT_SQLITE_SYNC_NORMAL          1 
     #define MT_SQLITE_SYNC_OFF             0
     #define DEFAULT_SQLITE_SYNC         "off"
+    #define DEFAULT_SQLITE_JOURNAL_MODE "wal"
+    #define DEFAULT_SQLITE_READERS      2
+    #define DEFAULT_SQLITE_GROUP_COMMIT_ENABLED YES
+    #define DEFAULT_SQLITE_GROUP_COMMIT_STATEMENTS 1000
+    #define DEFAULT_SQLITE_GROUP_COMMIT_DELAY 500 // ms
     #define DEFAULT_SQLITE_RESTORE      "restore"
     #define DEFAULT_SQLITE_BACKUP_ENABLED NO
     #define DEFAULT_SQLITE_BACKUP_INTERVAL 600
@@ -282,6 +295,7 @@
     #define DEFAULT_MYSQL_HOST          "localhost"
     #define DEFAULT_MYSQL_DB            "gerbera"
     #define DEFAULT_MYSQL_USER          "gerbera"
+    #define DEFAULT_MYSQL_READERS       4
 #ifdef HAVE_SQLITE3
     #define DEFAULT_MYSQL_ENABLED       NO
 #else
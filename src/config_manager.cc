@@ -69,6 +69,7 @@ bool ConfigManager::debug_logging = false;
 String ConfigManager::ip = nullptr;
 String ConfigManager::interface = nullptr;
 int ConfigManager::port = 0;
+std::shared_ptr<const ConfigSnapshot> ConfigManager::snapshot;
 
 ConfigManager::~ConfigManager()
 {
@@ -131,6 +132,7 @@ void ConfigManager::init()
 
     prepare_udn();
     validate(home);
+    publishSnapshot();
 #ifdef TOMBDEBUG
     dumpOptions();
 #endif
@@ -875,6 +877,32 @@ void ConfigManager::validate(String serverhome)
     NEW_BOOL_OPTION(temp == "yes" ? true : false);
     SET_BOOL_OPTION(CFG_SERVER_STORAGE_CACHING_ENABLED);
 
+    temp_int = getIntOption(_("/server/storage/attribute::cache-memory"),
+        DEFAULT_STORAGE_CACHE_MEMORY);
+    if (temp_int < 1)
+        throw _Exception(_("Error in config file: incorrect parameter "
+                           "for <storage cache-memory=\"\" /> attribute, "
+                           "must be at least 1"));
+    NEW_INT_OPTION(temp_int);
+    SET_INT_OPTION(CFG_SERVER_STORAGE_CACHE_MEMORY);
+
+    temp = getOption(_("/server/storage/query-stats/attribute::enabled"),
+        _(DEFAULT_STORAGE_QUERY_STATS_ENABLED));
+    if (!validateYesNo(temp))
+        throw _Exception(_("Error in config file: incorrect parameter "
+                           "for <query-stats enabled=\"\" /> attribute"));
+    NEW_BOOL_OPTION(temp == "yes" ? true : false);
+    SET_BOOL_OPTION(CFG_SERVER_STORAGE_QUERY_STATS_ENABLED);
+
+    temp_int = getIntOption(_("/server/storage/query-stats/attribute::slow-query"),
+        DEFAULT_STORAGE_SLOW_QUERY);
+    if (temp_int < 0)
+        throw _Exception(_("Error in config file: incorrect parameter "
+                           "for <query-stats slow-query=\"\" /> attribute, "
+                           "must be 0 or greater"));
+    NEW_INT_OPTION(temp_int);
+    SET_INT_OPTION(CFG_SERVER_STORAGE_SLOW_QUERY);
+
     tmpEl = getElement(_("/server/storage/mysql"));
     if (tmpEl != nullptr) {
         mysql_en = getOption(_("/server/storage/mysql/attribute::enabled"),
@@ -931,6 +959,14 @@ void ConfigManager::validate(String serverhome)
             NEW_OPTION(getOption(_("/server/storage/mysql/password")));
         }
         SET_OPTION(CFG_SERVER_STORAGE_MYSQL_PASSWORD);
+
+        temp_int = getIntOption(_("/server/storage/mysql/readers"),
+            DEFAULT_MYSQL_READERS);
+        if (temp_int < 0)
+            throw _Exception(_("Invalid <readers> value in mysql "
+                               "section, must be 0 or greater"));
+        NEW_INT_OPTION(temp_int);
+        SET_INT_OPTION(CFG_SERVER_STORAGE_MYSQL_READERS);
     }
 #else
     if (mysql_en == "yes") {
@@ -965,6 +1001,48 @@ void ConfigManager::validate(String serverhome)
         NEW_INT_OPTION(temp_int);
         SET_INT_OPTION(CFG_SERVER_STORAGE_SQLITE_SYNCHRONOUS);
 
+        temp = getOption(_("/server/storage/sqlite3/journal-mode"),
+            _(DEFAULT_SQLITE_JOURNAL_MODE));
+
+        if (temp != "wal" && temp != "delete")
+            throw _Exception(_("Invalid <journal-mode> value in sqlite3 "
+                               "section"));
+
+        NEW_OPTION(temp.toUpper());
+        SET_OPTION(CFG_SERVER_STORAGE_SQLITE_JOURNAL_MODE);
+
+        temp_int = getIntOption(_("/server/storage/sqlite3/readers"),
+            DEFAULT_SQLITE_READERS);
+        if (temp_int < 0)
+            throw _Exception(_("Invalid <readers> value in sqlite3 "
+                               "section, must be 0 or greater"));
+        NEW_INT_OPTION(temp_int);
+        SET_INT_OPTION(CFG_SERVER_STORAGE_SQLITE_READERS);
+
+        temp = getOption(_("/server/storage/sqlite3/group-commit/attribute::enabled"),
+            _(DEFAULT_SQLITE_GROUP_COMMIT_ENABLED));
+        if (!validateYesNo(temp))
+            throw _Exception(_("Error in config file: incorrect parameter "
+                               "for <group-commit enabled=\"\" /> attribute"));
+        NEW_BOOL_OPTION(temp == "yes" ? true : false);
+        SET_BOOL_OPTION(CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_ENABLED);
+
+        temp_int = getIntOption(_("/server/storage/sqlite3/group-commit/attribute::statements"),
+            DEFAULT_SQLITE_GROUP_COMMIT_STATEMENTS);
+        if (temp_int < 1)
+            throw _Exception(_("Error in config file: incorrect parameter for "
+                               "<group-commit statements=\"\" /> attribute"));
+        NEW_INT_OPTION(temp_int);
+        SET_INT_OPTION(CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_STATEMENTS);
+
+        temp_int = getIntOption(_("/server/storage/sqlite3/group-commit/attribute::delay"),
+            DEFAULT_SQLITE_GROUP_COMMIT_DELAY);
+        if (temp_int < 0)
+            throw _Exception(_("Error in config file: incorrect parameter for "
+                               "<group-commit delay=\"\" /> attribute"));
+        NEW_INT_OPTION(temp_int);
+        SET_INT_OPTION(CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_DELAY);
+
         temp = getOption(_("/server/storage/sqlite3/on-error"),
             _(DEFAULT_SQLITE_RESTORE));
 
@@ -1380,6 +1458,24 @@ void ConfigManager::validate(String serverhome)
     NEW_INT_OPTION(temp_int);
     SET_INT_OPTION(CFG_SERVER_UPNP_TITLE_AND_DESC_STRING_LIMIT);
 
+    temp_int = getIntOption(_("/server/upnp-browse-cache/attribute::memory"),
+        DEFAULT_UPNP_BROWSE_CACHE_MEMORY);
+    if (temp_int < 0)
+        throw _Exception(_("Error in config file: incorrect parameter "
+                           "for <upnp-browse-cache memory=\"\" /> attribute, "
+                           "must be 0 or greater"));
+    NEW_INT_OPTION(temp_int);
+    SET_INT_OPTION(CFG_SERVER_UPNP_BROWSE_CACHE_MEMORY);
+
+    temp_int = getIntOption(_("/server/upnp-browse-cache/attribute::fragment-memory"),
+        DEFAULT_UPNP_FRAGMENT_CACHE_MEMORY);
+    if (temp_int < 0)
+        throw _Exception(_("Error in config file: incorrect parameter "
+                           "for <upnp-browse-cache fragment-memory=\"\" /> attribute, "
+                           "must be 0 or greater"));
+    NEW_INT_OPTION(temp_int);
+    SET_INT_OPTION(CFG_SERVER_UPNP_FRAGMENT_CACHE_MEMORY);
+
 #ifdef HAVE_JS
     temp = getOption(_("/import/scripting/playlist-script"),
         prefix_dir + DIR_SEPARATOR + _(DEFAULT_JS_DIR) + DIR_SEPARATOR + _(DEFAULT_PLAYLISTS_SCRIPT));
@@ -1983,6 +2079,45 @@ void ConfigManager::prepare_udn()
         save();
 }
 
+void ConfigManager::publishSnapshot()
+{
+    auto config = std::make_shared<ConfigSnapshot>();
+    config->udn = getOption(CFG_SERVER_UDN);
+    config->stringLimit = getIntOption(CFG_SERVER_UPNP_TITLE_AND_DESC_STRING_LIMIT);
+    config->hidePCDirectory = getBoolOption(CFG_SERVER_HIDE_PC_DIRECTORY);
+
+    config->markPlayedItems = getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_ENABLED);
+    config->markPlayedPrepend = getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_STRING_MODE_PREPEND);
+    config->markPlayedString = getOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_STRING);
+    config->markPlayedSuppressCdsUpdates = getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_SUPPRESS_CDS_UPDATES);
+    config->markPlayedContent = getStringArrayOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_CONTENT_LIST);
+
+    config->lastfm = false;
+#ifdef HAVE_LASTFMLIB
+    config->lastfm = getBoolOption(CFG_SERVER_EXTOPTS_LASTFM_ENABLED);
+#endif
+
+    config->mimetypeContentType = getDictionaryOption(CFG_IMPORT_MAPPINGS_MIMETYPE_TO_CONTENTTYPE_LIST);
+    config->transcodingProfiles = getTranscodingProfileListOption(CFG_TRANSCODING_PROFILE_LIST);
+
+    config->ffmpegThumbnailer = false;
+    config->ffmpegThumbnailerSize = 0;
+#if defined(HAVE_FFMPEG) && defined(HAVE_FFMPEGTHUMBNAILER)
+    config->ffmpegThumbnailer = getBoolOption(CFG_SERVER_EXTOPTS_FFMPEGTHUMBNAILER_ENABLED);
+    config->ffmpegThumbnailerSize = getIntOption(CFG_SERVER_EXTOPTS_FFMPEGTHUMBNAILER_THUMBSIZE);
+#endif
+
+    config->extendProtocolInfo = false;
+    config->samsungHack = false;
+#ifdef EXTEND_PROTOCOLINFO
+    config->extendProtocolInfo = getBoolOption(CFG_SERVER_EXTEND_PROTOCOLINFO);
+    config->samsungHack = getBoolOption(CFG_SERVER_EXTEND_PROTOCOLINFO_SM_HACK);
+#endif
+
+    // requests that already hold the previous snapshot finish with it
+    std::atomic_store(&snapshot, std::shared_ptr<const ConfigSnapshot>(config));
+}
+
 void ConfigManager::prepare_path(String xpath, bool needDir, bool existenceUnneeded)
 {
     String temp;
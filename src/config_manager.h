@@ -33,6 +33,8 @@
 #ifndef __CONFIG_MANAGER_H__
 #define __CONFIG_MANAGER_H__
 
+#include <memory>
+
 #include "common.h"
 #include "mxml/mxml.h"
 #include "singleton.h"
@@ -74,6 +76,8 @@ typedef enum
     CFG_SERVER_BOOKMARK_FILE,
     CFG_SERVER_CUSTOM_HTTP_HEADERS,
     CFG_SERVER_UPNP_TITLE_AND_DESC_STRING_LIMIT,
+    CFG_SERVER_UPNP_BROWSE_CACHE_MEMORY,
+    CFG_SERVER_UPNP_FRAGMENT_CACHE_MEMORY,
     CFG_SERVER_UI_ENABLED,
     CFG_SERVER_UI_POLL_INTERVAL,
     CFG_SERVER_UI_POLL_WHEN_IDLE,
@@ -85,9 +89,17 @@ typedef enum
     CFG_SERVER_UI_SHOW_TOOLTIPS,
     CFG_SERVER_STORAGE_DRIVER,
     CFG_SERVER_STORAGE_CACHING_ENABLED,
+    CFG_SERVER_STORAGE_CACHE_MEMORY,
+    CFG_SERVER_STORAGE_QUERY_STATS_ENABLED,
+    CFG_SERVER_STORAGE_SLOW_QUERY,
 #ifdef HAVE_SQLITE3
     CFG_SERVER_STORAGE_SQLITE_DATABASE_FILE,
     CFG_SERVER_STORAGE_SQLITE_SYNCHRONOUS,
+    CFG_SERVER_STORAGE_SQLITE_JOURNAL_MODE,
+    CFG_SERVER_STORAGE_SQLITE_READERS,
+    CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_ENABLED,
+    CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_STATEMENTS,
+    CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_DELAY,
     CFG_SERVER_STORAGE_SQLITE_RESTORE,
     CFG_SERVER_STORAGE_SQLITE_BACKUP_ENABLED,
     CFG_SERVER_STORAGE_SQLITE_BACKUP_INTERVAL,
@@ -99,6 +111,7 @@ typedef enum
     CFG_SERVER_STORAGE_MYSQL_SOCKET,
     CFG_SERVER_STORAGE_MYSQL_PASSWORD,
     CFG_SERVER_STORAGE_MYSQL_DATABASE,
+    CFG_SERVER_STORAGE_MYSQL_READERS,
 #endif
 #if defined(HAVE_FFMPEG) && defined(HAVE_FFMPEGTHUMBNAILER)
     CFG_SERVER_EXTOPTS_FFMPEGTHUMBNAILER_ENABLED,
@@ -178,6 +191,36 @@ typedef enum
     CFG_MAX
 } config_option_t;
 
+/// \brief Typed copy of the options that are read while serving requests.
+///
+/// A snapshot is built once the options are validated and is never changed
+/// afterwards, a new configuration is published as a new snapshot. Whoever
+/// holds a snapshot keeps seeing the same values until it is released.
+class ConfigSnapshot
+{
+public:
+    zmm::String udn;
+    int stringLimit;
+    bool hidePCDirectory;
+
+    bool markPlayedItems;
+    bool markPlayedPrepend;
+    zmm::String markPlayedString;
+    bool markPlayedSuppressCdsUpdates;
+    zmm::Ref<zmm::Array<zmm::StringBase> > markPlayedContent;
+
+    bool lastfm;
+
+    zmm::Ref<Dictionary> mimetypeContentType;
+    zmm::Ref<TranscodingProfileList> transcodingProfiles;
+
+    bool ffmpegThumbnailer;
+    int ffmpegThumbnailerSize;
+
+    bool extendProtocolInfo;
+    bool samsungHack;
+};
+
 class ConfigManager : public Singleton<ConfigManager, std::mutex>
 {
 public:
@@ -239,6 +282,10 @@ public:
 
     static bool isDebugLogging() { return debug_logging; };
 
+    /// \brief returns the current snapshot of the options, without locking
+    /// and without going through the singleton
+    static std::shared_ptr<const ConfigSnapshot> getSnapshot() { return std::atomic_load(&snapshot); }
+
     /// \brief Creates a html file that is a redirector to the current server i
     /// instance
     void writeBookmark(zmm::String ip, zmm::String port);
@@ -259,6 +306,9 @@ protected:
     void migrate();
     void validate(zmm::String serverhome);
     void prepare_udn();
+    /// \brief builds a snapshot of the validated options and makes it the
+    /// current one
+    void publishSnapshot();
     zmm::String construct_path(zmm::String path);
     void prepare_path(zmm::String path, bool needDir = false, bool existenceUnneeded = false);
     
@@ -271,6 +321,7 @@ protected:
     static zmm::String ip;
     static zmm::String interface;
     static int port;
+    static std::shared_ptr<const ConfigSnapshot> snapshot;
 
     zmm::Ref<mxml::Document> rootDoc;
     zmm::Ref<mxml::Element> root;
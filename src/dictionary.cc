@@ -31,9 +31,12 @@
 
 #include "dictionary.h"
 
+#include <climits>
 #include <cstring>
 #include "tools.h"
 
+#define COMPACT_SEP ':'
+
 using namespace zmm;
 
 DictionaryElement::DictionaryElement(String key, String value) : Object()
@@ -193,6 +196,97 @@ void Dictionary::decodeSimple(String url)
     while (last_pos < url.length());
 }
 
+String Dictionary::encodeCompact()
+{
+    Ref<StringBuffer> buf(new StringBuffer());
+    *buf << DICTIONARY_COMPACT_PREFIX;
+    encodeCompact(buf);
+    return buf->toString();
+}
+
+// <count>:<key length>:<key><value length>:<value>...
+void Dictionary::encodeCompact(Ref<StringBuffer> buf)
+{
+    int len = elements->size();
+    compactAppend(buf, len);
+    for (int i = 0; i < len; i++)
+    {
+        Ref<DictionaryElement> el = elements->get(i);
+        String key = el->getKey();
+        String value = el->getValue();
+        compactAppend(buf, key.length());
+        *buf << key;
+        compactAppend(buf, value.length());
+        *buf << value;
+    }
+}
+
+void Dictionary::decodeCompact(String data)
+{
+    if (!string_ok(data))
+        return;
+
+    if (!data.startsWith(_(DICTIONARY_COMPACT_PREFIX)))
+    {
+        decode(data);
+        return;
+    }
+
+    const char *pos = data.c_str() + strlen(DICTIONARY_COMPACT_PREFIX);
+    if (!decodeCompact(&pos, data.c_str() + data.length()))
+        throw _Exception(_("Dictionary::decodeCompact: Could not parse data"));
+}
+
+bool Dictionary::decodeCompact(const char **data, const char *end)
+{
+    int count;
+    if (!compactReadInt(data, end, &count))
+        return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        int len;
+        if (!compactReadInt(data, end, &len) || len > end - *data)
+            return false;
+        String key(*data, len);
+        *data += len;
+
+        if (!compactReadInt(data, end, &len) || len > end - *data)
+            return false;
+        String value(*data, len);
+        *data += len;
+
+        // keys are unique, no need to look them up
+        Ref<DictionaryElement> newEl(new DictionaryElement(key, value));
+        elements->append(newEl);
+    }
+    return true;
+}
+
+void Dictionary::compactAppend(Ref<StringBuffer> buf, int num)
+{
+    *buf << num << COMPACT_SEP;
+}
+
+bool Dictionary::compactReadInt(const char **data, const char *end, int *num)
+{
+    const char *pos = *data;
+    int value = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9')
+    {
+        if (value > (INT_MAX - 9) / 10)
+            return false;
+        value = value * 10 + (*pos - '0');
+        pos++;
+    }
+    if (pos == *data || pos >= end || *pos != COMPACT_SEP)
+        return false;
+
+    *num = value;
+    *data = pos + 1;
+    return true;
+}
+
 void Dictionary::clear()
 {
     elements->remove(0, elements->size());
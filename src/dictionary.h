@@ -35,6 +35,10 @@
 #include <mutex>
 #include "zmm/zmmf.h"
 
+/// \brief Version prefix of the compact encoding, url encoded data never
+/// starts with it.
+#define DICTIONARY_COMPACT_PREFIX "#1"
+
 /// \brief This class should never be used directly, it is being used by the Dictionary class.
 class DictionaryElement : public zmm::Object
 {
@@ -102,6 +106,26 @@ public:
     /// \brief Makes a dictionary out of simplified url encoded data.
     void decodeSimple(zmm::String url);
 
+    /// \brief Returns the compact encoding of the dictionary that is used
+    /// for storage, keys and values are copied verbatim after their length.
+    zmm::String encodeCompact();
+
+    /// \brief Appends the compact encoding without the version prefix.
+    void encodeCompact(zmm::Ref<zmm::StringBuffer> buf);
+
+    /// \brief Makes a dictionary out of compact or url encoded data.
+    void decodeCompact(zmm::String data);
+
+    /// \brief Reads a compact encoded dictionary starting at data and moves
+    /// data behind it, returns false if the data is malformed.
+    bool decodeCompact(const char **data, const char *end);
+
+    /// \brief Appends a number of the compact encoding.
+    static void compactAppend(zmm::Ref<zmm::StringBuffer> buf, int num);
+
+    /// \brief Reads a number of the compact encoding.
+    static bool compactReadInt(const char **data, const char *end, int *num);
+
     /// \brief Makes a shallow copy of the dictionary
     zmm::Ref<Dictionary> clone();
 
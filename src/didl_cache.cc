@@ -0,0 +1,159 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  didl_cache.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file didl_cache.cc
+
+#include "didl_cache.h"
+
+// estimated bookkeeping of an entry and of each of its fragments
+#define DIDL_CACHE_ENTRY_OVERHEAD 96
+#define DIDL_CACHE_FRAGMENT_OVERHEAD 48
+
+using namespace zmm;
+using namespace std;
+
+DIDLCache::DIDLCache(size_t memoryLimit)
+{
+    this->memoryLimit = memoryLimit;
+    memoryUsage = 0;
+    generation = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+int DIDLCache::getChildCount(Ref<CdsObject> obj)
+{
+    if (!IS_CDS_CONTAINER(obj->getObjectType()))
+        return -1;
+    return RefCast(obj, CdsContainer)->getChildCount();
+}
+
+String DIDLCache::get(Ref<CdsObject> obj, const string& filter)
+{
+    AutoLock lock(mutex);
+    auto it = entries.find(obj->getID());
+    if (it == entries.end() || it->second.childCount != getChildCount(obj)) {
+        misses++;
+        return nullptr;
+    }
+    for (auto const& fragment : it->second.fragments) {
+        if (fragment.first == filter) {
+            lru.splice(lru.begin(), lru, it->second.pos);
+            hits++;
+            return fragment.second;
+        }
+    }
+    misses++;
+    return nullptr;
+}
+
+void DIDLCache::put(Ref<CdsObject> obj, const string& filter, String fragment, unsigned long long generation)
+{
+    size_t size = filter.length() + fragment.length() + DIDL_CACHE_FRAGMENT_OVERHEAD;
+    if (size + DIDL_CACHE_ENTRY_OVERHEAD > memoryLimit)
+        return;
+
+    int childCount = getChildCount(obj);
+    AutoLock lock(mutex);
+    // the object may have changed since it was loaded
+    if (generation != this->generation)
+        return;
+
+    auto it = entries.find(obj->getID());
+    if (it != entries.end() && it->second.childCount != childCount) {
+        remove(it);
+        it = entries.end();
+    }
+    if (it == entries.end()) {
+        lru.push_front(obj->getID());
+        Entry& entry = entries[obj->getID()];
+        entry.childCount = childCount;
+        entry.refID = obj->getRefID();
+        if (entry.refID > 0)
+            references[entry.refID].insert(obj->getID());
+        entry.size = DIDL_CACHE_ENTRY_OVERHEAD;
+        entry.pos = lru.begin();
+        memoryUsage += entry.size;
+        it = entries.find(obj->getID());
+    } else {
+        for (auto const& cached : it->second.fragments) {
+            if (cached.first == filter)
+                return;
+        }
+        lru.splice(lru.begin(), lru, it->second.pos);
+    }
+    it->second.fragments.push_back(make_pair(filter, fragment));
+    it->second.size += size;
+    memoryUsage += size;
+
+    // the entry just used is at the front and evicted last
+    while (memoryUsage > memoryLimit && lru.size() > 1) {
+        remove(entries.find(lru.back()));
+        evictions++;
+    }
+}
+
+void DIDLCache::invalidate(int id)
+{
+    AutoLock lock(mutex);
+    generation++;
+    auto refs = references.find(id);
+    if (refs != references.end()) {
+        // remove() changes the set
+        unordered_set<int> refIDs = refs->second;
+        for (int refID : refIDs)
+            remove(entries.find(refID));
+    }
+    auto it = entries.find(id);
+    if (it != entries.end())
+        remove(it);
+}
+
+void DIDLCache::clear()
+{
+    AutoLock lock(mutex);
+    generation++;
+    entries.clear();
+    references.clear();
+    lru.clear();
+    memoryUsage = 0;
+}
+
+size_t DIDLCache::getMemoryUsage()
+{
+    AutoLock lock(mutex);
+    return memoryUsage;
+}
+
+void DIDLCache::remove(unordered_map<int, Entry>::iterator it)
+{
+    memoryUsage -= it->second.size;
+    lru.erase(it->second.pos);
+    if (it->second.refID > 0) {
+        auto refs = references.find(it->second.refID);
+        refs->second.erase(it->first);
+        if (refs->second.empty())
+            references.erase(refs);
+    }
+    entries.erase(it);
+}
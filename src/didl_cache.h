@@ -0,0 +1,114 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  didl_cache.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file didl_cache.h
+/// \brief Cache of the rendered DIDL-Lite of single objects.
+
+#ifndef __DIDL_CACHE_H__
+#define __DIDL_CACHE_H__
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "zmm/zmmf.h"
+#include "cds_objects.h"
+
+/// \brief Cache of DIDL-Lite fragments of objects, as returned by
+/// DIDLWriter::writeObjectFragment() of an escaping writer.
+///
+/// A fragment only depends on the object itself and the Filter it was
+/// written with, the folder artwork is looked up again for every response.
+/// The storage drops the fragment of an object when it is updated or
+/// removed, and the fragments of containers whose children change.
+/// References show the properties of their original, so they are dropped
+/// together with it. The child count of a container is checked on every
+/// lookup as well, since Search leaves it out. Every invalidation starts a
+/// new generation, a fragment rendered from objects loaded in an older one
+/// is not stored. The cache is limited by the memory of its fragments and
+/// evicts the objects that were used least recently first.
+class DIDLCache : public zmm::Object
+{
+public:
+    /// \param memoryLimit size of the cache in bytes
+    explicit DIDLCache(size_t memoryLimit);
+
+    /// \brief the current generation, to be taken before the objects
+    /// that are rendered are loaded
+    unsigned long long getGeneration() { return generation; }
+
+    /// \brief returns the fragment of the object written with the filter,
+    /// nullptr if it is not cached
+    zmm::String get(zmm::Ref<CdsObject> obj, const std::string& filter);
+
+    /// \brief stores the fragment of an object loaded in the given generation
+    void put(zmm::Ref<CdsObject> obj, const std::string& filter, zmm::String fragment, unsigned long long generation);
+
+    /// \brief drops the fragments of an object and of its references
+    void invalidate(int id);
+
+    /// \brief drops all fragments
+    void clear();
+
+    unsigned long long getHits() { return hits; }
+    unsigned long long getMisses() { return misses; }
+    unsigned long long getEvictions() { return evictions; }
+    size_t getMemoryUsage();
+
+private:
+    class Entry
+    {
+    public:
+        /// fragments by filter, there is rarely more than one
+        std::vector<std::pair<std::string, zmm::String> > fragments;
+        int childCount;
+        int refID;
+        size_t size;
+        std::list<int>::iterator pos;
+    };
+
+    using AutoLock = std::lock_guard<std::mutex>;
+
+    static int getChildCount(zmm::Ref<CdsObject> obj);
+    void remove(std::unordered_map<int, Entry>::iterator it);
+
+    size_t memoryLimit;
+    size_t memoryUsage;
+    std::unordered_map<int, Entry> entries;
+    /// cached references by the ID of their original
+    std::unordered_map<int, std::unordered_set<int> > references;
+    /// object IDs from the most to the least recently used
+    std::list<int> lru;
+    std::mutex mutex;
+
+    std::atomic<unsigned long long> generation;
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+    std::atomic<unsigned long long> evictions;
+};
+
+#endif // __DIDL_CACHE_H__
@@ -0,0 +1,69 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  didl_filter.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file didl_filter.cc
+
+#include "didl_filter.h"
+#include "tools.h"
+
+using namespace zmm;
+
+Ref<DIDLFilter> DIDLFilter::parse(String filter)
+{
+    filter = trim_string(filter);
+    if (!string_ok(filter))
+        return nullptr;
+
+    Ref<DIDLFilter> result(new DIDLFilter());
+    Ref<Array<StringBase>> parts = split_string(filter, ',');
+    for (int i = 0; i < parts->size(); i++) {
+        String part = trim_string(parts->get(i));
+        if (!string_ok(part))
+            continue;
+        if (part == "*")
+            return nullptr;
+        int length = part.length();
+        if (length > 2 && part.charAt(length - 1) == '*' && part.charAt(length - 2) == ':') {
+            // "upnp:*", kept with the colon
+            result->namespaces.push_back(std::string(part.c_str(), length - 1));
+            continue;
+        }
+        result->properties.insert(std::string(part.c_str()));
+        // "res@size" asks for the res element as well
+        int at = part.index('@');
+        if (at > 0)
+            result->properties.insert(std::string(part.c_str(), at));
+    }
+    return result;
+}
+
+bool DIDLFilter::has(String property)
+{
+    std::string name(property.c_str());
+    if (properties.find(name) != properties.end())
+        return true;
+    for (auto& ns : namespaces) {
+        if (name.compare(0, ns.length(), ns) == 0)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  didl_filter.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file didl_filter.h
+/// \brief Filter argument of the CDS Browse and Search actions, the
+/// properties a control point wants to see in the DIDL-Lite result.
+
+#ifndef __DIDL_FILTER_H__
+#define __DIDL_FILTER_H__
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "zmm/zmmf.h"
+
+class DIDLFilter : public zmm::Object
+{
+public:
+    /// \brief parses a UPnP Filter string like "dc:title,upnp:artist,res@size"
+    /// \return nullptr if all properties are wanted
+    ///
+    /// An empty filter is treated like "*", many control points leave it
+    /// out and still expect the full objects.
+    static zmm::Ref<DIDLFilter> parse(zmm::String filter);
+
+    /// \brief true if the element or attribute (e.g. "res", "@childCount")
+    /// was requested; an element is also requested by one of its
+    /// attributes and "upnp:*" requests the whole namespace
+    bool has(zmm::String property);
+
+protected:
+    std::unordered_set<std::string> properties;
+    std::vector<std::string> namespaces;
+};
+
+#endif // __DIDL_FILTER_H__
@@ -0,0 +1,364 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  didl_writer.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file didl_writer.cc
+
+#include "didl_writer.h"
+#include "cds_resource_manager.h"
+#include "metadata_handler.h"
+#include "storage.h"
+#include "tools.h"
+#include "upnp_xml.h"
+
+using namespace zmm;
+
+// initial size of the buffer, a page of objects takes a few kB each
+#define DIDL_WRITER_CAPACITY 16384
+
+/* the replacement of a character by mxml::Node::escape(), nullptr if it
+   is kept */
+static inline const char* escapeChar(signed char c)
+{
+    switch (c) {
+    case '<':
+        return "&lt;";
+    case '>':
+        return "&gt;";
+    case '&':
+        return "&amp;";
+    case '"':
+        return "&quot;";
+    case '\'':
+        return "&apos;";
+    default:
+        if ((c >= 0x00 && c <= 0x1f && c != 0x09 && c != 0x0d && c != 0x0a) || c == 0x7f)
+            return ".";
+        return nullptr;
+    }
+}
+
+DIDLWriter::DIDLWriter(bool escaped)
+{
+    buf = Ref<StringBuffer>(new StringBuffer(DIDL_WRITER_CAPACITY));
+    this->escaped = escaped;
+    startTagOpen = false;
+    renderRes = true;
+    renderAlbumArt = true;
+}
+
+void DIDLWriter::startDIDL(bool samsungNamespace)
+{
+    startElement(_("DIDL-Lite"));
+    attribute(_(XML_NAMESPACE_ATTR), _(XML_DIDL_LITE_NAMESPACE));
+    attribute(_(XML_DC_NAMESPACE_ATTR), _(XML_DC_NAMESPACE));
+    attribute(_(XML_UPNP_NAMESPACE_ATTR), _(XML_UPNP_NAMESPACE));
+#ifdef EXTEND_PROTOCOLINFO
+    if (samsungNamespace)
+        attribute(_(XML_SEC_NAMESPACE_ATTR), _(XML_SEC_NAMESPACE));
+#endif
+}
+
+void DIDLWriter::endDIDL()
+{
+    endElement(_("DIDL-Lite"));
+}
+
+void DIDLWriter::writeObject(Ref<CdsObject> obj, int stringLimit, Ref<DIDLFilter> filter)
+{
+    startObject(obj, stringLimit, filter);
+    endObject(obj);
+}
+
+String DIDLWriter::writeObjectFragment(Ref<CdsObject> obj, int stringLimit, Ref<DIDLFilter> filter)
+{
+    // the start tag of DIDL-Lite is not part of the object
+    closeStartTag();
+    int start = buf->length();
+    startObject(obj, stringLimit, filter);
+    String fragment = buf->toString(start);
+    endObject(obj);
+    return fragment;
+}
+
+void DIDLWriter::writeCachedObject(Ref<CdsObject> obj, String fragment, Ref<DIDLFilter> filter)
+{
+    setFilter(filter);
+    closeStartTag();
+    *buf << fragment;
+    endObject(obj);
+}
+
+void DIDLWriter::setFilter(Ref<DIDLFilter> filter)
+{
+    renderRes = (filter == nullptr || filter->has(_("res")));
+    renderAlbumArt = (filter == nullptr || filter->has(MetadataHandler::getMetaFieldName(M_ALBUMARTURI)));
+}
+
+String DIDLWriter::getElementName(Ref<CdsObject> obj)
+{
+    int objectType = obj->getObjectType();
+    if (IS_CDS_ITEM(objectType))
+        return _("item");
+    if (IS_CDS_CONTAINER(objectType))
+        return _("container");
+    return _("");
+}
+
+void DIDLWriter::startObject(Ref<CdsObject> obj, int stringLimit, Ref<DIDLFilter> filter)
+{
+    setFilter(filter);
+
+    int objectType = obj->getObjectType();
+    startElement(getElementName(obj));
+    attribute(_("id"), String::from(obj->getID()));
+    attribute(_("parentID"), String::from(obj->getParentID()));
+    attribute(_("restricted"), obj->isRestricted() ? _("1") : _("0"));
+    if (IS_CDS_CONTAINER(objectType)) {
+        int childCount = RefCast(obj, CdsContainer)->getChildCount();
+        if (childCount >= 0)
+            attribute(_("childCount"), String::from(childCount));
+    }
+
+    String tmp = obj->getTitle();
+    if ((stringLimit > 0) && (tmp.length() > stringLimit)) {
+        tmp = tmp.substring(0, getValidUTF8CutPosition(tmp, stringLimit - 3));
+        tmp = tmp + _("...");
+    }
+    textElement(_("dc:title"), tmp);
+    textElement(_("upnp:class"), obj->getClass());
+
+    String upnp_class = obj->getClass();
+    if (IS_CDS_ITEM(objectType)) {
+        Ref<CdsItem> item = RefCast(obj, CdsItem);
+
+        Ref<Array<DictionaryElement>> elements = obj->getMetadata()->getElements();
+        for (int i = 0; i < elements->size(); i++) {
+            Ref<DictionaryElement> el = elements->get(i);
+            String key = el->getKey();
+            if (filter != nullptr && !filter->has(key))
+                continue;
+            if (key == MetadataHandler::getMetaFieldName(M_DESCRIPTION)) {
+                tmp = el->getValue();
+                if ((stringLimit > 0) && (tmp.length() > stringLimit)) {
+                    tmp = tmp.substring(0, getValidUTF8CutPosition(tmp, stringLimit - 3));
+                    tmp = tmp + _("...");
+                }
+                textElement(key, tmp);
+            } else if (key == MetadataHandler::getMetaFieldName(M_TRACKNUMBER)) {
+                if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_TRACK)
+                    textElement(key, el->getValue());
+            } else if (key != MetadataHandler::getMetaFieldName(M_TITLE))
+                textElement(key, el->getValue());
+        }
+
+        // the album art of the item is written with its resources
+        if (renderRes || renderAlbumArt)
+            CdsResourceManager::addResources(item, Ref<DIDLWriter>(this));
+    } else if (IS_CDS_CONTAINER(objectType)) {
+        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM && (filter == nullptr || filter->has(_("dc:creator")))) {
+            Ref<Dictionary> meta = obj->getMetadata();
+            String creator = meta->get(MetadataHandler::getMetaFieldName(M_ALBUMARTIST));
+            if (!string_ok(creator))
+                creator = meta->get(MetadataHandler::getMetaFieldName(M_ARTIST));
+            if (string_ok(creator))
+                textElement(_("dc:creator"), creator);
+        }
+    }
+}
+
+void DIDLWriter::endObject(Ref<CdsObject> obj)
+{
+    // artwork of the directory, it changes with the images next to the object
+    int objectType = obj->getObjectType();
+    String upnp_class = obj->getClass();
+    if (IS_CDS_ITEM(objectType)) {
+        Ref<CdsItem> item = RefCast(obj, CdsItem);
+        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_TRACK && renderAlbumArt) {
+            // extension-less, lowercase track name of an image to use as cover
+            String dctl = item->getTitle().toLower();
+            String trackArtBase = String();
+            int doti = dctl.rindex('.');
+            if (doti >= 0)
+                trackArtBase = dctl.substring(0, doti);
+            String aa_id = Storage::getInstance()->findFolderImage(item->getParentID(), trackArtBase);
+            if (aa_id != nullptr)
+                writeAlbumArtURI(UpnpXML_DIDLFolderImageURL(aa_id));
+        }
+    } else if (IS_CDS_CONTAINER(objectType)) {
+        if ((upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM || upnp_class == UPNP_DEFAULT_CLASS_CONTAINER) && renderAlbumArt) {
+            Ref<Storage> storage = Storage::getInstance();
+            String aa_id = storage->findFolderImage(obj->getID(), String());
+            if (aa_id != nullptr)
+                writeAlbumArtURI(UpnpXML_DIDLFolderImageURL(aa_id));
+            else if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM) {
+                // the artwork of the first track
+                Ref<CdsItem> item = storage->findEmbeddedArtItem(obj->getID());
+                if (item != nullptr)
+                    writeAlbumArtURI(CdsResourceManager::getArtworkUrl(item));
+            }
+        }
+    }
+
+    endElement(getElementName(obj));
+}
+
+void DIDLWriter::writeResource(String url, Ref<Dictionary> attributes)
+{
+    if (!renderRes)
+        return;
+    startElement(_("res"));
+    Ref<Array<DictionaryElement>> elements = attributes->getElements();
+    for (int i = 0; i < elements->size(); i++) {
+        Ref<DictionaryElement> el = elements->get(i);
+        attribute(el->getKey(), el->getValue());
+    }
+    text(url);
+    endElement(_("res"));
+}
+
+void DIDLWriter::writeAlbumArtURI(String url, bool dlnaProfile)
+{
+    if (!renderAlbumArt)
+        return;
+    String name = MetadataHandler::getMetaFieldName(M_ALBUMARTURI);
+    startElement(name);
+    if (dlnaProfile) {
+        attribute(_("xmlns:dlna"), _("urn:schemas-dlna-org:metadata-1-0"));
+        attribute(_("dlna:profileID"), _("JPEG_TN"));
+    }
+    text(url);
+    endElement(name);
+}
+
+void DIDLWriter::writeCaptionInfo(String url)
+{
+    // see UpnpXML_DIDLRenderCaptionInfo()
+    startElement(_("sec:CaptionInfoEx"));
+    attribute(_("sec:type"), _("srt"));
+    text(url.substring(0, url.rindex('.')) + ".srt");
+    endElement(_("sec:CaptionInfoEx"));
+}
+
+void DIDLWriter::startElement(String name)
+{
+    closeStartTag();
+    markup("<");
+    markup(name.c_str());
+    startTagOpen = true;
+}
+
+void DIDLWriter::attribute(String name, String value)
+{
+    markup(" ");
+    markup(name.c_str());
+    markup("=\"");
+    escape(value);
+    markup("\"");
+}
+
+void DIDLWriter::text(String text)
+{
+    closeStartTag();
+    escape(text);
+}
+
+void DIDLWriter::endElement(String name)
+{
+    // mxml closes elements without children in the start tag
+    if (startTagOpen) {
+        markup("/>");
+        startTagOpen = false;
+        return;
+    }
+    markup("</");
+    markup(name.c_str());
+    markup(">");
+}
+
+void DIDLWriter::textElement(String name, String text)
+{
+    String attr;
+    String val;
+    int i, j;
+
+    // name@attr[val] => <name attr="val">
+    if (((i = name.index('@')) > 0)
+        && ((j = name.index(i + 1, '[')) > 0)
+        && (name[name.length() - 1] == ']')) {
+        attr = name.substring(i + 1, j - i - 1);
+        val = name.substring(j + 1, name.length() - j - 2);
+        name = name.substring(0, i);
+    }
+    startElement(name);
+    if (attr.length() && val.length())
+        attribute(attr, val);
+    this->text(text);
+    endElement(name);
+}
+
+void DIDLWriter::closeStartTag()
+{
+    if (startTagOpen) {
+        markup(">");
+        startTagOpen = false;
+    }
+}
+
+void DIDLWriter::markup(const char* str)
+{
+    if (!escaped) {
+        *buf << str;
+        return;
+    }
+    const char* run = str;
+    for (; *str; str++) {
+        const char* entity = escapeChar(*str);
+        if (entity == nullptr)
+            continue;
+        if (str > run)
+            buf->concat((char*)run, str - run);
+        *buf << entity;
+        run = str + 1;
+    }
+    if (str > run)
+        buf->concat((char*)run, str - run);
+}
+
+void DIDLWriter::escape(String str)
+{
+    const char* p = str.c_str();
+    if (p == nullptr)
+        return;
+    // copy the runs of characters that stay as they are in one go
+    const char* run = p;
+    for (; *p; p++) {
+        const char* entity = escapeChar(*p);
+        if (entity == nullptr)
+            continue;
+        if (p > run)
+            buf->concat((char*)run, p - run);
+        markup(entity);
+        run = p + 1;
+    }
+    if (p > run)
+        buf->concat((char*)run, p - run);
+}
@@ -0,0 +1,105 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  didl_writer.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file didl_writer.h
+/// \brief Writes DIDL-Lite straight into a buffer, without building an
+/// mxml tree first.
+
+#ifndef __DIDL_WRITER_H__
+#define __DIDL_WRITER_H__
+
+#include "zmm/zmmf.h"
+#include "cds_objects.h"
+#include "dictionary.h"
+#include "didl_filter.h"
+
+/// \brief Serializer for the DIDL-Lite result of Browse and Search.
+///
+/// The output is byte for byte what printing the elements of
+/// UpnpXML_DIDLRenderObject() gives. In escaped mode the markup is
+/// escaped once more on the fly, so that the buffer can be used as the
+/// already escaped text of the SOAP Result element.
+class DIDLWriter : public zmm::Object
+{
+public:
+    /// \param escaped escape the DIDL-Lite for embedding it as XML text
+    DIDLWriter(bool escaped);
+
+    /// \brief opens the DIDL-Lite root element
+    /// \param samsungNamespace also declare the sec namespace
+    void startDIDL(bool samsungNamespace);
+    void endDIDL();
+
+    /// \brief writes an item or a container like UpnpXML_DIDLRenderObject()
+    /// \param filter properties to write, nullptr writes all of them
+    void writeObject(zmm::Ref<CdsObject> obj, int stringLimit = -1, zmm::Ref<DIDLFilter> filter = nullptr);
+
+    /// \brief writes an object like writeObject()
+    /// \return the output without the folder artwork and the end tag, it
+    /// only depends on the object and can be kept for writeCachedObject()
+    zmm::String writeObjectFragment(zmm::Ref<CdsObject> obj, int stringLimit = -1, zmm::Ref<DIDLFilter> filter = nullptr);
+
+    /// \brief writes an object from a fragment of writeObjectFragment()
+    /// written in the same mode and with the same filter, the folder
+    /// artwork is looked up again
+    void writeCachedObject(zmm::Ref<CdsObject> obj, zmm::String fragment, zmm::Ref<DIDLFilter> filter = nullptr);
+
+    /// \brief elements of an item written by CdsResourceManager::addResources(),
+    /// the ones left out by the filter of the current object are dropped
+    void writeResource(zmm::String url, zmm::Ref<Dictionary> attributes);
+    void writeAlbumArtURI(zmm::String url, bool dlnaProfile = false);
+    void writeCaptionInfo(zmm::String url);
+
+    zmm::String toString() { return buf->toString(); }
+
+protected:
+    zmm::Ref<zmm::StringBuffer> buf;
+    bool escaped;
+    bool startTagOpen;
+
+    /* per object, set from the filter */
+    bool renderRes;
+    bool renderAlbumArt;
+
+    void setFilter(zmm::Ref<DIDLFilter> filter);
+    zmm::String getElementName(zmm::Ref<CdsObject> obj);
+    /* the object up to its folder artwork */
+    void startObject(zmm::Ref<CdsObject> obj, int stringLimit, zmm::Ref<DIDLFilter> filter);
+    /* the folder artwork and the end tag */
+    void endObject(zmm::Ref<CdsObject> obj);
+
+    void startElement(zmm::String name);
+    void attribute(zmm::String name, zmm::String value);
+    void text(zmm::String text);
+    void endElement(zmm::String name);
+    /* an element with text, name may be "name@attr[value]" like for
+       mxml::Element::appendTextChild() */
+    void textElement(zmm::String name, zmm::String text);
+    void closeStartTag();
+
+    /* markup, only escaped in escaped mode */
+    void markup(const char *str);
+    /* text and attribute values */
+    void escape(zmm::String str);
+};
+
+#endif // __DIDL_WRITER_H__
@@ -41,7 +41,8 @@ enum mxml_value_type
     mxml_string_type,
     mxml_bool_type,
     mxml_null_type,
-    mxml_int_type
+    mxml_int_type,
+    mxml_raw_type // already escaped XML text
 };
 }
 
@@ -51,5 +51,8 @@ Text::Text(String text, enum mxml_value_type vtype) : Node()
 
 void Text::print_internal(Ref<StringBuffer> buf, int indent)
 {
-    *buf << escape(text);
+    if (vtype == mxml_raw_type)
+        *buf << text;
+    else
+        *buf << escape(text);
 }
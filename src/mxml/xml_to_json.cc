@@ -171,7 +171,7 @@ void XML2JSON::handleElement(Ref<StringBuffer> buf, Ref<Element> el)
 
 String XML2JSON::getValue(String text, enum mxml_value_type type)
 {
-    if (type == mxml_string_type)
+    if (type == mxml_string_type || type == mxml_raw_type)
         return _("\"") + escape(text, '\\', '"') + '"';
     if (type == mxml_bool_type)
     {
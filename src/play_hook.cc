@@ -45,11 +45,11 @@ using namespace zmm;
 void PlayHook::trigger(zmm::Ref<CdsObject> obj)
 {
     log_debug("start\n");
-    Ref<ConfigManager> cfg = ConfigManager::getInstance();
+    std::shared_ptr<const ConfigSnapshot> config = ConfigManager::getSnapshot();
 
-    if (cfg->getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_ENABLED) && !obj->getFlag(OBJECT_FLAG_PLAYED))
+    if (config->markPlayedItems && !obj->getFlag(OBJECT_FLAG_PLAYED))
     {
-        Ref<Array<StringBase> > mark_list = cfg->getStringArrayOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_CONTENT_LIST);
+        Ref<Array<StringBase> > mark_list = config->markPlayedContent;
 
         for (int i = 0; i < mark_list->size(); i++)
         {
@@ -57,7 +57,7 @@ void PlayHook::trigger(zmm::Ref<CdsObject> obj)
             {
                 obj->setFlag(OBJECT_FLAG_PLAYED);
         
-                bool supress = cfg->getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_SUPPRESS_CDS_UPDATES);
+                bool supress = config->markPlayedSuppressCdsUpdates;
 
                 Ref<ContentManager> cm = ContentManager::getInstance();
                 log_debug("Marking object %s as played\n", obj->getTitle().c_str());
@@ -68,7 +68,7 @@ void PlayHook::trigger(zmm::Ref<CdsObject> obj)
     }
 
 #ifdef HAVE_LASTFMLIB
-    if (cfg->getBoolOption(CFG_SERVER_EXTOPTS_LASTFM_ENABLED) &&
+    if (config->lastfm &&
         (RefCast(obj, CdsItem)->getMimeType().startsWith("audio")))
         LastFm::getInstance()->startedPlaying(RefCast(obj, CdsItem));
 #endif
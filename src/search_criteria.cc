@@ -0,0 +1,252 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  search_criteria.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file search_criteria.cc
+
+#include "search_criteria.h"
+#include "common.h"
+#include "exceptions.h"
+#include "tools.h"
+
+#include <cctype>
+#include <cstring>
+#include <strings.h>
+
+using namespace zmm;
+
+// properties that can be searched, the first ones are the text properties
+// kept in the search index
+static const char* searchProperties[] = {
+    "dc:title",
+    "upnp:artist",
+    "upnp:album",
+    "upnp:genre",
+    "upnp:class",
+    "@refID",
+    nullptr
+};
+
+static const struct {
+    const char* name;
+    search_op_t op;
+} searchOperators[] = {
+    { "=", SEARCH_OP_EQUAL },
+    { "!=", SEARCH_OP_NOT_EQUAL },
+    { "<", SEARCH_OP_LESS },
+    { "<=", SEARCH_OP_LESS_EQUAL },
+    { ">", SEARCH_OP_GREATER },
+    { ">=", SEARCH_OP_GREATER_EQUAL },
+    { "contains", SEARCH_OP_CONTAINS },
+    { "doesNotContain", SEARCH_OP_DOES_NOT_CONTAIN },
+    { "derivedfrom", SEARCH_OP_DERIVED_FROM },
+    { "startsWith", SEARCH_OP_STARTS_WITH },
+    { "exists", SEARCH_OP_EXISTS },
+    { nullptr, SEARCH_OP_EQUAL }
+};
+
+static bool isSearchDelimiter(char c)
+{
+    return c == '\0' || isspace((unsigned char)c) || c == '(' || c == ')' || c == '"';
+}
+
+static bool isOperatorChar(char c)
+{
+    return c == '=' || c == '!' || c == '<' || c == '>';
+}
+
+SearchCriteria::SearchCriteria(String criteria)
+{
+    this->criteria = criteria;
+    pos = this->criteria.c_str();
+}
+
+Ref<SearchExpression> SearchCriteria::parse(String criteria)
+{
+    if (criteria == nullptr)
+        criteria = _("");
+    SearchCriteria parser(criteria);
+    parser.skipSpace();
+    if (*parser.pos == '*') {
+        parser.pos++;
+        parser.skipSpace();
+        if (*parser.pos != '\0')
+            parser.error(_("unexpected text after \"*\""));
+        return nullptr;
+    }
+    if (*parser.pos == '\0')
+        parser.error(_("empty search criteria"));
+
+    Ref<SearchExpression> exp = parser.parseOr();
+    parser.skipSpace();
+    if (*parser.pos != '\0')
+        parser.error(_("unexpected text"));
+    return exp;
+}
+
+String SearchCriteria::getCapabilities()
+{
+    Ref<StringBuffer> buf(new StringBuffer());
+    for (int i = 0; searchProperties[i] != nullptr; i++) {
+        if (i > 0)
+            *buf << ',';
+        *buf << searchProperties[i];
+    }
+    return buf->toString();
+}
+
+Ref<SearchExpression> SearchCriteria::parseOr()
+{
+    Ref<SearchExpression> exp = parseAnd();
+    while (peekKeyword("or")) {
+        pos += 2;
+        Ref<SearchExpression> node(new SearchExpression(SEARCH_OR));
+        node->left = exp;
+        node->right = parseAnd();
+        exp = node;
+    }
+    return exp;
+}
+
+Ref<SearchExpression> SearchCriteria::parseAnd()
+{
+    Ref<SearchExpression> exp = parsePrimary();
+    while (peekKeyword("and")) {
+        pos += 3;
+        Ref<SearchExpression> node(new SearchExpression(SEARCH_AND));
+        node->left = exp;
+        node->right = parsePrimary();
+        exp = node;
+    }
+    return exp;
+}
+
+Ref<SearchExpression> SearchCriteria::parsePrimary()
+{
+    skipSpace();
+    if (*pos != '(')
+        return parseRelation();
+    pos++;
+    Ref<SearchExpression> exp = parseOr();
+    skipSpace();
+    if (*pos != ')')
+        error(_("missing \")\""));
+    pos++;
+    return exp;
+}
+
+Ref<SearchExpression> SearchCriteria::parseRelation()
+{
+    String property = nextWord();
+    if (!string_ok(property))
+        error(_("property expected"));
+    bool supported = false;
+    for (int i = 0; searchProperties[i] != nullptr && !supported; i++)
+        supported = (property == searchProperties[i]);
+    if (!supported)
+        error(_("unsupported property ") + property);
+
+    skipSpace();
+    String opName;
+    if (isOperatorChar(*pos)) {
+        const char* start = pos;
+        while (isOperatorChar(*pos))
+            pos++;
+        opName = String(start, pos - start);
+    } else
+        opName = nextWord();
+
+    int i;
+    for (i = 0; searchOperators[i].name != nullptr; i++) {
+        if (strcasecmp(searchOperators[i].name, opName.c_str()) == 0)
+            break;
+    }
+    if (searchOperators[i].name == nullptr)
+        error(_("unknown operator ") + opName);
+
+    Ref<SearchExpression> exp(new SearchExpression(SEARCH_RELATION));
+    exp->property = property;
+    exp->op = searchOperators[i].op;
+
+    if (exp->op == SEARCH_OP_EXISTS) {
+        String value = nextWord();
+        if (strcasecmp(value.c_str(), "true") == 0)
+            exp->value = _("true");
+        else if (strcasecmp(value.c_str(), "false") == 0)
+            exp->value = _("false");
+        else
+            error(_("exists needs true or false"));
+        return exp;
+    }
+
+    if (property == "@refID")
+        error(_("@refID can only be tested with exists"));
+    if (exp->op == SEARCH_OP_DERIVED_FROM && property != "upnp:class")
+        error(_("derivedfrom needs upnp:class"));
+    exp->value = nextQuoted();
+    return exp;
+}
+
+String SearchCriteria::nextWord()
+{
+    skipSpace();
+    const char* start = pos;
+    while (!isSearchDelimiter(*pos) && !isOperatorChar(*pos))
+        pos++;
+    return String(start, pos - start);
+}
+
+String SearchCriteria::nextQuoted()
+{
+    skipSpace();
+    if (*pos != '"')
+        error(_("quoted value expected"));
+    pos++;
+    Ref<StringBuffer> buf(new StringBuffer());
+    while (*pos != '"') {
+        if (*pos == '\0')
+            error(_("unterminated value"));
+        if (*pos == '\\' && (pos[1] == '"' || pos[1] == '\\'))
+            pos++;
+        *buf << *pos++;
+    }
+    pos++;
+    return buf->toString();
+}
+
+void SearchCriteria::skipSpace()
+{
+    while (*pos != '\0' && isspace((unsigned char)*pos))
+        pos++;
+}
+
+bool SearchCriteria::peekKeyword(const char* keyword)
+{
+    skipSpace();
+    size_t len = strlen(keyword);
+    return strncasecmp(pos, keyword, len) == 0 && isSearchDelimiter(pos[len]);
+}
+
+void SearchCriteria::error(String message)
+{
+    throw UpnpException(UPNP_E_INVALID_SEARCH_CRITERIA,
+        _("invalid search criteria: ") + message + " at \"" + pos + "\" in \"" + criteria + '"');
+}
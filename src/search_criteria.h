@@ -0,0 +1,106 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  search_criteria.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file search_criteria.h
+/// \brief Parser for the SearchCriteria argument of the CDS Search action.
+
+#ifndef __SEARCH_CRITERIA_H__
+#define __SEARCH_CRITERIA_H__
+
+#include "zmm/zmmf.h"
+
+typedef enum {
+    SEARCH_AND = 0,
+    SEARCH_OR,
+    SEARCH_RELATION
+} search_node_t;
+
+typedef enum {
+    SEARCH_OP_EQUAL = 0,
+    SEARCH_OP_NOT_EQUAL,
+    SEARCH_OP_LESS,
+    SEARCH_OP_LESS_EQUAL,
+    SEARCH_OP_GREATER,
+    SEARCH_OP_GREATER_EQUAL,
+    SEARCH_OP_CONTAINS,
+    SEARCH_OP_DOES_NOT_CONTAIN,
+    SEARCH_OP_DERIVED_FROM,
+    SEARCH_OP_STARTS_WITH,
+    SEARCH_OP_EXISTS
+} search_op_t;
+
+/// \brief A node of a parsed search criteria, either a logical operator
+/// joining two expressions or a relation on a single property.
+class SearchExpression : public zmm::Object
+{
+public:
+    SearchExpression(search_node_t type)
+    {
+        this->type = type;
+        op = SEARCH_OP_EQUAL;
+    }
+
+    search_node_t type;
+
+    /// \brief operands of SEARCH_AND and SEARCH_OR
+    zmm::Ref<SearchExpression> left;
+    zmm::Ref<SearchExpression> right;
+
+    /// \brief property, operator and value of SEARCH_RELATION, the value
+    /// of SEARCH_OP_EXISTS is "true" or "false"
+    zmm::String property;
+    search_op_t op;
+    zmm::String value;
+};
+
+class SearchCriteria
+{
+public:
+    /// \brief parses a UPnP searchCriteria string
+    /// \return the expression tree, nullptr for "*" which matches everything
+    ///
+    /// Throws an UpnpException with UPNP_E_INVALID_SEARCH_CRITERIA if the
+    /// criteria are malformed or use a property that cannot be searched.
+    static zmm::Ref<SearchExpression> parse(zmm::String criteria);
+
+    /// \brief the searchable properties as CSV, returned as SearchCaps
+    static zmm::String getCapabilities();
+
+protected:
+    SearchCriteria(zmm::String criteria);
+
+    zmm::Ref<SearchExpression> parseOr();
+    zmm::Ref<SearchExpression> parseAnd();
+    zmm::Ref<SearchExpression> parsePrimary();
+    zmm::Ref<SearchExpression> parseRelation();
+
+    zmm::String nextWord();
+    zmm::String nextQuoted();
+    void skipSpace();
+    bool peekKeyword(const char *keyword);
+    void error(zmm::String message);
+
+    zmm::String criteria;
+    const char *pos;
+};
+
+#endif // __SEARCH_CRITERIA_H__
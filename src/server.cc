@@ -264,6 +264,14 @@ void Server::shutdown()
 
     log_debug("now calling upnp finish\n");
     UpnpFinish();
+    Ref<BrowseCache> browseCache = cds->getBrowseCache();
+    if (browseCache != nullptr) {
+        unsigned long long hits = browseCache->getHits();
+        unsigned long long lookups = hits + browseCache->getMisses();
+        log_info("browse cache: %llu hits (%llu%%), %llu misses, %llu evictions, %zu results in %zu bytes\n",
+            hits, lookups > 0 ? hits * 100 / lookups : 0, browseCache->getMisses(),
+            browseCache->getEvictions(), browseCache->getEntryCount(), browseCache->getMemoryUsage());
+    }
     if (storage != nullptr && storage->threadCleanupRequired()) {
         static_cleanup_callback();
     }
@@ -406,6 +414,13 @@ void Server::upnp_subscriptions(Ref<SubscriptionRequest> request)
     }
 }
 
+Ref<BrowseCache> Server::getBrowseCache() const
+{
+    if (cds == nullptr)
+        return nullptr;
+    return cds->getBrowseCache();
+}
+
 // Temp
 void Server::send_subscription_update(zmm::String updateString)
 {
@@ -119,6 +119,10 @@ public:
 
     void send_subscription_update(zmm::String updateString);
 
+    /// \brief Returns the cache of Browse results, nullptr if it is disabled
+    /// or the UPnP portion is not initialized.
+    zmm::Ref<BrowseCache> getBrowseCache() const;
+
 protected:
     static zmm::Ref<Storage> storage;
 
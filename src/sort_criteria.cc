@@ -0,0 +1,199 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  sort_criteria.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file sort_criteria.cc
+
+#include "sort_criteria.h"
+#include "common.h"
+#include "exceptions.h"
+#include "metadata_handler.h"
+#include "tools.h"
+
+#include <cctype>
+#include <cstring>
+
+// numbers are padded to this many digits
+#define SORT_KEY_NUMBER_DIGITS 10
+
+using namespace zmm;
+
+// properties that can be sorted by, indexed by sort_field_t
+static const char* sortProperties[] = {
+    "dc:title",
+    "dc:date",
+    "upnp:artist",
+    "upnp:album",
+    "dc:creator",
+    "upnp:originalTrackNumber"
+};
+
+// articles dropped from the start of a sort key
+static const char* sortArticles[] = { "the ", "a ", "an ", nullptr };
+
+// case folded base letters of U+00C0 to U+00FF, nullptr keeps the character
+static const char* latin1Fold[64] = {
+    "a", "a", "a", "a", "a", "a", "ae", "c",
+    "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", nullptr,
+    "o", "u", "u", "u", "u", "y", "th", "ss",
+    "a", "a", "a", "a", "a", "a", "ae", "c",
+    "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", nullptr,
+    "o", "u", "u", "u", "u", "y", "th", "y"
+};
+
+Ref<SortCriteria> SortCriteria::parse(String sortCriteria)
+{
+    if (!string_ok(sortCriteria))
+        return nullptr;
+
+    Ref<SortCriteria> result(new SortCriteria());
+    Ref<Array<StringBase>> parts = split_string(sortCriteria, ',');
+    for (int i = 0; i < parts->size(); i++) {
+        String part = trim_string(parts->get(i));
+        Criterion criterion;
+        criterion.descending = false;
+        if (part.charAt(0) == '-' || part.charAt(0) == '+') {
+            criterion.descending = (part.charAt(0) == '-');
+            part = part.substring(1);
+        }
+        if (!string_ok(part))
+            throw UpnpException(UPNP_E_INVALID_SORT_CRITERIA, _("invalid sort criteria: ") + sortCriteria);
+
+        int field;
+        for (field = 0; field < SORT_MAX; field++) {
+            if (part == sortProperties[field])
+                break;
+        }
+        // clients often ask for more than the SortCaps, the remaining
+        // properties still order the result
+        if (field == SORT_MAX) {
+            log_debug("ignoring unsupported sort property %s\n", part.c_str());
+            continue;
+        }
+        criterion.field = (sort_field_t)field;
+        result->criteria.push_back(criterion);
+    }
+    if (result->criteria.empty())
+        return nullptr;
+    return result;
+}
+
+String SortCriteria::getCapabilities()
+{
+    Ref<StringBuffer> buf(new StringBuffer());
+    for (int i = 0; i < SORT_MAX; i++) {
+        if (i > 0)
+            *buf << ',';
+        *buf << sortProperties[i];
+    }
+    return buf->toString();
+}
+
+String SortCriteria::makeKey(String text)
+{
+    if (!string_ok(text))
+        return nullptr;
+
+    // fold the case and the accents of Latin-1
+    Ref<StringBuffer> folded(new StringBuffer(text.length()));
+    const unsigned char* p = (const unsigned char*)text.c_str();
+    while (*p) {
+        if (*p < 0x80) {
+            *folded << (char)tolower(*p);
+            p++;
+        } else if (*p == 0xc3 && p[1] >= 0x80 && p[1] <= 0xbf && latin1Fold[p[1] - 0x80] != nullptr) {
+            *folded << latin1Fold[p[1] - 0x80];
+            p += 2;
+        } else
+            *folded << (char)*p++;
+    }
+
+    const char* start = folded->c_str();
+    while (*start && (unsigned char)*start < 0x80 && !isalnum((unsigned char)*start))
+        start++;
+    for (int i = 0; sortArticles[i] != nullptr; i++) {
+        size_t len = strlen(sortArticles[i]);
+        if (strncmp(start, sortArticles[i], len) == 0 && start[len] != '\0') {
+            start += len;
+            break;
+        }
+    }
+
+    // pad numbers so that they compare by value
+    Ref<StringBuffer> key(new StringBuffer(SORT_KEY_MAX_LENGTH));
+    const char* q = start;
+    while (*q && key->length() < SORT_KEY_MAX_LENGTH) {
+        if (!isdigit((unsigned char)*q)) {
+            *key << *q++;
+            continue;
+        }
+        while (*q == '0' && isdigit((unsigned char)q[1]))
+            q++;
+        const char* digits = q;
+        while (isdigit((unsigned char)*q))
+            q++;
+        for (int pad = SORT_KEY_NUMBER_DIGITS - (int)(q - digits); pad > 0; pad--)
+            *key << '0';
+        *key << String(digits, q - digits);
+    }
+
+    // do not cut a multibyte character in half
+    int length = key->length();
+    if (length > SORT_KEY_MAX_LENGTH) {
+        length = SORT_KEY_MAX_LENGTH;
+        while (length > 0 && (key->c_str()[length] & 0xc0) == 0x80)
+            length--;
+    }
+    return String(key->c_str(), length);
+}
+
+String SortCriteria::getKey(sort_field_t field, String title, Ref<Dictionary> metadata)
+{
+    if (field == SORT_TITLE)
+        return makeKey(title);
+    if (metadata == nullptr)
+        return nullptr;
+
+    switch (field) {
+    case SORT_DATE: {
+        // ISO dates sort as they are
+        String date = trim_string(metadata->get(MetadataHandler::getMetaFieldName(M_DATE)));
+        if (!string_ok(date))
+            return nullptr;
+        return date;
+    }
+    case SORT_ARTIST:
+        return makeKey(metadata->get(MetadataHandler::getMetaFieldName(M_ARTIST)));
+    case SORT_ALBUM:
+        return makeKey(metadata->get(MetadataHandler::getMetaFieldName(M_ALBUM)));
+    case SORT_CREATOR: {
+        // the dc:creator rendered for albums
+        String creator = metadata->get(MetadataHandler::getMetaFieldName(M_ALBUMARTIST));
+        if (!string_ok(creator))
+            creator = metadata->get(MetadataHandler::getMetaFieldName(M_ARTIST));
+        return makeKey(creator);
+    }
+    default:
+        return nullptr;
+    }
+}
@@ -0,0 +1,85 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  sort_criteria.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file sort_criteria.h
+/// \brief SortCriteria of the CDS Browse and Search actions and the sort
+/// keys stored with every object.
+
+#ifndef __SORT_CRITERIA_H__
+#define __SORT_CRITERIA_H__
+
+#include <vector>
+
+#include "zmm/zmmf.h"
+#include "dictionary.h"
+
+/// \brief maximum length of a sort key in bytes
+#define SORT_KEY_MAX_LENGTH 255
+
+typedef enum {
+    SORT_TITLE = 0,
+    SORT_DATE,
+    SORT_ARTIST,
+    SORT_ALBUM,
+    SORT_CREATOR,
+    SORT_TRACK,
+
+    SORT_MAX
+} sort_field_t;
+
+class SortCriteria : public zmm::Object
+{
+public:
+    class Criterion
+    {
+    public:
+        sort_field_t field;
+        bool descending;
+    };
+
+    /// \brief the sort keys from first to last
+    std::vector<Criterion> criteria;
+
+    /// \brief parses a UPnP SortCriteria string like "+upnp:artist,-dc:date"
+    /// \return nullptr if the string is empty or names no sortable property
+    ///
+    /// Properties that can not be sorted by are skipped, an empty property
+    /// throws an UpnpException with UPNP_E_INVALID_SORT_CRITERIA.
+    static zmm::Ref<SortCriteria> parse(zmm::String sortCriteria);
+
+    /// \brief the sortable properties as CSV, returned as SortCaps
+    static zmm::String getCapabilities();
+
+    /// \brief the sort key of a text
+    ///
+    /// Letters are case folded and the Latin-1 ones lose their accents,
+    /// leading punctuation and an English article are dropped and numbers
+    /// are zero padded, so that "The 10th" sorts after "2nd" and before
+    /// "Abbey Road".
+    static zmm::String makeKey(zmm::String text);
+
+    /// \brief the stored sort key of an object for a field, nullptr if
+    /// the object lacks the property; SORT_TRACK uses the track number
+    static zmm::String getKey(sort_field_t field, zmm::String title, zmm::Ref<Dictionary> metadata);
+};
+
+#endif // __SORT_CRITERIA_H__
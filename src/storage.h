@@ -40,7 +40,11 @@
 #include "singleton.h"
 #include "cds_objects.h"
 #include "dictionary.h"
+#include "didl_cache.h"
 #include "autoscan.h"
+#include "search_criteria.h"
+#include "sort_criteria.h"
+#include "storage/query_stats.h"
 
 #define BROWSE_DIRECT_CHILDREN      0x00000001
 #define BROWSE_ITEMS                0x00000002
@@ -57,6 +61,7 @@ protected:
     
     int startingIndex;
     int requestedCount;
+    zmm::Ref<SortCriteria> sortCriteria;
     
     // output parameters
     int totalMatches;
@@ -93,6 +98,11 @@ public:
     inline int getStartingIndex() { return startingIndex; }
     inline int getRequestedCount() { return requestedCount; }
     
+    /// \brief nullptr keeps the default order
+    inline void setSortCriteria(zmm::Ref<SortCriteria> sortCriteria)
+    { this->sortCriteria = sortCriteria; }
+    inline zmm::Ref<SortCriteria> getSortCriteria() { return sortCriteria; }
+    
     inline int getTotalMatches() { return totalMatches; }
     
     inline void setTotalMatches(int totalMatches)
@@ -100,6 +110,53 @@ public:
     
 };
 
+class SearchParam : public zmm::Object
+{
+protected:
+    int containerID;
+    zmm::Ref<SearchExpression> criteria;
+    
+    int startingIndex;
+    int requestedCount;
+    zmm::Ref<SortCriteria> sortCriteria;
+    
+    // output parameters
+    int totalMatches;
+    
+public:
+    /// \param criteria parsed search criteria, nullptr matches all objects
+    inline SearchParam(int containerID, zmm::Ref<SearchExpression> criteria)
+    {
+        this->containerID = containerID;
+        this->criteria = criteria;
+        startingIndex = 0;
+        requestedCount = 0;
+        totalMatches = 0;
+    }
+    
+    inline int getContainerID() { return containerID; }
+    inline zmm::Ref<SearchExpression> getCriteria() { return criteria; }
+    
+    inline void setRange(int startingIndex, int requestedCount)
+    {
+        this->startingIndex = startingIndex;
+        this->requestedCount = requestedCount;
+    }
+    
+    inline int getStartingIndex() { return startingIndex; }
+    inline int getRequestedCount() { return requestedCount; }
+    
+    /// \brief nullptr keeps the default order
+    inline void setSortCriteria(zmm::Ref<SortCriteria> sortCriteria)
+    { this->sortCriteria = sortCriteria; }
+    inline zmm::Ref<SortCriteria> getSortCriteria() { return sortCriteria; }
+    
+    inline int getTotalMatches() { return totalMatches; }
+    
+    inline void setTotalMatches(int totalMatches)
+    { this->totalMatches = totalMatches; }
+};
+
 class Storage : public Singleton<Storage, std::mutex>
 {
 public:
@@ -139,6 +196,10 @@ public:
     virtual void updateObject(zmm::Ref<CdsObject> object, int *changedContainer) = 0;
     
     virtual zmm::Ref<zmm::Array<CdsObject> > browse(zmm::Ref<BrowseParam> param) = 0;
+    
+    /// \brief returns the objects below the container of the search that
+    /// match its criteria, ordered by title
+    virtual zmm::Ref<zmm::Array<CdsObject> > search(zmm::Ref<SearchParam> param) = 0;
     virtual zmm::Ref<zmm::Array<zmm::StringBase> > getMimeTypes() = 0;
     
     //virtual zmm::Ref<zmm::Array<CdsObject> > selectObjects(zmm::Ref<SelectParam> param) = 0;
@@ -170,8 +231,17 @@ public:
     virtual zmm::Ref<CdsObject> loadObject(int objectID) = 0;
     virtual int getChildCount(int contId, bool containers = true, bool items = true, bool hideFsRoot = false) = 0;
 
+    /// \brief returns the object id of a folder image that can be used
+    /// as artwork for the given container
+    /// \param id container id
+    /// \param trackArtBase case-folded, extension-less track title to
+    /// prefer as artwork, may be empty
     virtual zmm::String findFolderImage(int id, zmm::String trackArtBase) = 0;
 
+    /// \brief returns the first music track of the given container that
+    /// carries embedded album art, nullptr if there is none
+    virtual zmm::Ref<CdsItem> findEmbeddedArtItem(int id) = 0;
+
     
     class ChangedContainers : public Object
     {
@@ -280,6 +350,22 @@ public:
     
     virtual void threadCleanup() = 0;
     virtual bool threadCleanupRequired() = 0;
+
+    /// \brief returns the query statistics, nullptr if they are disabled
+    virtual zmm::Ref<QueryStats> getQueryStats() = 0;
+
+    /// \brief returns the cache of rendered objects, nullptr if it is
+    /// disabled; the storage drops the fragments of changed objects
+    virtual zmm::Ref<DIDLCache> getDIDLCache() = 0;
+
+    /// \brief counts the changes of the content, everything rendered from
+    /// the objects is outdated once it differs from the value taken before
+    /// they were loaded
+    virtual unsigned long long getContentGeneration() = 0;
+
+    /// \brief returns the query plan of a select as text, nullptr if the
+    /// driver can not explain queries
+    virtual zmm::String explainQuery(zmm::String query) = 0;
     
 protected:
     /* helper for addContainerChain */
@@ -34,8 +34,9 @@
 
 using namespace zmm;
 
-CacheObject::CacheObject()
+CacheObject::CacheObject(int id)
 {
+    this->id = id;
     parentID = INVALID_OBJECT_ID;
     refID = INVALID_OBJECT_ID;
     knowRefID = false;
@@ -72,6 +73,48 @@ void CacheObject::setObject(Ref<CdsObject> obj)
     }
 }
 
+static size_t getDictionarySize(Ref<Dictionary> dict)
+{
+    Ref<Array<DictionaryElement> > elements = dict->getElements();
+    size_t size = sizeof(Dictionary) + sizeof(Array<DictionaryElement>);
+    for (int i = 0; i < elements->size(); i++)
+    {
+        Ref<DictionaryElement> el = elements->get(i);
+        size += sizeof(DictionaryElement) + 2 * sizeof(StringBase)
+            + el->getKey().length() + el->getValue().length();
+    }
+    return size;
+}
+
+size_t CacheObject::getSize()
+{
+    size_t size = sizeof(CacheObject) + location.length();
+    if (obj == nullptr)
+        return size;
+
+    // parts that were not decoded yet are counted with their encoded
+    // length, sizing an object must not decode it
+    size += sizeof(CdsItem) + obj->getTitle().length()
+        + obj->getLocation().length() + obj->getClass().length()
+        + obj->getSerializedSize();
+    if (obj->isMetadataLoaded())
+        size += getDictionarySize(obj->getMetadata());
+    if (obj->isAuxDataLoaded())
+        size += getDictionarySize(obj->getAuxData());
+    if (!obj->areResourcesLoaded())
+        return size;
+    Ref<Array<CdsResource> > resources = obj->getResources();
+    for (int i = 0; i < resources->size(); i++)
+    {
+        Ref<CdsResource> res = resources->get(i);
+        size += sizeof(CdsResource)
+            + getDictionarySize(res->getAttributes())
+            + getDictionarySize(res->getParameters())
+            + getDictionarySize(res->getOptions());
+    }
+    return size;
+}
+
 void CacheObject::debug()
 {
     log_debug("== cache object ==\n");
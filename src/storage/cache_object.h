@@ -39,9 +39,14 @@
 class CacheObject : public zmm::Object
 {
 public:
-    CacheObject();
+    CacheObject(int id);
     
     void debug();
+
+    int getID() { return id; }
+
+    /// \brief estimated memory used by the entry and its object in bytes
+    size_t getSize();
     
     void setParentID(int parentID) { this->parentID = parentID; }
     int getParentID() { return parentID; }
@@ -73,6 +78,7 @@ public:
     
 private:
     
+    int id;
     int parentID;
     int refID;
     bool knowRefID;
@@ -33,81 +33,90 @@
 
 #ifndef __MYSQL_CREATE_SQL_H__
 #define __MYSQL_CREATE_SQL_H__
-#define MS_CREATE_SQL_INFLATED_SIZE 3820
-#define MS_CREATE_SQL_DEFLATED_SIZE 1031
+#define MS_CREATE_SQL_INFLATED_SIZE 4639
+#define MS_CREATE_SQL_DEFLATED_SIZE 1161
 
 /* begin binary data: */
-const unsigned char mysql_create_sql[] = /* 1031 */
-{0x78,0x9C,0xBD,0x57,0x51,0x8F,0x9B,0x38,0x10,0x7E,0xDF,0x5F,0xE1,0x7B,0x82
-,0x54,0xDC,0x2D,0xAC,0xB6,0x52,0x4F,0xD5,0x4A,0xCB,0x11,0xB7,0x8D,0x4A,0x60
-,0x0B,0xE4,0x4E,0xBD,0x17,0xE3,0x80,0xB3,0xE1,0x96,0x40,0x04,0x26,0xBA,0xFC
-,0xFB,0x1B,0x43,0x08,0x10,0x9C,0x34,0x91,0x4E,0x7D,0x49,0x60,0xF8,0xFC,0xF9
-,0xF3,0x78,0x3C,0x9E,0xB9,0x7F,0xF7,0xCB,0xA3,0x6E,0xE8,0x06,0xF2,0x71,0x80
-,0x9E,0x5D,0x7B,0x4A,0xAC,0x2F,0xA6,0x67,0x5A,0x01,0xF6,0x08,0x98,0x88,0x65
-,0xCF,0xB0,0x13,0x3C,0x3D,0x3F,0xCB,0xCC,0xE8,0xDD,0xFD,0xC7,0xBB,0xFB,0x1F
-,0x30,0x78,0xD8,0x5F,0xD8,0x81,0x3F,0xA2,0x38,0xD8,0xCF,0x71,0xB8,0xB6,0x6D
-,0x06,0x33,0xD7,0x81,0x27,0xC7,0xC1,0x96,0x78,0x14,0x14,0x12,0xF3,0x98,0xC1
-,0x31,0xE7,0xD8,0x47,0x15,0x5F,0x7D,0xE8,0xBE,0xE9,0xC6,0x63,0xC7,0xBE,0x70
-,0x66,0xDF,0x16,0x18,0x84,0x62,0xEB,0xAB,0x50,0x36,0x78,0xD7,0xD0,0xF0,0xB3
-,0x7E,0x86,0xE4,0x93,0xEB,0xE1,0xD9,0x67,0x87,0x7C,0xC5,0xDF,0x3B,0xA6,0xB1
-,0x51,0x43,0x12,0xA0,0x7E,0x66,0xD9,0xFE,0x37,0x9B,0xCC,0xDD,0x29,0x06,0xA6
-,0xF6,0x51,0x43,0x47,0xA3,0xE2,0xB8,0xC4,0x5C,0x04,0x2E,0xF9,0xD3,0xB4,0x41
-,0x1F,0x78,0xE1,0x6F,0xEC,0xB9,0x4A,0x8F,0xCB,0x38,0xE1,0x72,0xDC,0x00,0xFB
-,0x07,0xB2,0xFA,0xB9,0x61,0x6B,0xCC,0x8D,0x08,0xCB,0xC3,0x66,0x80,0x51,0x60
-,0xFE,0x61,0x63,0x14,0x6E,0x38,0x89,0xE2,0x92,0xE4,0xCB,0x7F,0x58,0xC4,0x43
-,0xA4,0xDE,0x21,0x14,0x26,0x71,0x88,0x92,0x8C,0xAB,0x86,0x31,0x41,0x30,0x12
-,0x39,0x0B,0xDB,0x46,0xB4,0xE2,0x39,0x49,0xB2,0xA8,0x60,0x1B,0x96,0x71,0x4D
-,0xE0,0x0A,0xB6,0x22,0x7D,0x6C,0xCC,0x56,0xB4,0x4A,0x79,0x8D,0xAF,0x01,0x5B
-,0x5A,0x00,0x96,0x48,0xF9,0x5A,0xB0,0xA2,0x2B,0x35,0xB6,0x51,0x40,0xF8,0x7E
-,0xCB,0x42,0xC4,0x93,0x6C,0x2F,0x46,0x3C,0x4E,0x50,0x95,0x95,0xC9,0x6B,0xC6
-,0xE2,0xE3,0xC8,0x1A,0x5D,0x6D,0xB3,0x2D,0x89,0x52,0x5A,0x96,0x21,0xDA,0xD1
-,0x22,0x5A,0xD3,0x42,0xFD,0xA0,0x4B,0x24,0xC4,0x11,0xE1,0x09,0x4F,0x59,0x07
-,0x7B,0x78,0xFF,0x5E,0x82,0x4B,0xF3,0x88,0xF2,0x24,0xCF,0x42,0xB4,0x4C,0xF3
-,0xE5,0xC0,0x44,0xD6,0xB4,0x5C,0x77,0x2B,0x38,0x0A,0x1A,0x71,0x6C,0x18,0xA7
-,0x31,0xE5,0xB4,0xC7,0x41,0xAB,0x7F,0x4F,0x2C,0x05,0x2B,0xF3,0xAA,0x88,0x58
-,0xD9,0xB3,0x55,0x5B,0x00,0xB1,0xEB,0xFC,0xB4,0x49,0x36,0xEC,0xE0,0xA5,0x76
-,0x45,0x8F,0xB2,0x85,0xAF,0x52,0xFA,0x5A,0x4A,0x54,0x8F,0x89,0x8D,0x86,0x98
-,0x17,0x34,0x7A,0x23,0x59,0xB5,0x59,0xB2,0xE2,0xC2,0x9E,0x96,0xAC,0xD8,0x25
-,0x51,0x23,0xF6,0xA2,0x4B,0x5F,0xBC,0xD9,0xDC,0xF4,0xBE,0x23,0x38,0x05,0x08
-,0xA9,0x22,0xA8,0x26,0xC2,0x2C,0x5E,0xC3,0x2E,0xE4,0x48,0x1B,0x44,0x6A,0x1B
-,0x4E,0x52,0x54,0x2F,0x92,0xD4,0x5E,0x58,0x69,0x83,0xB0,0xD1,0xBA,0xDD,0x96
-,0x92,0x0C,0x42,0x4C,0x1D,0x0C,0xED,0xF0,0xC7,0x5D,0x6F,0x66,0x11,0xC0,0x61
-,0x20,0x68,0xBD,0xF9,0xA5,0xD3,0x0C,0x1D,0xA9,0x0E,0x1D,0x2B,0x1D,0xD1,0xF7
-,0xA9,0xDA,0xF7,0x70,0x8D,0x86,0xCC,0xE7,0x07,0x9E,0x39,0x83,0xFC,0x3B,0x3C
-,0xAE,0x24,0x59,0xAE,0xDE,0x88,0x11,0xB6,0x09,0xA7,0xE6,0xED,0xFC,0x88,0x3C
-,0xFC,0x09,0x7B,0xD8,0xB1,0x20,0x37,0x8E,0xCE,0x79,0xBD,0x1F,0x08,0x92,0xE9
-,0x14,0xDB,0x18,0xD2,0x81,0x65,0xFA,0x96,0x39,0xC5,0xC2,0xB2,0x78,0x99,0x9A
-,0x9D,0xE5,0x0A,0x05,0x0F,0xA7,0x0A,0x7A,0x0E,0xFA,0x7F,0x44,0xDC,0x4D,0x10
-,0x76,0x3E,0xCF,0x1C,0xFC,0x34,0xDF,0xCF,0x7C,0x73,0x8E,0xC4,0xD5,0x02,0x89
-,0xEF,0x49,0xE4,0xFC,0x8F,0x77,0x33,0xC7,0xC7,0x5E,0x80,0x40,0x9F,0x3B,0x9A
-,0xA4,0x4E,0x9D,0x3E,0x52,0x7F,0x35,0xB4,0x3A,0x32,0xE1,0x5F,0x6F,0x9E,0x2E
-,0xFF,0x1C,0x40,0xBF,0x77,0xA6,0xC9,0x75,0x13,0xE9,0xC7,0x79,0x0C,0x4D,0x69
-,0x3E,0xFE,0x16,0xE5,0x19,0xA7,0x49,0xC6,0x0A,0x45,0x53,0xBC,0x3C,0xE7,0xCA
-,0x8D,0xF3,0x1E,0xBC,0x71,0x3A,0xA5,0x48,0xFD,0xC2,0x87,0x4F,0x90,0x1C,0xD0
-,0x5F,0x5F,0xC0,0xCF,0x87,0x57,0x43,0xB9,0x4E,0xAB,0xD1,0xCE,0x29,0x97,0xFA
-,0x62,0xA1,0x69,0x52,0x80,0x35,0x2F,0xF6,0xB7,0x4A,0x96,0x5E,0x33,0x34,0xE2
-,0xC9,0x0E,0x22,0x9B,0xB3,0xCD,0x85,0xBB,0xA6,0xC9,0x9C,0x51,0x93,0x8E,0x07
-,0x39,0x66,0x80,0x28,0x39,0x24,0xCD,0x0B,0x80,0x33,0x09,0x48,0x12,0xCC,0x3D
-,0x59,0x67,0xCE,0xD4,0x4F,0x0B,0xE5,0x91,0xDB,0xC0,0x39,0xAC,0xC8,0x68,0x0A
-,0x49,0x82,0xC3,0xB5,0xF8,0x7A,0xF0,0xDB,0x1B,0xDB,0x0F,0x2F,0x80,0x81,0x6B
-,0x76,0x34,0xAD,0x6E,0x70,0x8D,0x20,0x9B,0xDC,0x78,0xC6,0xC6,0xBA,0xDA,0xA0
-,0x52,0xE2,0x25,0xD9,0xB1,0xA2,0x84,0xED,0x83,0x18,0x7A,0x54,0x64,0xC1,0x20
-,0xAA,0x89,0x32,0xA2,0xD9,0x8D,0x15,0x07,0xB8,0xFB,0x72,0xC5,0x21,0x38,0x49
-,0xCA,0x76,0x2C,0x0D,0x11,0x83,0x94,0xAB,0x2A,0x4B,0x5A,0x26,0x11,0xE8,0x58
-,0x55,0x69,0xAA,0x9C,0x46,0x90,0x40,0x6F,0xF2,0x98,0xB5,0x60,0x0E,0x97,0x6B
-,0x0C,0xE0,0x24,0xCB,0x79,0xB2,0xDA,0x9F,0xE2,0xE1,0x28,0x54,0xB0,0xAE,0xDD
-,0x35,0x15,0xCA,0x3A,0x89,0x63,0x96,0x5D,0x01,0xAC,0x1D,0x09,0x1B,0x76,0x4D
-,0x85,0x01,0x05,0x0F,0x17,0x82,0x93,0x55,0xC2,0xC0,0x0D,0xCB,0xE4,0x55,0x8C
-,0x79,0xD0,0x2F,0x8D,0xD9,0x8A,0xAD,0x28,0x79,0x7D,0x97,0x5D,0x12,0x33,0xAA
-,0x34,0x24,0x25,0xD1,0x96,0xF2,0x35,0x6C,0x40,0xBF,0x76,0xE1,0x79,0x15,0xAD
-,0x85,0x98,0xEB,0xB8,0x9B,0x62,0xA3,0x1F,0x7F,0x61,0x73,0xEB,0xB5,0xC7,0xB3
-,0xA9,0xC5,0x9B,0x2F,0xBD,0x40,0x21,0xED,0xD6,0xAB,0x6D,0x10,0xC8,0x0E,0xF3
-,0x11,0x2D,0x3F,0xC5,0xED,0xC8,0x9F,0x72,0x92,0x07,0xC5,0x7E,0x57,0xE7,0xF7
-,0xAB,0xFE,0x71,0xA3,0x21,0xEB,0x31,0xE4,0xBD,0xC7,0x78,0xEC,0x49,0x93,0x33
-,0xEA,0x7B,0xC6,0x2D,0x88,0xBC,0xF5,0x3B,0xD7,0x14,0xFE,0x68,0xFC,0xB1,0xF1
-,0x3B,0xDB,0x13,0x4A,0x18,0xA4,0x6D,0xDF,0xB9,0x86,0x70,0xDC,0xF8,0xF4,0x7A
-,0x9E,0x41,0x0B,0x54,0x23,0xFF,0x03,0x84,0xD2,0x7F,0xB7};
-/* end binary data. size = 1031 bytes */
+const unsigned char mysql_create_sql[] = /* 1161 */
+{0x78,0x9C,0xBD,0x58,0x51,0x8F,0x9B,0x38,0x10,0x7E,0xDF,0x5F,0xE1,0x7B,0x82
+,0x54,0xE9,0x2D,0xEC,0x6D,0xA5,0x3D,0x55,0x2B,0x2D,0x47,0xDC,0x36,0x2A,0x21
+,0x5B,0x20,0x3D,0xF5,0x5E,0x8C,0x03,0xCE,0xC6,0xB7,0x04,0x22,0x30,0x51,0xF3
+,0xEF,0xCF,0x86,0x10,0x20,0x18,0x96,0x48,0xA7,0xBE,0xEC,0x92,0xF1,0x37,0x1F
+,0x9F,0xC7,0x33,0x78,0xEC,0xDB,0x77,0xBF,0xDD,0x6B,0xBA,0xA6,0x03,0x17,0x7A
+,0xE0,0x69,0x69,0xCD,0x90,0xF9,0xC5,0x70,0x0C,0xD3,0x83,0x0E,0xE2,0x26,0x64
+,0x5A,0x73,0x68,0x7B,0x8F,0x4F,0x4F,0x32,0x33,0x78,0x77,0xFB,0xF1,0xE6,0xF6
+,0x0D,0x06,0x07,0xBA,0x2B,0xCB,0x73,0x3B,0x14,0x27,0x7B,0x1F,0xC7,0xD2,0xB2
+,0x0C,0x6F,0xBE,0xB4,0xF9,0x93,0x6D,0x43,0x53,0x3C,0x0A,0x0A,0x89,0xB9,0xCB
+,0x60,0x1B,0x0B,0xE8,0x82,0x9C,0x6D,0x1E,0xEA,0x31,0x4D,0xBF,0xAF,0xD9,0x57
+,0xF6,0xFC,0xDB,0x0A,0x72,0xA1,0xD0,0xFC,0x2A,0x94,0xB5,0x7E,0x4F,0x41,0x7B
+,0x58,0xEB,0x21,0xF9,0xB4,0x74,0xE0,0xFC,0xB3,0x8D,0xBE,0xC2,0x1F,0x35,0x53
+,0xD7,0x38,0x05,0x12,0xA0,0xD6,0x33,0x6D,0xF7,0x9B,0x85,0x16,0xCB,0x19,0xE4
+,0x4C,0xD5,0xE3,0x14,0x9C,0x8D,0x8A,0xBD,0x44,0xC6,0xCA,0x5B,0xA2,0xEF,0x86
+,0xC5,0xF5,0xF1,0x28,0xFC,0x03,0x9D,0xA5,0xD2,0xE0,0xD2,0x2F,0xB8,0xEC,0xA5
+,0x07,0xDD,0x13,0x59,0xF1,0x5C,0xB2,0x95,0xE6,0x52,0x84,0xE9,0x40,0xC3,0x83
+,0xC0,0x33,0xFE,0xB2,0x20,0xF0,0x77,0x0C,0x05,0x61,0x86,0x92,0xF5,0xBF,0x24
+,0x60,0x3E,0x50,0x6F,0x00,0xF0,0x69,0xE8,0x03,0x1A,0x33,0x55,0xD7,0x27,0x80
+,0x7B,0x02,0x7B,0x65,0x59,0x00,0xE7,0x2C,0x41,0x34,0x0E,0x52,0xB2,0x23,0x31
+,0x9B,0x0A,0x5C,0x4A,0x36,0xA8,0x89,0x0D,0xC9,0x06,0xE7,0x11,0x2B,0xF0,0x05
+,0x60,0x8F,0x53,0x8E,0x45,0x52,0xBE,0x0A,0xAC,0x68,0x4A,0x81,0x2D,0x15,0x20
+,0x76,0xDC,0x13,0x1F,0x30,0x1A,0x1F,0x85,0xC7,0xFD,0x04,0xE4,0x71,0x46,0x5F
+,0x62,0x12,0x9E,0x3D,0x0B,0x74,0xBE,0x8F,0xF7,0x28,0x88,0x70,0x96,0xF9,0xE0
+,0x80,0xD3,0x60,0x8B,0x53,0xF5,0x41,0x93,0x48,0x08,0x03,0xC4,0x28,0x8B,0x48
+,0x0D,0xBB,0xFB,0xF0,0x41,0x82,0x8B,0x92,0x00,0x33,0x9A,0xC4,0x3E,0x58,0x47
+,0xC9,0xBA,0x65,0x42,0x5B,0x9C,0x6D,0xEB,0x19,0x9C,0x05,0x75,0x38,0x76,0x84
+,0xE1,0x10,0x33,0xDC,0xE0,0xC0,0xF9,0xCF,0x0B,0x4B,0x4A,0xB2,0x24,0x4F,0x03
+,0x92,0x35,0x6C,0xF9,0x9E,0x83,0xC8,0xB8,0x38,0xED,0xE8,0x8E,0x9C,0xA2,0x54
+,0xCD,0xE8,0x5E,0x36,0xF1,0x4D,0x84,0x5F,0x32,0x89,0xEA,0x2E,0xB1,0x5E,0x12
+,0xB3,0x14,0x07,0xAF,0x28,0xCE,0x77,0x6B,0x92,0x0E,0xAC,0x69,0x46,0xD2,0x03
+,0x0D,0x4A,0xB1,0xC3,0x21,0x0D,0xB6,0x34,0x0A,0x51,0x90,0xC4,0x0C,0xD3,0x98
+,0xA4,0xD9,0x88,0xC9,0x95,0x2E,0x94,0x91,0xDD,0x18,0x74,0x96,0xA4,0x6C,0xDC
+,0xEA,0x16,0x48,0x11,0xE3,0x1A,0xF8,0xC7,0x5D,0x1F,0x0E,0xA7,0x8C,0x66,0x6C
+,0x14,0x25,0x8E,0xD6,0xF9,0x6E,0x14,0x92,0xD7,0x0D,0x66,0x49,0xFA,0x06,0xF6
+,0xD9,0x99,0x2F,0x0C,0xE7,0x07,0xE0,0x5F,0x0E,0x00,0x54,0x51,0x88,0x13,0x61
+,0x16,0x3F,0xFD,0xBA,0x4C,0x51,0x55,0x78,0x6A,0x55,0x82,0x52,0x54,0xA3,0xFA
+,0xD4,0x46,0x29,0x4E,0x5B,0xA5,0x36,0xAD,0x2B,0x64,0x88,0xE4,0x14,0xE5,0x36
+,0xCF,0xB0,0x67,0xAB,0xA0,0xD5,0xD6,0x4B,0x6B,0xFC,0xB9,0xC6,0x4A,0x5E,0x01
+,0x6C,0x97,0xDD,0xB4,0xF1,0x46,0xE9,0x6B,0xDA,0x69,0xAB,0xB6,0xD3,0x58,0xEA
+,0xD1,0xCC,0x60,0xB5,0x99,0xCF,0x72,0x74,0x23,0xC9,0xDA,0xD3,0x6F,0x8C,0xF4
+,0x7B,0x96,0x49,0x27,0x71,0x2C,0x06,0xFA,0xFD,0xAA,0x24,0x94,0x78,0x9E,0x86
+,0x06,0x7C,0xCB,0xAC,0x94,0xB9,0x16,0x23,0xFD,0x9E,0xE7,0x2C,0x95,0xF8,0x56
+,0x63,0x03,0x51,0x12,0xA1,0xBF,0xF4,0xED,0xAE,0x07,0xDF,0xC9,0x5D,0xCF,0x31
+,0xE6,0xBC,0x9F,0x68,0x6F,0x3F,0x88,0xAE,0x37,0xAF,0x48,0xF7,0xAB,0x0D,0xB4
+,0x78,0x4B,0x9D,0xE3,0xC0,0x81,0x9F,0xA0,0x03,0x6D,0x93,0xEF,0xF5,0x9D,0x7D
+,0xAB,0xA8,0x15,0xC0,0x9B,0x83,0x19,0xB4,0x20,0xDF,0xDE,0x4C,0xC3,0x35,0x8D
+,0x19,0x14,0x96,0xD5,0xF3,0xCC,0xA8,0x2D,0x23,0x14,0xDC,0x5D,0x2A,0x68,0xA4
+,0xE0,0xFF,0x23,0xE2,0x66,0x02,0xA0,0xFD,0x79,0x6E,0xC3,0xC7,0xC5,0x71,0xEE
+,0x1A,0x0B,0x20,0x5A,0x25,0xBE,0x91,0x3F,0x8A,0x1E,0xE6,0xE3,0xCD,0xDC,0x76
+,0xA1,0xE3,0x01,0xAE,0x6F,0xD9,0x79,0x49,0xD1,0x0A,0xB8,0x40,0x7D,0xAF,0x4F
+,0x8B,0xAF,0x06,0xFF,0xAF,0x95,0x4F,0xC3,0x7F,0x4E,0xA0,0x3F,0x5B,0xA6,0x7E
+,0xCF,0xC9,0x38,0x15,0xDA,0x59,0x84,0x3E,0x55,0xCA,0xC1,0xDF,0xCF,0x5F,0x7C
+,0x65,0xAA,0x38,0x49,0xC2,0x94,0xAB,0x44,0x89,0xE9,0x28,0x69,0x9F,0x1B,0x97
+,0x75,0x8A,0xE4,0xA5,0x22,0xD1,0x06,0x89,0xF8,0x3F,0xF2,0xDD,0x01,0xFC,0xFD
+,0x85,0xAF,0xD1,0xE9,0xA7,0xAE,0x8C,0x9B,0x8A,0x5E,0x49,0x92,0xCF,0xE4,0xD9
+,0x04,0x33,0x9A,0x72,0x6B,0x92,0x1E,0xAF,0x9B,0x91,0x08,0xB3,0xB2,0x0F,0x40
+,0x38,0xE8,0x3E,0xE9,0xE9,0xCC,0x70,0xC0,0xE8,0x81,0x14,0x7B,0xE2,0x40,0x7B
+,0x56,0x36,0x1B,0x41,0xD9,0xC1,0xB4,0xB6,0x98,0x16,0x22,0x63,0xAD,0x3D,0xB0
+,0x03,0xE8,0xD9,0x7F,0x24,0xF5,0xD2,0x90,0xD5,0x53,0xB6,0xBF,0xAC,0x5A,0x3A
+,0x61,0xE3,0xC1,0x21,0x69,0x8C,0x23,0xFE,0xA5,0x67,0xBC,0x93,0x7C,0x39,0xC5
+,0xED,0x95,0x1C,0xDB,0x3D,0x53,0x2B,0x34,0x07,0x1C,0xE5,0x57,0x84,0x46,0x90
+,0x4D,0xAE,0x2C,0xE3,0xAE,0xAE,0x2A,0xF7,0x94,0x70,0x8D,0x0E,0xBC,0x45,0xE2
+,0xCB,0xC7,0x53,0xED,0x41,0x91,0x25,0x83,0x68,0xC0,0xB3,0x00,0xC7,0x57,0x36
+,0xE9,0x3C,0xDC,0xC3,0x4D,0xBA,0xE0,0x44,0x11,0x39,0x90,0xC8,0x07,0x84,0x7F
+,0xA7,0x55,0x65,0x8D,0x33,0x1A,0x70,0x1D,0x9B,0x3C,0x8A,0x94,0xCB,0x0C,0x12
+,0xE8,0x5D,0x12,0x92,0x0A,0xCC,0x78,0x3F,0x1A,0x72,0x30,0x8D,0x13,0x46,0x37
+,0xC7,0x4B,0x3C,0x4F,0xF9,0x9C,0xCF,0xEB,0x30,0xA6,0xA9,0xDF,0xD2,0x30,0x24
+,0xF1,0x08,0x60,0x11,0x48,0xBE,0x60,0x63,0x9A,0x72,0x7E,0x46,0x60,0x42,0x30
+,0xDD,0x50,0xC2,0xC3,0xB0,0xA6,0x2F,0xC2,0xE7,0x4E,0x1B,0xF2,0xD9,0x8B,0xA5
+,0xC8,0x58,0xD1,0x90,0x0C,0x89,0xE9,0x74,0xA4,0x92,0x53,0xC4,0x1E,0xB3,0x2D
+,0x5F,0x80,0x66,0xBB,0xCF,0x92,0x3C,0xD8,0x0A,0x31,0xE3,0xB8,0xCB,0xFE,0xBC
+,0x99,0x7F,0x7E,0xD9,0xBA,0x54,0xE5,0x59,0x1E,0x5F,0xCB,0x91,0x46,0xA2,0xA0
+,0x6A,0xE9,0xD5,0x2A,0x09,0x64,0xC5,0x7C,0x46,0xCB,0xAB,0xB8,0xF2,0xFC,0x25
+,0x95,0xDC,0x3A,0x1F,0xD7,0x47,0xE3,0xE6,0x41,0xB9,0x7B,0x36,0x97,0x1D,0xCB
+,0xE5,0xC7,0xF5,0xAE,0xEF,0xC5,0xBD,0x40,0xE7,0xAA,0xA0,0x7B,0x6A,0x97,0xDF
+,0x96,0xF4,0xDD,0xA3,0xBC,0xE5,0x7F,0xBE,0x2B,0xE9,0xBD,0x46,0x91,0x30,0x48
+,0x6F,0x4A,0xFA,0xEE,0x50,0xBA,0x77,0x05,0x8D,0x6B,0x82,0xD6,0xAD,0x41,0x81
+,0xFC,0x0F,0xBD,0xF4,0x94,0x71};
+/* end binary data. size = 1161 bytes */
 
 #endif // __MYSQL_CREATE_SQL_H__
 
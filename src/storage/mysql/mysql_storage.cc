@@ -61,6 +61,40 @@
 #define MYSQL_UPDATE_3_4_2 "ALTER TABLE `mt_cds_object` ADD KEY `cds_object_service_id` (`service_id`)"
 #define MYSQL_UPDATE_3_4_3 "UPDATE `mt_internal_setting` SET `value`='4' WHERE `key`='db_version' AND `value`='3'"
 
+// updates 4->5
+#define MYSQL_UPDATE_4_5_1 "ALTER TABLE `mt_cds_object` ADD KEY `cds_object_parent_title` (`parent_id`,`dc_title`)"
+#define MYSQL_UPDATE_4_5_2 "UPDATE `mt_internal_setting` SET `value`='5' WHERE `key`='db_version' AND `value`='4'"
+
+// updates 5->6, metadata and resources are converted by migrateObjectEncoding()
+#define MYSQL_UPDATE_5_6_1 "UPDATE `mt_internal_setting` SET `value`='6' WHERE `key`='db_version' AND `value`='5'"
+
+// updates 6->7, the counts are filled by repairChildCounts()
+#define MYSQL_UPDATE_6_7_1 "ALTER TABLE `mt_cds_object` ADD `child_containers` int(11) NOT NULL default '0', ADD `child_items` int(11) NOT NULL default '0'"
+#define MYSQL_UPDATE_6_7_2 "UPDATE `mt_internal_setting` SET `value`='7' WHERE `key`='db_version' AND `value`='6'"
+
+// updates 7->8, the keys are filled by migrateSortKeys()
+#define MYSQL_UPDATE_7_8_1 "ALTER TABLE `mt_cds_object` ADD `sort_title` varchar(255) default NULL, ADD `sort_date` varchar(32) default NULL, ADD `sort_artist` varchar(255) default NULL, ADD `sort_album` varchar(255) default NULL, ADD `sort_creator` varchar(255) default NULL"
+#define MYSQL_UPDATE_7_8_2 "ALTER TABLE `mt_cds_object` ADD KEY `cds_object_sort_title` (`parent_id`,`sort_title`), ADD KEY `cds_object_sort_date` (`parent_id`,`sort_date`), ADD KEY `cds_object_sort_artist` (`parent_id`,`sort_artist`), ADD KEY `cds_object_sort_album` (`parent_id`,`sort_album`), ADD KEY `cds_object_sort_creator` (`parent_id`,`sort_creator`), ADD KEY `cds_object_sort_track` (`parent_id`,`track_number`)"
+#define MYSQL_UPDATE_7_8_3 "UPDATE `mt_internal_setting` SET `value`='8' WHERE `key`='db_version' AND `value`='7'"
+
+// search index with a full text index per column
+#define MYSQL_SEARCH_INDEX_DROP "DROP TABLE IF EXISTS `mt_cds_search`"
+#define MYSQL_SEARCH_INDEX_CREATE "CREATE TABLE `mt_cds_search` ( \
+  `id` int(11) NOT NULL, \
+  `title` varchar(255) default NULL, \
+  `artist` text, \
+  `album` text, \
+  `genre` text, \
+  PRIMARY KEY (`id`), \
+  FULLTEXT KEY `cds_search_title` (`title`), \
+  FULLTEXT KEY `cds_search_artist` (`artist`), \
+  FULLTEXT KEY `cds_search_album` (`album`), \
+  FULLTEXT KEY `cds_search_genre` (`genre`) \
+) ENGINE=MyISAM CHARSET=utf8"
+
+// shorter words are not in the full text index (ft_min_word_len)
+#define MYSQL_FULLTEXT_MIN_WORD_LEN 4
+
 using namespace zmm;
 using namespace mxml;
 using namespace std;
@@ -72,7 +106,10 @@ MysqlStorage::MysqlStorage()
     mysql_connection = false;
     table_quote_begin = '`';
     table_quote_end = '`';
+    searchIDColumn = "id";
     insertBuffer = nullptr;
+    readerCount = 0;
+    maxReaders = 0;
 }
 MysqlStorage::~MysqlStorage()
 {
@@ -83,6 +120,11 @@ MysqlStorage::~MysqlStorage()
         mysql_close(&db);
         mysql_connection = false;
     }
+    for (auto reader : idleReaders) {
+        mysql_close(reader);
+        delete reader;
+    }
+    idleReaders.clear();
     log_debug("calling mysql_server_end...\n");
     mysql_server_end();
     log_debug("...ok\n");
@@ -130,41 +172,8 @@ void MysqlStorage::init()
     mysql_server_init(0, nullptr, nullptr);
     pthread_setspecific(mysql_init_key, (void*)1);
 
-    Ref<ConfigManager> config = ConfigManager::getInstance();
-
-    String dbHost = config->getOption(CFG_SERVER_STORAGE_MYSQL_HOST);
-    String dbName = config->getOption(CFG_SERVER_STORAGE_MYSQL_DATABASE);
-    String dbUser = config->getOption(CFG_SERVER_STORAGE_MYSQL_USERNAME);
-    int dbPort = config->getIntOption(CFG_SERVER_STORAGE_MYSQL_PORT);
-    String dbPass = config->getOption(CFG_SERVER_STORAGE_MYSQL_PASSWORD);
-    String dbSock = config->getOption(CFG_SERVER_STORAGE_MYSQL_SOCKET);
-
-    MYSQL* res_mysql;
-
-    res_mysql = mysql_init(&db);
-    if (!res_mysql) {
-        throw _Exception(_("mysql_init failed"));
-    }
-
     mysql_init_key_initialized = true;
-
-    mysql_options(&db, MYSQL_SET_CHARSET_NAME, "utf8");
-
-    my_bool my_bool_var = true;
-    mysql_options(&db, MYSQL_OPT_RECONNECT, &my_bool_var);
-
-    res_mysql = mysql_real_connect(&db,
-        dbHost.c_str(),
-        dbUser.c_str(),
-        (dbPass == nullptr ? nullptr : dbPass.c_str()),
-        dbName.c_str(),
-        dbPort, // port
-        (dbSock == nullptr ? nullptr : dbSock.c_str()), // socket
-        0 // flags
-        );
-    if (!res_mysql) {
-        throw _Exception(_("The connection to the MySQL database has failed: ") + getError(&db));
-    }
+    connect(&db);
 
     /*
     int res = mysql_real_query(&db, MYSQL_SET_NAMES, strlen(MYSQL_SET_NAMES));
@@ -177,6 +186,12 @@ void MysqlStorage::init()
 
     mysql_connection = true;
 
+    maxReaders = ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_MYSQL_READERS);
+
+    // WITH RECURSIVE needs MySQL 8.0 or MariaDB 10.2.2
+    unsigned long serverVersion = mysql_get_server_version(&db);
+    recursiveQueries = serverVersion >= 100202 || (serverVersion >= 80000 && serverVersion < 100000);
+
     String dbVersion = nullptr;
     try {
         dbVersion = getInternalSetting(_("db_version"));
@@ -250,9 +265,43 @@ void MysqlStorage::init()
         dbVersion = _("4");
     }
 
+    if (dbVersion == "4") {
+        log_info("Doing an automatic database upgrade from database version 4 to version 5...\n");
+        _exec(MYSQL_UPDATE_4_5_1);
+        _exec(MYSQL_UPDATE_4_5_2);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("5");
+    }
+
+    if (dbVersion == "5") {
+        log_info("Doing an automatic database upgrade from database version 5 to version 6...\n");
+        migrateObjectEncoding();
+        _exec(MYSQL_UPDATE_5_6_1);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("6");
+    }
+
+    if (dbVersion == "6") {
+        log_info("Doing an automatic database upgrade from database version 6 to version 7...\n");
+        _exec(MYSQL_UPDATE_6_7_1);
+        _exec(MYSQL_UPDATE_6_7_2);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("7");
+    }
+
+    if (dbVersion == "7") {
+        log_info("Doing an automatic database upgrade from database version 7 to version 8...\n");
+        _exec(MYSQL_UPDATE_7_8_1);
+        migrateSortKeys();
+        _exec(MYSQL_UPDATE_7_8_2);
+        _exec(MYSQL_UPDATE_7_8_3);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("8");
+    }
+
     /* --- --- ---*/
 
-    if (!string_ok(dbVersion) || dbVersion != "4")
+    if (!string_ok(dbVersion) || dbVersion != "8")
         throw _Exception(_("The database seems to be from a newer version (database version ") + dbVersion + ")!");
 
     lock.unlock();
@@ -262,6 +311,129 @@ void MysqlStorage::init()
     dbReady();
 }
 
+void MysqlStorage::connect(MYSQL* conn)
+{
+    Ref<ConfigManager> config = ConfigManager::getInstance();
+
+    String dbHost = config->getOption(CFG_SERVER_STORAGE_MYSQL_HOST);
+    String dbName = config->getOption(CFG_SERVER_STORAGE_MYSQL_DATABASE);
+    String dbUser = config->getOption(CFG_SERVER_STORAGE_MYSQL_USERNAME);
+    int dbPort = config->getIntOption(CFG_SERVER_STORAGE_MYSQL_PORT);
+    String dbPass = config->getOption(CFG_SERVER_STORAGE_MYSQL_PASSWORD);
+    String dbSock = config->getOption(CFG_SERVER_STORAGE_MYSQL_SOCKET);
+
+    MYSQL* res_mysql;
+
+    res_mysql = mysql_init(conn);
+    if (!res_mysql) {
+        throw _Exception(_("mysql_init failed"));
+    }
+
+    mysql_options(conn, MYSQL_SET_CHARSET_NAME, "utf8");
+
+    my_bool my_bool_var = true;
+    mysql_options(conn, MYSQL_OPT_RECONNECT, &my_bool_var);
+
+    res_mysql = mysql_real_connect(conn,
+        dbHost.c_str(),
+        dbUser.c_str(),
+        (dbPass == nullptr ? nullptr : dbPass.c_str()),
+        dbName.c_str(),
+        dbPort, // port
+        (dbSock == nullptr ? nullptr : dbSock.c_str()), // socket
+        0 // flags
+        );
+    if (!res_mysql) {
+        String myError = getError(conn);
+        mysql_close(conn);
+        throw _Exception(_("The connection to the MySQL database has failed: ") + myError);
+    }
+}
+
+MYSQL* MysqlStorage::acquireReader()
+{
+    ReaderLock lock(readerMutex);
+    // a transaction must see its own writes, so it stays on the writer
+    if (maxReaders <= 0 || transactionThread == std::this_thread::get_id())
+        return nullptr;
+
+    if (!idleReaders.empty()) {
+        MYSQL* reader = idleReaders.back();
+        idleReaders.pop_back();
+        return reader;
+    }
+    // all readers are busy, the writer serves the query instead of waiting
+    // so a thread holding a result can never block on itself
+    if (readerCount >= maxReaders)
+        return nullptr;
+
+    auto* reader = new MYSQL;
+    try {
+        connect(reader);
+    } catch (const Exception& e) {
+        delete reader;
+        log_warning("could not open MySQL reader connection: %s\n", e.getMessage().c_str());
+        maxReaders = readerCount;
+        return nullptr;
+    }
+    readerCount++;
+    log_debug("opened MySQL reader connection %d of %d\n", readerCount, maxReaders);
+    return reader;
+}
+
+void MysqlStorage::releaseReader(MYSQL* conn)
+{
+    ReaderLock lock(readerMutex);
+    idleReaders.push_back(conn);
+}
+
+// the writer connection is held for the whole transaction, statements of
+// other threads, like the BEGIN of a flushed insert buffer, would join or
+// commit it otherwise
+void MysqlStorage::beginTransaction()
+{
+    mysqlMutex.lock();
+    {
+        ReaderLock lock(readerMutex);
+        transactionThread = std::this_thread::get_id();
+    }
+    try {
+        SQLStorage::beginTransaction();
+    } catch (const Exception&) {
+        endTransaction();
+        throw;
+    }
+}
+
+// a failed commit is followed by a rollback, which releases the connection
+void MysqlStorage::commitTransaction()
+{
+    SQLStorage::commitTransaction();
+    endTransaction();
+}
+
+void MysqlStorage::rollbackTransaction()
+{
+    try {
+        SQLStorage::rollbackTransaction();
+    } catch (const Exception&) {
+        endTransaction();
+        throw;
+    }
+    endTransaction();
+}
+
+void MysqlStorage::endTransaction()
+{
+    {
+        ReaderLock lock(readerMutex);
+        if (transactionThread != std::this_thread::get_id())
+            return;
+        transactionThread = std::thread::id();
+    }
+    mysqlMutex.unlock();
+}
+
 String MysqlStorage::quote(String value)
 {
     /* note: mysql_real_escape_string returns a maximum of (length * 2 + 1)
@@ -297,6 +469,29 @@ Ref<SQLResult> MysqlStorage::select(const char* query, int length)
     int res;
 
     checkMysqlThreadInit();
+
+    auto start = std::chrono::steady_clock::now();
+    MYSQL* reader = acquireReader();
+    if (reader) {
+        // rows are streamed, the reader stays checked out until the result is released
+        MYSQL_RES* mysql_res = nullptr;
+        res = mysql_real_query(reader, query, length);
+        if (!res)
+            mysql_res = mysql_use_result(reader);
+        if (!mysql_res) {
+            String myError = getError(reader);
+            releaseReader(reader);
+            throw _StorageException(myError, _("Mysql: select on reader connection failed: ") + myError + "; query: " + query);
+        }
+        auto* result = new MysqlResult(mysql_res, this, reader);
+        // the rows are known when the result is released
+        if (queryStats != nullptr) {
+            result->query = String(query, length);
+            result->micros = QueryStats::elapsedMicros(start);
+        }
+        return Ref<SQLResult>(result);
+    }
+
     AutoLock lock(mysqlMutex);
     res = mysql_real_query(&db, query, length);
     if (res) {
@@ -310,6 +505,8 @@ Ref<SQLResult> MysqlStorage::select(const char* query, int length)
         String myError = getError(&db);
         throw _StorageException(myError, _("Mysql: mysql_store_result() failed: ") + myError + "; query: " + query);
     }
+    if (queryStats != nullptr)
+        queryStats->record(query, length, QueryStats::elapsedMicros(start), mysql_num_rows(mysql_res));
     return Ref<SQLResult>(new MysqlResult(mysql_res));
 }
 
@@ -323,12 +520,15 @@ int MysqlStorage::exec(const char* query, int length, bool getLastInsertId)
     int res;
 
     checkMysqlThreadInit();
+    auto start = std::chrono::steady_clock::now();
     AutoLock lock(mysqlMutex);
     res = mysql_real_query(&db, query, length);
     if (res) {
         String myError = getError(&db);
         throw _StorageException(myError, _("Mysql: mysql_real_query() failed: ") + myError + "; query: " + query);
     }
+    if (queryStats != nullptr)
+        queryStats->record(query, length, QueryStats::elapsedMicros(start), 0);
     int insert_id = -1;
     if (getLastInsertId)
         insert_id = mysql_insert_id(&db);
@@ -351,6 +551,30 @@ void MysqlStorage::storeInternalSetting(String key, String value)
     SQLStorage::exec(q);
 }
 
+void MysqlStorage::createSearchIndex()
+{
+    exec(MYSQL_SEARCH_INDEX_DROP, strlen(MYSQL_SEARCH_INDEX_DROP));
+    exec(MYSQL_SEARCH_INDEX_CREATE, strlen(MYSQL_SEARCH_INDEX_CREATE));
+}
+
+String MysqlStorage::searchMatch(String column, const std::vector<String>& words)
+{
+    Ref<StringBuffer> against(new StringBuffer());
+    for (String word : words) {
+        if (word.length() < MYSQL_FULLTEXT_MIN_WORD_LEN)
+            continue;
+        if (against->length() > 0)
+            *against << ' ';
+        *against << '+' << word << '*';
+    }
+    if (against->length() == 0)
+        return nullptr;
+    Ref<StringBuffer> match(new StringBuffer());
+    *match << "MATCH(" << QTB << column << QTE << ") AGAINST ("
+           << quote(against->toString()) << " IN BOOLEAN MODE)";
+    return match->toString();
+}
+
 void MysqlStorage::_exec(const char* query, int length)
 {
     if (mysql_real_query(&db, query, (length > 0 ? length : strlen(query)))) {
@@ -387,14 +611,22 @@ void MysqlStorage::_flushInsertBuffer()
 
 /* MysqlResult */
 
-MysqlResult::MysqlResult(MYSQL_RES* mysql_res)
+MysqlResult::MysqlResult(MYSQL_RES* mysql_res, MysqlStorage* storage, MYSQL* reader)
     : SQLResult()
 {
     this->mysql_res = mysql_res;
+    this->storage = storage;
+    this->reader = reader;
+    micros = 0;
     nullRead = false;
 }
 
 MysqlResult::~MysqlResult()
+{
+    finish();
+}
+
+void MysqlResult::finish()
 {
     if (mysql_res) {
         if (!nullRead) {
@@ -402,9 +634,15 @@ MysqlResult::~MysqlResult()
             while ((mysql_row = mysql_fetch_row(mysql_res)) != nullptr)
                 ; // read out data
         }
+        if (query != nullptr)
+            storage->queryStats->record(query.c_str(), query.length(), micros, mysql_num_rows(mysql_res));
         mysql_free_result(mysql_res);
         mysql_res = nullptr;
     }
+    if (reader) {
+        storage->releaseReader(reader);
+        reader = nullptr;
+    }
 }
 
 Ref<SQLRow> MysqlResult::nextRow()
@@ -415,8 +653,7 @@ Ref<SQLRow> MysqlResult::nextRow()
         return Ref<SQLRow>(new MysqlRow(mysql_row, Ref<SQLResult>(this)));
     }
     nullRead = true;
-    mysql_free_result(mysql_res);
-    mysql_res = nullptr;
+    finish();
     return nullptr;
 }
 
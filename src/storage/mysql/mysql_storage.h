@@ -38,11 +38,14 @@
 #include "storage/sql_storage.h"
 #include <mutex>
 #include <mysql.h>
+#include <thread>
+#include <vector>
 
 class MysqlStorage : private SQLStorage {
 private:
     MysqlStorage();
     friend zmm::Ref<Storage> Storage::createInstance();
+    friend class MysqlResult;
     virtual ~MysqlStorage();
     virtual void init();
     virtual void shutdownDriver();
@@ -61,10 +64,41 @@ private:
 
     void _exec(const char* query, int lenth = -1);
 
+    /// \brief the writer connection, also serves selects if no reader is free
     MYSQL db;
 
     bool mysql_connection;
 
+    /// \brief initializes conn and connects it with the configured parameters
+    void connect(MYSQL* conn);
+
+    /// \brief idle read connections, a reader is checked out by a thread
+    /// until the streamed result is read or released
+    std::vector<MYSQL*> idleReaders;
+    int readerCount;
+    int maxReaders;
+    std::mutex readerMutex;
+    using ReaderLock = std::lock_guard<decltype(readerMutex)>;
+
+    /// \brief the thread with an open transaction on the writer connection,
+    /// it holds mysqlMutex until the transaction ends
+    std::thread::id transactionThread;
+
+    /// \brief returns an idle reader or opens a new one while the pool
+    /// is not full, nullptr if the writer connection has to be used
+    MYSQL* acquireReader();
+    void releaseReader(MYSQL* conn);
+
+    virtual void beginTransaction() override;
+    virtual void commitTransaction() override;
+    virtual void rollbackTransaction() override;
+    /// \brief releases the writer connection after a transaction
+    void endTransaction();
+
+    virtual zmm::String getSearchIndexType() override { return _("fulltext"); }
+    virtual void createSearchIndex() override;
+    virtual zmm::String searchMatch(zmm::String column, const std::vector<zmm::String>& words) override;
+
     zmm::String getError(MYSQL* db);
 
     std::recursive_mutex mysqlMutex;
@@ -86,11 +120,20 @@ private:
 class MysqlResult : private SQLResult {
 private:
     int nullRead;
-    MysqlResult(MYSQL_RES* mysql_res);
+    /// \param reader the reader connection of a streamed result, it is
+    /// returned to the pool when the result is released
+    MysqlResult(MYSQL_RES* mysql_res, MysqlStorage* storage = nullptr, MYSQL* reader = nullptr);
     virtual ~MysqlResult();
     virtual zmm::Ref<SQLRow> nextRow();
-    virtual unsigned long long getNumRows() { return mysql_num_rows(mysql_res); }
+    /// \brief for streamed results only the rows read so far
+    virtual unsigned long long getNumRows() { return mysql_res ? mysql_num_rows(mysql_res) : 0; }
+    void finish();
     MYSQL_RES* mysql_res;
+    MysqlStorage* storage;
+    MYSQL* reader;
+    /// \brief query and latency of a streamed result, recorded on release
+    zmm::String query;
+    long long micros;
 
     friend class MysqlRow;
     friend class MysqlStorage;
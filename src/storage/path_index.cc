@@ -0,0 +1,174 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  path_index.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file path_index.cc
+
+#include "path_index.h"
+
+using namespace zmm;
+using namespace std;
+
+PathIndex::PathIndex() : root(nullptr)
+{
+}
+
+int PathIndex::find(String dbLocation)
+{
+    if (dbLocation.length() < 2)
+        return INVALID_OBJECT_ID;
+
+    char prefix = dbLocation.charAt(0);
+    const char *path = dbLocation.c_str() + 1;
+    const char *end = dbLocation.c_str() + dbLocation.length();
+
+    AutoLock lock(mutex);
+    if (prefix == LOC_DIR_PREFIX) {
+        Node *node = walk(path, end, false);
+        return node == nullptr ? INVALID_OBJECT_ID : node->id;
+    }
+    if (prefix == LOC_FILE_PREFIX) {
+        const char *name = end;
+        while (name > path && *(name - 1) != DIR_SEPARATOR)
+            name--;
+        Node *node = walk(path, name, false);
+        if (node == nullptr)
+            return INVALID_OBJECT_ID;
+        auto it = node->files.find(string(name, end - name));
+        return it == node->files.end() ? INVALID_OBJECT_ID : it->second;
+    }
+    return INVALID_OBJECT_ID;
+}
+
+void PathIndex::add(String dbLocation, int id)
+{
+    if (dbLocation.length() < 2)
+        return;
+
+    char prefix = dbLocation.charAt(0);
+    if (prefix != LOC_DIR_PREFIX && prefix != LOC_FILE_PREFIX)
+        return;
+    const char *path = dbLocation.c_str() + 1;
+    const char *end = dbLocation.c_str() + dbLocation.length();
+
+    AutoLock lock(mutex);
+    removeEntry(id);
+
+    Entry entry;
+    if (prefix == LOC_DIR_PREFIX) {
+        Node *node = walk(path, end, true);
+        if (node->id != INVALID_OBJECT_ID)
+            return;
+        node->id = id;
+        entry.node = node;
+        entry.file = nullptr;
+    } else {
+        const char *name = end;
+        while (name > path && *(name - 1) != DIR_SEPARATOR)
+            name--;
+        if (name == end)
+            return;
+        Node *node = walk(path, name, true);
+        auto res = node->files.emplace(string(name, end - name), id);
+        if (!res.second)
+            return;
+        entry.node = node;
+        entry.file = &res.first->first;
+    }
+    ids[id] = entry;
+}
+
+void PathIndex::remove(int id)
+{
+    AutoLock lock(mutex);
+    removeEntry(id);
+}
+
+void PathIndex::clear()
+{
+    AutoLock lock(mutex);
+    ids.clear();
+    root.dirs.clear();
+    root.files.clear();
+    root.id = INVALID_OBJECT_ID;
+}
+
+size_t PathIndex::size()
+{
+    AutoLock lock(mutex);
+    return ids.size();
+}
+
+/* protected */
+
+PathIndex::Node *PathIndex::walk(const char *path, const char *end, bool create)
+{
+    Node *node = &root;
+    while (path < end) {
+        const char *sep = path;
+        while (sep < end && *sep != DIR_SEPARATOR)
+            sep++;
+        if (sep > path) {
+            string name(path, sep - path);
+            auto it = node->dirs.find(name);
+            if (it != node->dirs.end())
+                node = it->second.get();
+            else if (create) {
+                Node *child = new Node(node);
+                node->dirs.emplace(name, unique_ptr<Node>(child));
+                node = child;
+            } else
+                return nullptr;
+        }
+        path = sep + 1;
+    }
+    return node;
+}
+
+void PathIndex::removeEntry(int id)
+{
+    auto it = ids.find(id);
+    if (it == ids.end())
+        return;
+
+    Node *node = it->second.node;
+    if (it->second.file != nullptr) {
+        // the name is the key of the element that is erased
+        string name = *it->second.file;
+        node->files.erase(name);
+    }
+    else
+        node->id = INVALID_OBJECT_ID;
+    ids.erase(it);
+
+    // drop directories that hold nothing anymore
+    while (node->parent != nullptr && node->id == INVALID_OBJECT_ID
+        && node->dirs.empty() && node->files.empty()) {
+        Node *parent = node->parent;
+        for (auto dir = parent->dirs.begin(); dir != parent->dirs.end(); ++dir) {
+            if (dir->second.get() == node) {
+                parent->dirs.erase(dir);
+                break;
+            }
+        }
+        node = parent;
+    }
+}
@@ -0,0 +1,95 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  path_index.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file path_index.h
+
+#ifndef __PATH_INDEX_H__
+#define __PATH_INDEX_H__
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "zmm/zmmf.h"
+#include "common.h"
+
+/// \brief Maps the locations of directory containers and file items to
+/// their object IDs.
+///
+/// Locations are stored as a tree of path components, so the common
+/// directory part of all files is kept only once. Only locations with the
+/// LOC_DIR_PREFIX or LOC_FILE_PREFIX prefix are indexed.
+class PathIndex : public zmm::Object
+{
+public:
+    PathIndex();
+
+    /// \brief returns the object ID for the prefixed location,
+    /// INVALID_OBJECT_ID if it is not indexed
+    int find(zmm::String dbLocation);
+
+    /// \brief indexes a prefixed location, replaces the location the object
+    /// had so far; the first object stays if two have the same location
+    void add(zmm::String dbLocation, int id);
+
+    /// \brief removes the location of the object
+    void remove(int id);
+
+    void clear();
+
+    /// \brief number of indexed objects
+    size_t size();
+
+protected:
+    class Node
+    {
+    public:
+        Node(Node *parent) { this->parent = parent; id = INVALID_OBJECT_ID; }
+        Node *parent;
+        /// \brief id of the directory container
+        int id;
+        std::unordered_map<std::string, std::unique_ptr<Node> > dirs;
+        std::unordered_map<std::string, int> files;
+    };
+
+    class Entry
+    {
+    public:
+        Node *node;
+        /// \brief name of the file in node, nullptr for the directory itself
+        const std::string *file;
+    };
+
+    /// \brief walks down the directories of path, creates missing nodes if
+    /// create is set, returns nullptr if one is missing otherwise
+    Node *walk(const char *path, const char *end, bool create);
+
+    void removeEntry(int id);
+
+    Node root;
+    std::unordered_map<int, Entry> ids;
+    std::mutex mutex;
+    using AutoLock = std::lock_guard<std::mutex>;
+};
+
+#endif // __PATH_INDEX_H__
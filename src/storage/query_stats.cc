@@ -0,0 +1,217 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  query_stats.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file query_stats.cc
+
+#include "query_stats.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+
+// number of distinct query shapes, all further ones are counted together
+#define QUERY_STATS_MAX_SHAPES 1000
+#define QUERY_STATS_OTHER_SHAPE "(other)"
+
+// number of slow queries kept
+#define QUERY_STATS_SLOW_LOG_SIZE 50
+
+using namespace zmm;
+
+QueryStats::Histogram::Histogram()
+{
+    count = 0;
+    rows = 0;
+    totalMicros = 0;
+    maxMicros = 0;
+    memset(buckets, 0, sizeof(buckets));
+}
+
+long long QueryStats::Histogram::percentile(int percent)
+{
+    unsigned long long needed = (count * percent + 99) / 100;
+    unsigned long long seen = 0;
+    for (int i = 0; i < QUERY_STATS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= needed)
+            return std::min(1LL << i, maxMicros);
+    }
+    return maxMicros;
+}
+
+QueryStats::QueryStats(int slowQueryMillis)
+    : Object()
+{
+    slowQueryMicros = slowQueryMillis * 1000LL;
+    nextSlowQueryID = 0;
+}
+
+void QueryStats::record(const char* query, int length, long long micros, unsigned long long rows)
+{
+    if (length < 0)
+        length = strlen(query);
+    // the plans requested for the slow query log are not interesting
+    if (length >= 7 && strncasecmp(query, "EXPLAIN", 7) == 0)
+        return;
+
+    std::string key = fingerprint(query, length);
+
+    AutoLock lock(mutex);
+    auto it = shapes.find(key);
+    if (it == shapes.end()) {
+        if (shapes.size() >= QUERY_STATS_MAX_SHAPES)
+            key = QUERY_STATS_OTHER_SHAPE;
+        it = shapes.emplace(key, Histogram()).first;
+    }
+    Histogram& h = it->second;
+    h.count++;
+    h.rows += rows;
+    h.totalMicros += micros;
+    if (micros > h.maxMicros)
+        h.maxMicros = micros;
+    int bucket = 0;
+    while (bucket < QUERY_STATS_BUCKETS - 1 && (1LL << bucket) <= micros)
+        bucket++;
+    h.buckets[bucket]++;
+
+    if (slowQueryMicros > 0 && micros >= slowQueryMicros) {
+        SlowQuery slow;
+        slow.id = nextSlowQueryID++;
+        slow.time = time(nullptr);
+        slow.micros = micros;
+        slow.rows = rows;
+        slow.query.assign(query, length);
+        slowQueries.push_front(slow);
+        if (slowQueries.size() > QUERY_STATS_SLOW_LOG_SIZE)
+            slowQueries.pop_back();
+    }
+}
+
+void QueryStats::reset()
+{
+    AutoLock lock(mutex);
+    shapes.clear();
+    slowQueries.clear();
+}
+
+std::vector<QueryStats::Shape> QueryStats::getShapes()
+{
+    std::vector<Shape> result;
+    AutoLock lock(mutex);
+    result.reserve(shapes.size());
+    for (auto& entry : shapes) {
+        Histogram& h = entry.second;
+        Shape shape;
+        shape.fingerprint = entry.first;
+        shape.count = h.count;
+        shape.rows = h.rows;
+        shape.totalMicros = h.totalMicros;
+        shape.maxMicros = h.maxMicros;
+        shape.p50Micros = h.percentile(50);
+        shape.p99Micros = h.percentile(99);
+        result.push_back(shape);
+    }
+    std::sort(result.begin(), result.end(), [](const Shape& a, const Shape& b) {
+        return a.totalMicros > b.totalMicros;
+    });
+    return result;
+}
+
+std::vector<QueryStats::SlowQuery> QueryStats::getSlowQueries()
+{
+    AutoLock lock(mutex);
+    return std::vector<SlowQuery>(slowQueries.begin(), slowQueries.end());
+}
+
+void QueryStats::setPlan(unsigned long id, String plan)
+{
+    AutoLock lock(mutex);
+    for (auto& slow : slowQueries) {
+        if (slow.id == id) {
+            slow.plan = plan;
+            return;
+        }
+    }
+}
+
+std::string QueryStats::fingerprint(const char* query, int length)
+{
+    std::string out;
+    out.reserve(length);
+    const char* end = query + length;
+    const char* p = query;
+    while (p < end) {
+        char c = *p;
+        bool literal = false;
+        if (isspace((unsigned char)c)) {
+            if (!out.empty() && out.back() != ' ')
+                out += ' ';
+            p++;
+            continue;
+        } else if (c == '\'') {
+            // string literal, '' and \' do not end it
+            p++;
+            while (p < end) {
+                if (*p == '\\' && p + 1 < end)
+                    p += 2;
+                else if (*p == '\'' && p + 1 < end && p[1] == '\'')
+                    p += 2;
+                else if (*p++ == '\'')
+                    break;
+            }
+            literal = true;
+        } else if (isdigit((unsigned char)c) && (out.empty() || !(isalnum((unsigned char)out.back()) || out.back() == '_' || out.back() == '`'))) {
+            while (p < end && (isalnum((unsigned char)*p) || *p == '.'))
+                p++;
+            literal = true;
+        } else if (c == '?') {
+            p++;
+            literal = true;
+        }
+
+        if (!literal) {
+            out += c;
+            p++;
+            continue;
+        }
+
+        // collapse "?, ?, ?" into a single "?"
+        size_t pos = out.size();
+        while (pos > 0 && out[pos - 1] == ' ')
+            pos--;
+        if (pos > 0 && out[pos - 1] == ',') {
+            pos--;
+            while (pos > 0 && out[pos - 1] == ' ')
+                pos--;
+            if (pos > 0 && out[pos - 1] == '?') {
+                out.resize(pos);
+                continue;
+            }
+        }
+        out += '?';
+    }
+    if (!out.empty() && out.back() == ' ')
+        out.pop_back();
+    return out;
+}
@@ -0,0 +1,123 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  query_stats.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file query_stats.h
+
+#ifndef __QUERY_STATS_H__
+#define __QUERY_STATS_H__
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "zmm/zmmf.h"
+
+/// \brief number of latency buckets, bucket i counts queries that took
+/// less than 2^i microseconds
+#define QUERY_STATS_BUCKETS 28
+
+/// \brief Latency histograms per query shape and a log of slow queries.
+///
+/// Queries are grouped by their fingerprint, the query text with all
+/// literals replaced by "?" and lists of them collapsed into one.
+class QueryStats : public zmm::Object
+{
+public:
+    /// \param slowQueryMillis queries taking at least this long are logged,
+    /// 0 disables the slow query log
+    QueryStats(int slowQueryMillis);
+
+    /// \brief adds an executed query
+    /// \param micros time the query took in microseconds
+    /// \param rows number of rows returned
+    void record(const char *query, int length, long long micros, unsigned long long rows);
+
+    /// \brief drops all collected data
+    void reset();
+
+    class Shape
+    {
+    public:
+        std::string fingerprint;
+        unsigned long long count;
+        unsigned long long rows;
+        long long totalMicros;
+        long long maxMicros;
+        /// \brief upper bounds of the buckets containing the percentiles
+        long long p50Micros;
+        long long p99Micros;
+    };
+
+    class SlowQuery
+    {
+    public:
+        unsigned long id;
+        time_t time;
+        long long micros;
+        unsigned long long rows;
+        std::string query;
+        /// \brief query plan, nullptr until it was explained
+        zmm::String plan;
+    };
+
+    /// \brief all query shapes, the ones with the highest total time first
+    std::vector<Shape> getShapes();
+
+    /// \brief the latest slow queries, newest first
+    std::vector<SlowQuery> getSlowQueries();
+
+    /// \brief stores the query plan of a logged slow query
+    void setPlan(unsigned long id, zmm::String plan);
+
+    static std::string fingerprint(const char *query, int length);
+
+    /// \brief microseconds elapsed since start
+    static long long elapsedMicros(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+protected:
+    class Histogram
+    {
+    public:
+        Histogram();
+        unsigned long long count;
+        unsigned long long rows;
+        long long totalMicros;
+        long long maxMicros;
+        unsigned long long buckets[QUERY_STATS_BUCKETS];
+        long long percentile(int percent);
+    };
+
+    long long slowQueryMicros;
+    std::unordered_map<std::string, Histogram> shapes;
+    std::deque<SlowQuery> slowQueries;
+    unsigned long nextSlowQueryID;
+    std::mutex mutex;
+    using AutoLock = std::lock_guard<std::mutex>;
+};
+
+#endif // __QUERY_STATS_H__
@@ -32,9 +32,11 @@
 #include "sql_storage.h"
 #include "config_manager.h"
 #include "filesystem.h"
+#include "metadata_handler.h"
 #include "string_converter.h"
 #include "tools.h"
 #include "update_manager.h"
+#include <algorithm>
 #include <climits>
 
 using namespace zmm;
@@ -42,10 +44,33 @@ using namespace std;
 
 #define MAX_REMOVE_SIZE 10000
 #define MAX_REMOVE_RECURSION 500
+#define REMOVE_BATCH_IDS 5000
+
+// number of containers a browse cursor is kept for
+#define BROWSE_CURSOR_MAXFILL 1009u
+
+// pending container update ids are written back when this many are
+// waiting or when the oldest write back is this old
+#define UPDATE_ID_FLUSH_COUNT 1000
+#define UPDATE_ID_FLUSH_INTERVAL 30000 // ms
+#define UPDATE_ID_FLUSH_BATCH 500
+
+// number of placeholders of the statement reading stored update ids
+#define UPDATE_ID_SELECT_BATCH 32
 
 #define SQL_NULL "NULL"
 
-#define RESOURCE_SEP '|'
+// number of objects converted per transaction by migrateObjectEncoding()
+#define MIGRATE_ENCODING_BATCH 1000
+
+// objects written to the search index per transaction when it is rebuilt
+#define SEARCH_INDEX_BATCH 1000
+
+// maximum number of objects returned by a search without RequestedCount
+#define SEARCH_MAX_RESULTS 10000
+
+// objects given sort keys per transaction by migrateSortKeys()
+#define SORT_KEY_BATCH 1000
 
 enum {
     _id = 0,
@@ -64,6 +89,8 @@ enum {
     _flags,
     _track_number,
     _service_id,
+    _child_containers,
+    _child_items,
     _ref_upnp_class,
     _ref_location,
     _ref_metadata,
@@ -74,6 +101,61 @@ enum {
     _as_persistent
 };
 
+/* searchable text properties and their columns in the search index */
+static const struct {
+    const char* property;
+    const char* column;
+    metadata_fields_t field;
+} searchColumns[] = {
+    { "dc:title", "title", M_TITLE },
+    { "upnp:artist", "artist", M_ARTIST },
+    { "upnp:album", "album", M_ALBUM },
+    { "upnp:genre", "genre", M_GENRE },
+    { nullptr, nullptr, M_MAX }
+};
+
+/* columns holding the sort keys, indexed by sort_field_t */
+static const char* sortColumns[] = {
+    "sort_title",
+    "sort_date",
+    "sort_artist",
+    "sort_album",
+    "sort_creator",
+    "track_number"
+};
+
+/* SQL for the comparing search operators, indexed by search_op_t */
+static const char* searchOperators[] = { "=", "<>", "<", "<=", ">", ">=" };
+
+/* escapes a value for LIKE ... ESCAPE '!' */
+static String searchLikeEscape(String value)
+{
+    Ref<StringBuffer> buf(new StringBuffer(value.length() + 8));
+    for (const char* p = value.c_str(); *p; p++) {
+        if (*p == '!' || *p == '%' || *p == '_')
+            *buf << '!';
+        *buf << *p;
+    }
+    return buf->toString();
+}
+
+/* splits a search value into the words a full text index knows */
+static std::vector<String> searchWords(String value)
+{
+    std::vector<String> words;
+    const char* p = value.c_str();
+    while (*p) {
+        while (*p && !(isalnum((unsigned char)*p) || (unsigned char)*p >= 0x80))
+            p++;
+        const char* start = p;
+        while (*p && (isalnum((unsigned char)*p) || (unsigned char)*p >= 0x80))
+            p++;
+        if (p > start)
+            words.push_back(String(start, p - start));
+    }
+    return words;
+}
+
 /* table quote */
 #define TQ(data) QTB << data << QTE
 /* table quote with dot */
@@ -103,6 +185,8 @@ enum {
     SEL_EQ_SP_FQ_DT_BQ "flags" \
     SEL_EQ_SP_FQ_DT_BQ "track_number" \
     SEL_EQ_SP_FQ_DT_BQ "service_id" \
+    SEL_EQ_SP_FQ_DT_BQ "child_containers" \
+    SEL_EQ_SP_FQ_DT_BQ "child_items" \
     SEL_EQ_SP_RFQ_DT_BQ "upnp_class" \
     SEL_EQ_SP_RFQ_DT_BQ "location" \
     SEL_EQ_SP_RFQ_DT_BQ "metadata" \
@@ -123,11 +207,43 @@ enum {
 
 /* enum for createObjectFromRow's mode parameter */
 
+Ref<StringBuffer> SQLStorage::renderStatement(Ref<SQLStatement> stmt)
+{
+    String query = stmt->getQuery();
+    Ref<StringBuffer> buf(new StringBuffer(query.length() + 32));
+    const char* q = query.c_str();
+    int param = 0;
+    bool inLiteral = false;
+    for (int i = 0; q[i]; i++) {
+        if (q[i] == '\'')
+            inLiteral = !inLiteral;
+        if (q[i] != '?' || inLiteral) {
+            *buf << q[i];
+            continue;
+        }
+        if (param >= stmt->getParamCount())
+            throw _Exception(_("not enough parameters bound to query: ") + query);
+        if (stmt->isIntParam(param))
+            *buf << quote(stmt->getIntParam(param));
+        else if (stmt->getStringParam(param) == nullptr)
+            *buf << SQL_NULL;
+        else
+            *buf << quote(stmt->getStringParam(param));
+        param++;
+    }
+    return buf;
+}
+
 SQLStorage::SQLStorage()
     : Storage()
 {
     table_quote_begin = '\0';
     table_quote_end = '\0';
+    recursiveQueries = false;
+    searchIDColumn = nullptr;
+    contentGeneration = 0;
+    folderArtGeneration = 0;
+    getTimespecNow(&lastUpdateIDFlush);
     lastID = INVALID_OBJECT_ID;
 }
 
@@ -140,14 +256,58 @@ void SQLStorage::init()
     *buf << SQL_QUERY_FOR_STRINGBUFFER;
     this->sql_query = buf->toString();
 
+    buf->clear();
+    *buf << SQL_QUERY << " WHERE " << TQD('f', "id") << "=?";
+    loadObjectQuery = buf->toString();
+
+    buf->clear();
+    *buf << "SELECT " << TQ("object_type")
+         << " FROM " << TQ(CDS_OBJECT_TABLE)
+         << " WHERE " << TQ("id") << "=?";
+    objectTypeQuery = buf->toString();
+
+    buf->clear();
+    *buf << "SELECT " << TQ("parent_id")
+         << " FROM " << TQ(CDS_OBJECT_TABLE)
+         << " WHERE " << TQ("id") << "=?";
+    parentIDQuery = buf->toString();
+
+    buf->clear();
+    *buf << "SELECT " << TQ("child_containers") << ',' << TQ("child_items")
+         << " FROM " << TQ(CDS_OBJECT_TABLE)
+         << " WHERE " << TQ("id") << "=?";
+    childCountQuery = buf->toString();
+
+    buf->clear();
+    *buf << "SELECT " << TQ("id") << ',' << TQ("action") << ','
+         << TQ("state") << " FROM " << TQ(CDS_ACTIVE_ITEM_TABLE)
+         << " WHERE " << TQ("id") << "=?";
+    activeItemQuery = buf->toString();
+
     if (ConfigManager::getInstance()->getBoolOption(CFG_SERVER_STORAGE_CACHING_ENABLED)) {
-        cache = Ref<StorageCache>(new StorageCache());
+        size_t cacheMemory = (size_t)ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_CACHE_MEMORY) * 1024 * 1024;
+        // objects that only live in the insert buffer so far must be
+        // written before the cache forgets about them
+        cache = Ref<StorageCache>(new StorageCache(cacheMemory, [this]() { flushInsertBuffer(); }));
         insertBufferOn = true;
     } else {
         cache = nullptr;
         insertBufferOn = false;
     }
 
+    pathIndex = Ref<PathIndex>(new PathIndex());
+
+    if (ConfigManager::getInstance()->getBoolOption(CFG_SERVER_STORAGE_QUERY_STATS_ENABLED))
+        queryStats = Ref<QueryStats>(new QueryStats(ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_SLOW_QUERY)));
+    else
+        queryStats = nullptr;
+
+    int didlCacheMemory = ConfigManager::getInstance()->getIntOption(CFG_SERVER_UPNP_FRAGMENT_CACHE_MEMORY);
+    if (didlCacheMemory > 0)
+        didlCache = Ref<DIDLCache>(new DIDLCache((size_t)didlCacheMemory * 1024 * 1024));
+    else
+        didlCache = nullptr;
+
     insertBufferEmpty = true;
     insertBufferStatementCount = 0;
     insertBufferByteCount = 0;
@@ -179,11 +339,23 @@ void SQLStorage::init()
 void SQLStorage::dbReady()
 {
     loadLastID();
+    loadPathIndex();
+    repairChildCounts();
+    initSearchIndex();
 }
 
 void SQLStorage::shutdown()
 {
+    flushUpdateIDs();
     flushInsertBuffer();
+    if (cacheOn()) {
+        log_info("storage cache: %llu hits, %llu misses, %llu evictions, %zu bytes in use\n",
+            cache->getHits(), cache->getMisses(), cache->getEvictions(), cache->getMemoryUsage());
+    }
+    if (didlCache != nullptr) {
+        log_info("DIDL fragment cache: %llu hits, %llu misses, %llu evictions, %zu bytes in use\n",
+            didlCache->getHits(), didlCache->getMisses(), didlCache->getEvictions(), didlCache->getMemoryUsage());
+    }
     shutdownDriver();
 }
 
@@ -254,68 +426,71 @@ Ref<Array<SQLStorage::AddUpdateTable>> SQLStorage::_addUpdateObject(Ref<CdsObjec
     }
 
     Ref<Array<AddUpdateTable>> returnVal(new Array<AddUpdateTable>(2));
-    Ref<Dictionary> cdsObjectSql(new Dictionary());
-    returnVal->append(Ref<AddUpdateTable>(new AddUpdateTable(_(CDS_OBJECT_TABLE), cdsObjectSql)));
+    Ref<AddUpdateTable> cdsObjectSql(new AddUpdateTable(_(CDS_OBJECT_TABLE)));
+    returnVal->append(cdsObjectSql);
 
-    cdsObjectSql->put(_("object_type"), quote(objectType));
+    cdsObjectSql->put(_("object_type"), objectType);
 
     if (hasReference || playlistRef)
-        cdsObjectSql->put(_("ref_id"), quote(refObj->getID()));
+        cdsObjectSql->put(_("ref_id"), refObj->getID());
     else if (isUpdate)
-        cdsObjectSql->put(_("ref_id"), _(SQL_NULL));
+        cdsObjectSql->put(_("ref_id"), nullptr);
 
     if (!hasReference || refObj->getClass() != obj->getClass())
-        cdsObjectSql->put(_("upnp_class"), quote(obj->getClass()));
+        cdsObjectSql->put(_("upnp_class"), obj->getClass());
     else if (isUpdate)
-        cdsObjectSql->put(_("upnp_class"), _(SQL_NULL));
+        cdsObjectSql->put(_("upnp_class"), nullptr);
 
     //if (!hasReference || refObj->getTitle() != obj->getTitle())
-    cdsObjectSql->put(_("dc_title"), quote(obj->getTitle()));
+    cdsObjectSql->put(_("dc_title"), obj->getTitle());
     //else if (isUpdate)
-    //    cdsObjectSql->put(_("dc_title"), _(SQL_NULL));
+    //    cdsObjectSql->put(_("dc_title"), nullptr);
 
     if (isUpdate)
-        cdsObjectSql->put(_("metadata"), _(SQL_NULL));
+        cdsObjectSql->put(_("metadata"), nullptr);
     Ref<Dictionary> dict = obj->getMetadata();
     if (dict->size() > 0) {
         if (!hasReference || !refObj->getMetadata()->equals(obj->getMetadata())) {
-            cdsObjectSql->put(_("metadata"), quote(dict->encode()));
+            cdsObjectSql->put(_("metadata"), dict->encodeCompact());
         }
     }
 
+    // the keys are kept with references too, browsing sorts on them alone
+    for (int i = 0; i < SORT_TRACK; i++) {
+        String key = SortCriteria::getKey((sort_field_t)i, obj->getTitle(), dict);
+        if (string_ok(key))
+            cdsObjectSql->put(_(sortColumns[i]), key);
+        else if (isUpdate)
+            cdsObjectSql->put(_(sortColumns[i]), nullptr);
+    }
+
     if (isUpdate)
-        cdsObjectSql->put(_("auxdata"), _(SQL_NULL));
+        cdsObjectSql->put(_("auxdata"), nullptr);
     dict = obj->getAuxData();
     if (dict->size() > 0 && (!hasReference || !refObj->getAuxData()->equals(obj->getAuxData()))) {
-        cdsObjectSql->put(_("auxdata"), quote(obj->getAuxData()->encode()));
+        cdsObjectSql->put(_("auxdata"), obj->getAuxData()->encodeCompact());
     }
 
     if (!hasReference || (!obj->getFlag(OBJECT_FLAG_USE_RESOURCE_REF) && !refObj->resourcesEqual(obj))) {
         // encode resources
-        Ref<StringBuffer> resBuf(new StringBuffer());
-        for (int i = 0; i < obj->getResourceCount(); i++) {
-            if (i > 0)
-                *resBuf << RESOURCE_SEP;
-            *resBuf << obj->getResource(i)->encode();
-        }
-        String resStr = resBuf->toString();
+        String resStr = CdsResource::encodeList(obj->getResources());
         if (string_ok(resStr))
-            cdsObjectSql->put(_("resources"), quote(resStr));
+            cdsObjectSql->put(_("resources"), resStr);
         else
-            cdsObjectSql->put(_("resources"), _(SQL_NULL));
+            cdsObjectSql->put(_("resources"), nullptr);
     } else if (isUpdate)
-        cdsObjectSql->put(_("resources"), _(SQL_NULL));
+        cdsObjectSql->put(_("resources"), nullptr);
 
     obj->clearFlag(OBJECT_FLAG_USE_RESOURCE_REF);
 
-    cdsObjectSql->put(_("flags"), quote(obj->getFlags()));
+    cdsObjectSql->put(_("flags"), obj->getFlags());
 
     if (IS_CDS_CONTAINER(objectType)) {
         if (!(isUpdate && obj->isVirtual()))
             throw _Exception(_("tried to add a container or tried to update a non-virtual container via _addUpdateObject; is this correct?"));
         String dbLocation = addLocationPrefix(LOC_VIRT_PREFIX, obj->getLocation());
-        cdsObjectSql->put(_("location"), quote(dbLocation));
-        cdsObjectSql->put(_("location_hash"), quote(stringHash(dbLocation)));
+        cdsObjectSql->put(_("location"), dbLocation);
+        cdsObjectSql->put(_("location_hash"), stringHash(dbLocation));
     }
 
     if (IS_CDS_ITEM(objectType)) {
@@ -331,47 +506,47 @@ Ref<Array<SQLStorage::AddUpdateTable>> SQLStorage::_addUpdateObject(Ref<CdsObjec
                 int parentID = ensurePathExistence(path, changedContainer);
                 item->setParentID(parentID);
                 String dbLocation = addLocationPrefix(LOC_FILE_PREFIX, loc);
-                cdsObjectSql->put(_("location"), quote(dbLocation));
-                cdsObjectSql->put(_("location_hash"), quote(stringHash(dbLocation)));
+                cdsObjectSql->put(_("location"), dbLocation);
+                cdsObjectSql->put(_("location_hash"), stringHash(dbLocation));
             } else {
                 // URLs and active items
-                cdsObjectSql->put(_("location"), quote(loc));
-                cdsObjectSql->put(_("location_hash"), _(SQL_NULL));
+                cdsObjectSql->put(_("location"), loc);
+                cdsObjectSql->put(_("location_hash"), nullptr);
             }
         } else {
             if (isUpdate) {
-                cdsObjectSql->put(_("location"), _(SQL_NULL));
-                cdsObjectSql->put(_("location_hash"), _(SQL_NULL));
+                cdsObjectSql->put(_("location"), nullptr);
+                cdsObjectSql->put(_("location_hash"), nullptr);
             }
         }
 
         if (item->getTrackNumber() > 0) {
-            cdsObjectSql->put(_("track_number"), quote(item->getTrackNumber()));
+            cdsObjectSql->put(_("track_number"), item->getTrackNumber());
         } else {
             if (isUpdate)
-                cdsObjectSql->put(_("track_number"), _(SQL_NULL));
+                cdsObjectSql->put(_("track_number"), nullptr);
         }
 
         if (string_ok(item->getServiceID())) {
             if (!hasReference || RefCast(refObj, CdsItem)->getServiceID() != item->getServiceID())
-                cdsObjectSql->put(_("service_id"), quote(item->getServiceID()));
+                cdsObjectSql->put(_("service_id"), item->getServiceID());
             else
-                cdsObjectSql->put(_("service_id"), _(SQL_NULL));
+                cdsObjectSql->put(_("service_id"), nullptr);
         } else {
             if (isUpdate)
-                cdsObjectSql->put(_("service_id"), _(SQL_NULL));
+                cdsObjectSql->put(_("service_id"), nullptr);
         }
 
-        cdsObjectSql->put(_("mime_type"), quote(item->getMimeType()));
+        cdsObjectSql->put(_("mime_type"), item->getMimeType());
     }
     if (IS_CDS_ACTIVE_ITEM(objectType)) {
-        Ref<Dictionary> cdsActiveItemSql(new Dictionary());
-        returnVal->append(Ref<AddUpdateTable>(new AddUpdateTable(_(CDS_ACTIVE_ITEM_TABLE), cdsActiveItemSql)));
+        Ref<AddUpdateTable> cdsActiveItemSql(new AddUpdateTable(_(CDS_ACTIVE_ITEM_TABLE)));
+        returnVal->append(cdsActiveItemSql);
         Ref<CdsActiveItem> aitem = RefCast(obj, CdsActiveItem);
 
-        cdsActiveItemSql->put(_("id"), String::from(aitem->getID()));
-        cdsActiveItemSql->put(_("action"), quote(aitem->getAction()));
-        cdsActiveItemSql->put(_("state"), quote(aitem->getState()));
+        // the id is only known after the object row is inserted
+        cdsActiveItemSql->put(_("action"), aitem->getAction());
+        cdsActiveItemSql->put(_("state"), aitem->getState());
     }
 
     // check for a duplicate (virtual) object
@@ -394,7 +569,7 @@ Ref<Array<SQLStorage::AddUpdateTable>> SQLStorage::_addUpdateObject(Ref<CdsObjec
 
     if (obj->getParentID() == INVALID_OBJECT_ID)
         throw _Exception(_("tried to create or update an object with an illegal parent id"));
-    cdsObjectSql->put(_("parent_id"), String::from(obj->getParentID()));
+    cdsObjectSql->put(_("parent_id"), obj->getParentID());
 
     return returnVal;
 }
@@ -407,65 +582,59 @@ void SQLStorage::addObject(Ref<CdsObject> obj, int* changedContainer)
     Ref<Array<AddUpdateTable>> data = _addUpdateObject(obj, false, changedContainer);
     if (data == nullptr)
         return;
-    int lastInsertID = INVALID_OBJECT_ID;
     for (int i = 0; i < data->size(); i++) {
         Ref<AddUpdateTable> addUpdateTable = data->get(i);
         String tableName = addUpdateTable->getTable();
-        Ref<Array<DictionaryElement>> dataElements = addUpdateTable->getDict()->getElements();
-
-        Ref<StringBuffer> fields(new StringBuffer(128));
-        Ref<StringBuffer> values(new StringBuffer(128));
-
-        for (int j = 0; j < dataElements->size(); j++) {
-            Ref<DictionaryElement> element = dataElements->get(j);
-            if (j != 0) {
-                *fields << ',';
-                *values << ',';
-            }
-            *fields << TQ(element->getKey());
-            if (lastInsertID != INVALID_OBJECT_ID && element->getKey() == "id" && element->getValue().toInt() == INVALID_OBJECT_ID)
-                *values << lastInsertID;
-            else
-                *values << element->getValue();
-        }
 
         /* manually generate ID */
-        if (lastInsertID == INVALID_OBJECT_ID && tableName == _(CDS_OBJECT_TABLE)) {
-            lastInsertID = getNextID();
-            obj->setID(lastInsertID);
-            *fields << ',' << TQ("id");
-            *values << ',' << quote(lastInsertID);
-        }
+        if (tableName == _(CDS_OBJECT_TABLE))
+            obj->setID(getNextID());
         /* -------------------- */
 
         Ref<StringBuffer> qb(new StringBuffer(256));
-        *qb << "INSERT INTO " << TQ(tableName) << " (" << fields->toString() << ") VALUES (" << values->toString() << ')';
+        *qb << "INSERT INTO " << TQ(tableName) << " (" << TQ("id");
+        for (int j = 0; j < addUpdateTable->size(); j++)
+            *qb << ',' << TQ(addUpdateTable->getColumn(j));
+        *qb << ") VALUES (?";
+        for (int j = 0; j < addUpdateTable->size(); j++)
+            *qb << ",?";
+        *qb << ')';
+
+        Ref<SQLStatement> stmt(new SQLStatement(qb->toString()));
+        stmt->bind(obj->getID());
+        for (int j = 0; j < addUpdateTable->size(); j++)
+            addUpdateTable->bindValue(j, stmt);
 
         log_debug("insert_query: %s\n", qb->toString().c_str());
 
-        /*
-        if (lastInsertID == INVALID_OBJECT_ID && tableName == _(CDS_OBJECT_TABLE))
-        {
-            lastInsertID = exec(qb, true);
-            obj->setID(lastInsertID);
-        }
-        else
-            exec(qb);
-        */
-
         if (!doInsertBuffering())
-            exec(qb);
+            exec(stmt);
         else
-            addToInsertBuffer(qb);
+            addToInsertBuffer(stmt);
     }
 
+    Ref<SQLStatement> searchUpdate = searchIndexUpdate(obj->getID(), obj->getTitle(), obj->getMetadata());
+    if (!doInsertBuffering())
+        exec(searchUpdate);
+    else
+        addToInsertBuffer(searchUpdate);
+
+    bool isContainer = IS_CDS_CONTAINER(obj->getObjectType());
+    Ref<SQLStatement> countUpdate = childCountUpdate(obj->getParentID(), isContainer ? 1 : 0, isContainer ? 0 : 1);
+    if (!doInsertBuffering())
+        exec(countUpdate);
+    else
+        addToInsertBuffer(countUpdate);
+
+    invalidateFolderArt(obj);
+    invalidateBrowseCursors(obj->getParentID());
+    contentChanged(obj->getParentID());
+    updatePathIndex(obj);
+
     /* add to cache */
     if (cacheOn()) {
-        AutoLock lock(cache->getMutex());
         cache->addChild(obj->getParentID());
-        if (cache->flushed())
-            flushInsertBuffer();
-        addObjectToCache(obj, true);
+        addObjectToCache(obj);
     }
     /* ------------ */
 }
@@ -477,11 +646,12 @@ void SQLStorage::updateObject(zmm::Ref<CdsObject> obj, int* changedContainer)
     Ref<Array<AddUpdateTable>> data;
     if (obj->getID() == CDS_ID_FS_ROOT) {
         data = Ref<Array<AddUpdateTable>>(new Array<AddUpdateTable>(1));
-        Ref<Dictionary> cdsObjectSql(new Dictionary());
-        data->append(Ref<AddUpdateTable>(new AddUpdateTable(_(CDS_OBJECT_TABLE), cdsObjectSql)));
-        cdsObjectSql->put(_("dc_title"), quote(obj->getTitle()));
+        Ref<AddUpdateTable> cdsObjectSql(new AddUpdateTable(_(CDS_OBJECT_TABLE)));
+        data->append(cdsObjectSql);
+        cdsObjectSql->put(_("dc_title"), obj->getTitle());
+        cdsObjectSql->put(_(sortColumns[SORT_TITLE]), SortCriteria::makeKey(obj->getTitle()));
         setFsRootName(obj->getTitle());
-        cdsObjectSql->put(_("upnp_class"), quote(obj->getClass()));
+        cdsObjectSql->put(_("upnp_class"), obj->getClass());
     } else {
         if (IS_FORBIDDEN_CDS_ID(obj->getID()))
             throw _Exception(_("tried to update an object with a forbidden ID (") + obj->getID() + ")!");
@@ -489,29 +659,58 @@ void SQLStorage::updateObject(zmm::Ref<CdsObject> obj, int* changedContainer)
         if (data == nullptr)
             return;
     }
+
+    // the parent may change, its child counts have to follow
+    int oldParentID = INVALID_OBJECT_ID;
+    if (obj->getID() != CDS_ID_FS_ROOT) {
+        Ref<SQLStatement> stmt(new SQLStatement(parentIDQuery));
+        stmt->bind(obj->getID());
+        Ref<SQLResult> res = select(stmt);
+        Ref<SQLRow> row;
+        if (res != nullptr && (row = res->nextRow()) != nullptr)
+            oldParentID = row->col_int(0, INVALID_OBJECT_ID);
+    }
+
     for (int i = 0; i < data->size(); i++) {
         Ref<AddUpdateTable> addUpdateTable = data->get(i);
         String tableName = addUpdateTable->getTable();
-        Ref<Array<DictionaryElement>> dataElements = addUpdateTable->getDict()->getElements();
+        if (addUpdateTable->size() == 0)
+            continue;
 
         Ref<StringBuffer> qb(new StringBuffer(256));
         *qb << "UPDATE " << TQ(tableName) << " SET ";
 
-        for (int j = 0; j < dataElements->size(); j++) {
-            Ref<DictionaryElement> element = dataElements->get(j);
+        for (int j = 0; j < addUpdateTable->size(); j++) {
             if (j != 0) {
                 *qb << ',';
             }
-            *qb << TQ(element->getKey()) << '='
-                << element->getValue();
+            *qb << TQ(addUpdateTable->getColumn(j)) << "=?";
         }
 
-        *qb << " WHERE id = " << obj->getID();
+        *qb << " WHERE " << TQ("id") << "=?";
 
         log_debug("upd_query: %s\n", qb->toString().c_str());
 
-        exec(qb);
-    }
+        Ref<SQLStatement> stmt(new SQLStatement(qb->toString()));
+        for (int j = 0; j < addUpdateTable->size(); j++)
+            addUpdateTable->bindValue(j, stmt);
+        stmt->bind(obj->getID());
+        exec(stmt);
+    }
+    exec(searchIndexUpdate(obj->getID(), obj->getTitle(), obj->getMetadata()));
+    if (oldParentID != INVALID_OBJECT_ID && oldParentID != obj->getParentID()) {
+        bool isContainer = IS_CDS_CONTAINER(obj->getObjectType());
+        exec(childCountUpdate(oldParentID, isContainer ? -1 : 0, isContainer ? 0 : -1));
+        exec(childCountUpdate(obj->getParentID(), isContainer ? 1 : 0, isContainer ? 0 : 1));
+        invalidateBrowseCursors(oldParentID);
+        contentChanged(oldParentID);
+        contentChanged(obj->getParentID());
+    }
+    invalidateFolderArt(obj, oldParentID);
+    invalidateBrowseCursors(obj->getParentID());
+    contentChanged(obj->getID());
+    updatePathIndex(obj);
+
     /* add to cache */
     addObjectToCache(obj);
     /* ------------ */
@@ -522,12 +721,9 @@ Ref<CdsObject> SQLStorage::loadObject(int objectID)
 
     /* check cache */
     if (cacheOn()) {
-        AutoLock lock(cache->getMutex());
-        Ref<CacheObject> cObj = cache->getObject(objectID);
-        if (cObj != nullptr) {
-            if (cObj->knowsObject())
-                return cObj->getObject();
-        }
+        Ref<CdsObject> obj = cache->getObject(objectID);
+        if (obj != nullptr)
+            return obj;
     }
     /* ----------- */
 
@@ -537,13 +733,10 @@ Ref<CdsObject> SQLStorage::loadObject(int objectID)
         return obj;
     throw _Exception(_("Object not found: ") + objectID);
 */
-    Ref<StringBuffer> qb(new StringBuffer());
+    Ref<SQLStatement> stmt(new SQLStatement(loadObjectQuery));
+    stmt->bind(objectID);
 
-    //log_debug("sql_query = %s\n",sql_query.c_str());
-
-    *qb << SQL_QUERY << " WHERE " << TQD('f', "id") << '=' << objectID;
-
-    Ref<SQLResult> res = select(qb);
+    Ref<SQLResult> res = select(stmt);
     Ref<SQLRow> row;
     if (res != nullptr && (row = res->nextRow()) != nullptr) {
         return createObjectFromRow(row);
@@ -608,33 +801,22 @@ Ref<Array<CdsObject>> SQLStorage::browse(Ref<BrowseParam> param)
     bool haveObjectType = false;
 
     /* check cache */
-    if (cacheOn()) {
-        AutoLock lock(cache->getMutex());
-        Ref<CacheObject> cObj = cache->getObject(objectID);
-        if (cObj != nullptr && cObj->knowsObjectType()) {
-            objectType = cObj->getObjectType();
-            haveObjectType = true;
-        }
-    }
+    if (cacheOn())
+        haveObjectType = cache->getObjectType(objectID, &objectType);
     /* ----------- */
 
     Ref<StringBuffer> qb(new StringBuffer());
     if (!haveObjectType) {
-        *qb << "SELECT " << TQ("object_type")
-            << " FROM " << TQ(CDS_OBJECT_TABLE)
-            << " WHERE " << TQ("id") << '=' << objectID;
-        res = select(qb);
+        Ref<SQLStatement> stmt(new SQLStatement(objectTypeQuery));
+        stmt->bind(objectID);
+        res = select(stmt);
         if (res != nullptr && (row = res->nextRow()) != nullptr) {
-            objectType = row->col(0).toInt();
+            objectType = row->col_int(0, 0);
             haveObjectType = true;
 
             /* add to cache */
-            if (cacheOn()) {
-                AutoLock lock(cache->getMutex());
-                cache->getObjectDefinitely(objectID)->setObjectType(objectType);
-                if (cache->flushed())
-                    flushInsertBuffer();
-            }
+            if (cacheOn())
+                cache->setObjectType(objectID, objectType);
             /* ------------ */
         } else {
             throw _ObjectNotFoundException(_("Object not found: ") + objectID);
@@ -653,18 +835,40 @@ Ref<Array<CdsObject>> SQLStorage::browse(Ref<BrowseParam> param)
     }
 
     // order by code..
+    // the id makes the order unique, which keyset pagination relies on
+    Ref<SortCriteria> sortCriteria = param->getSortCriteria();
+    bool trackSort = param->getFlag(BROWSE_TRACK_SORT) && sortCriteria == nullptr;
     qb->clear();
-    if (param->getFlag(BROWSE_TRACK_SORT))
-        *qb << TQD('f', "track_number") << ',';
-    *qb << TQD('f', "dc_title");
+    if (sortCriteria != nullptr)
+        sortOrder(sortCriteria, qb);
+    else {
+        if (trackSort)
+            *qb << TQD('f', "track_number") << ',';
+        *qb << TQD('f', "dc_title") << ',' << TQD('f', "id");
+    }
     String orderByCode = qb->toString();
 
+    // rows following the sort key of the browse cursor, in the order of orderByCode
+    qb->clear();
+    if (trackSort)
+        *qb << '(' << TQD('f', "track_number") << ">? OR ("
+            << TQD('f', "track_number") << "=? AND ";
+    *qb << '(' << TQD('f', "dc_title") << ">? OR ("
+        << TQD('f', "dc_title") << "=? AND " << TQD('f', "id") << ">?))";
+    if (trackSort)
+        *qb << "))";
+    String afterCursorCode = qb->toString();
+
     qb->clear();
     *qb << SQL_QUERY << " WHERE ";
 
+    Ref<SQLStatement> stmt;
+    bool doLimit = false;
+    BrowseCursor cursor;
+    bool useCursor = false;
     if (param->getFlag(BROWSE_DIRECT_CHILDREN) && IS_CDS_CONTAINER(objectType)) {
         int count = param->getRequestedCount();
-        bool doLimit = true;
+        doLimit = true;
         if (!count) {
             if (param->getStartingIndex())
                 count = INT_MAX;
@@ -672,7 +876,13 @@ Ref<Array<CdsObject>> SQLStorage::browse(Ref<BrowseParam> param)
                 doLimit = false;
         }
 
-        *qb << TQD('f', "parent_id") << '=' << objectID;
+        // a request for the page following the last one continues after
+        // its last row instead of skipping StartingIndex rows, the cursor
+        // only knows the default order
+        if (doLimit && param->getStartingIndex() > 0 && sortCriteria == nullptr)
+            useCursor = getBrowseCursor(objectID, param, cursor);
+
+        *qb << TQD('f', "parent_id") << "=?";
 
         if (objectID == CDS_ID_ROOT && hideFsRoot)
             *qb << " AND " << TQD('f', "id") << "!="
@@ -680,52 +890,369 @@ Ref<Array<CdsObject>> SQLStorage::browse(Ref<BrowseParam> param)
 
         if (!getContainers && !getItems) {
             *qb << " AND 0=1";
+            useCursor = false;
         } else if (getContainers && !getItems) {
             *qb << " AND " << TQD('f', "object_type") << '='
-                << quote(OBJECT_TYPE_CONTAINER)
-                << " ORDER BY " << orderByCode;
+                << quote(OBJECT_TYPE_CONTAINER);
+            if (useCursor)
+                *qb << " AND " << afterCursorCode;
+            *qb << " ORDER BY " << orderByCode;
         } else if (!getContainers && getItems) {
             *qb << " AND (" << TQD('f', "object_type") << " & "
                 << quote(OBJECT_TYPE_ITEM) << ") = "
-                << quote(OBJECT_TYPE_ITEM)
+                << quote(OBJECT_TYPE_ITEM);
+            if (useCursor)
+                *qb << " AND " << afterCursorCode;
+            *qb << " ORDER BY " << orderByCode;
+        } else if (useCursor && !cursor.isContainer) {
+            // all containers were returned already
+            *qb << " AND " << TQD('f', "object_type") << "!="
+                << quote(OBJECT_TYPE_CONTAINER)
+                << " AND " << afterCursorCode
                 << " ORDER BY " << orderByCode;
         } else {
+            if (useCursor)
+                *qb << " AND (" << TQD('f', "object_type") << "!="
+                    << quote(OBJECT_TYPE_CONTAINER)
+                    << " OR " << afterCursorCode << ')';
             *qb << " ORDER BY ("
                 << TQD('f', "object_type") << '=' << quote(OBJECT_TYPE_CONTAINER)
                 << ") DESC, " << orderByCode;
         }
         if (doLimit)
-            *qb << " LIMIT " << count << " OFFSET " << param->getStartingIndex();
+            *qb << (useCursor ? " LIMIT ?" : " LIMIT ? OFFSET ?");
+        stmt = Ref<SQLStatement>(new SQLStatement(qb->toString()));
+        stmt->bind(objectID);
+        if (useCursor) {
+            if (trackSort) {
+                stmt->bind(cursor.trackNumber);
+                stmt->bind(cursor.trackNumber);
+            }
+            stmt->bind(cursor.title);
+            stmt->bind(cursor.title);
+            stmt->bind(cursor.id);
+        }
+        if (doLimit) {
+            stmt->bind(count);
+            if (!useCursor)
+                stmt->bind(param->getStartingIndex());
+        }
     } else // metadata
     {
-        *qb << TQD('f', "id") << '=' << objectID << " LIMIT 1";
+        *qb << TQD('f', "id") << "=? LIMIT 1";
+        stmt = Ref<SQLStatement>(new SQLStatement(qb->toString()));
+        stmt->bind(objectID);
     }
     log_debug("QUERY: %s\n", qb->toString().c_str());
-    res = select(qb);
+    // the child counts of buffered objects must be written
+    flushInsertBuffer();
+    res = select(stmt);
 
     Ref<Array<CdsObject>> arr(new Array<CdsObject>());
 
+    bool lastTrackNumberNull = true;
     while ((row = res->nextRow()) != nullptr) {
         Ref<CdsObject> obj = createObjectFromRow(row);
+        if (IS_CDS_CONTAINER(obj->getObjectType())) {
+            int childCount = (getContainers ? row->col_int(_child_containers, 0) : 0)
+                + (getItems ? row->col_int(_child_items, 0) : 0);
+            // only the root container has the fs root as a child
+            if (obj->getID() == CDS_ID_ROOT && hideFsRoot && getContainers && childCount > 0)
+                childCount--;
+            RefCast(obj, CdsContainer)->setChildCount(childCount);
+        }
         arr->append(obj);
+        lastTrackNumberNull = (row->col_c_str(_track_number) == nullptr);
         row = nullptr;
     }
 
     row = nullptr;
     res = nullptr;
 
-    // update childCount fields
-    for (int i = 0; i < arr->size(); i++) {
-        Ref<CdsObject> obj = arr->get(i);
-        if (IS_CDS_CONTAINER(obj->getObjectType())) {
-            Ref<CdsContainer> cont = RefCast(obj, CdsContainer);
-            cont->setChildCount(getChildCount(cont->getID(), getContainers, getItems, hideFsRoot));
-        }
+    if (doLimit && sortCriteria == nullptr) {
+        if (useCursor)
+            log_debug("continued browse of %d at index %d after key %d\n", objectID, param->getStartingIndex(), cursor.id);
+        setBrowseCursor(objectID, param, arr, lastTrackNumberNull);
     }
 
     return arr;
 }
 
+bool SQLStorage::getBrowseCursor(int objectID, Ref<BrowseParam> param, BrowseCursor& cursor)
+{
+    AutoLock lock(browseCursorMutex);
+    auto it = browseCursors.find(objectID);
+    if (it == browseCursors.end())
+        return false;
+    // only valid for the directly following page of an unchanged container
+    if (it->second.flags != param->getFlags()
+        || it->second.nextIndex != param->getStartingIndex()
+        || it->second.totalMatches != param->getTotalMatches())
+        return false;
+    cursor = it->second;
+    return true;
+}
+
+void SQLStorage::setBrowseCursor(int objectID, Ref<BrowseParam> param, Ref<Array<CdsObject>> page, bool lastTrackNumberNull)
+{
+    AutoLock lock(browseCursorMutex);
+    int size = page->size();
+    Ref<CdsObject> last = size > 0 ? page->get(size - 1) : nullptr;
+    bool trackSort = param->getFlag(BROWSE_TRACK_SORT);
+
+    // NULL keys sort first, rows after them cannot be selected by comparison
+    if (last == nullptr || last->getTitle() == nullptr || (trackSort && lastTrackNumberNull)) {
+        browseCursors.erase(objectID);
+        return;
+    }
+
+    if (browseCursors.size() >= BROWSE_CURSOR_MAXFILL)
+        browseCursors.clear();
+
+    BrowseCursor& cursor = browseCursors[objectID];
+    cursor.flags = param->getFlags();
+    cursor.nextIndex = param->getStartingIndex() + size;
+    cursor.totalMatches = param->getTotalMatches();
+    cursor.isContainer = IS_CDS_CONTAINER(last->getObjectType());
+    cursor.trackNumber = (trackSort && IS_CDS_ITEM(last->getObjectType())) ? RefCast(last, CdsItem)->getTrackNumber() : 0;
+    cursor.title = last->getTitle();
+    cursor.id = last->getID();
+}
+
+void SQLStorage::invalidateBrowseCursors(int parentID)
+{
+    AutoLock lock(browseCursorMutex);
+    if (parentID == INVALID_OBJECT_ID)
+        browseCursors.clear();
+    else
+        browseCursors.erase(parentID);
+}
+
+void SQLStorage::contentChanged(int id)
+{
+    contentGeneration++;
+    if (didlCache != nullptr && id != INVALID_OBJECT_ID)
+        didlCache->invalidate(id);
+}
+
+void SQLStorage::discardCachedContent()
+{
+    if (cacheOn())
+        cache->clear();
+    if (didlCache != nullptr)
+        didlCache->clear();
+    invalidateFolderArt(nullptr);
+    invalidateBrowseCursors(INVALID_OBJECT_ID);
+    contentGeneration++;
+    loadPathIndex();
+}
+
+Ref<Array<CdsObject>> SQLStorage::search(Ref<SearchParam> param)
+{
+    // the search index of buffered objects must be written
+    flushInsertBuffer();
+
+    Ref<StringBuffer> where(new StringBuffer());
+    searchScope(param->getContainerID(), where);
+    if (param->getCriteria() != nullptr) {
+        *where << " AND ";
+        searchCondition(param->getCriteria(), where);
+    }
+
+    int startingIndex = param->getStartingIndex();
+    int count = param->getRequestedCount();
+    if (count <= 0 || count > SEARCH_MAX_RESULTS)
+        count = SEARCH_MAX_RESULTS;
+
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << SQL_QUERY << " WHERE " << where << " ORDER BY ";
+    if (param->getSortCriteria() != nullptr)
+        sortOrder(param->getSortCriteria(), qb);
+    else
+        *qb << TQD('f', "dc_title") << ',' << TQD('f', "id");
+    *qb << " LIMIT " << count << " OFFSET " << startingIndex;
+    log_debug("QUERY: %s\n", qb->c_str());
+    Ref<SQLResult> res = select(qb);
+    if (res == nullptr)
+        throw _StorageException(nullptr, _("sql error"));
+
+    Ref<Array<CdsObject>> arr(new Array<CdsObject>());
+    Ref<SQLRow> row;
+    while ((row = res->nextRow()) != nullptr) {
+        Ref<CdsObject> obj = createObjectFromRow(row);
+        if (IS_CDS_CONTAINER(obj->getObjectType()))
+            RefCast(obj, CdsContainer)->setChildCount(row->col_int(_child_containers, 0) + row->col_int(_child_items, 0));
+        arr->append(obj);
+    }
+    row = nullptr;
+    res = nullptr;
+
+    // only a full page needs the matches to be counted
+    if (arr->size() < count && (arr->size() > 0 || startingIndex == 0)) {
+        param->setTotalMatches(startingIndex + arr->size());
+        return arr;
+    }
+
+    qb->clear();
+    *qb << "SELECT COUNT(*) FROM " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('f')
+        << " LEFT JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ("rf")
+        << " ON " << TQD('f', "ref_id") << '=' << TQD("rf", "id")
+        << " WHERE " << where;
+    res = select(qb);
+    if (res != nullptr && (row = res->nextRow()) != nullptr)
+        param->setTotalMatches(row->col_int(0, 0));
+    else
+        param->setTotalMatches(startingIndex + arr->size());
+    return arr;
+}
+
+void SQLStorage::sortOrder(Ref<SortCriteria> sortCriteria, Ref<StringBuffer> buf)
+{
+    for (auto& criterion : sortCriteria->criteria) {
+        *buf << TQD('f', sortColumns[criterion.field]);
+        if (criterion.descending)
+            *buf << " DESC";
+        *buf << ',';
+    }
+    *buf << TQD('f', "id");
+}
+
+void SQLStorage::searchScope(int containerID, Ref<StringBuffer> buf)
+{
+    if (containerID == CDS_ID_ROOT) {
+        // leaves out the root and the pseudo root above it
+        *buf << TQD('f', "id") << '>' << CDS_ID_ROOT;
+        return;
+    }
+
+    if (recursiveQueries) {
+        *buf << TQD('f', "parent_id") << " IN ("
+             << "WITH RECURSIVE " << TQ("scope") << '(' << TQ("id") << ") AS ("
+             << "SELECT " << containerID
+             << " UNION SELECT " << TQD('o', "id")
+             << " FROM " << TQ("scope") << ' ' << TQ('s')
+             << " JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('o')
+             << " ON " << TQD('o', "parent_id") << '=' << TQD('s', "id")
+             << " WHERE " << TQD('o', "object_type") << '=' << OBJECT_TYPE_CONTAINER
+             << ") SELECT " << TQ("id") << " FROM " << TQ("scope") << ')';
+        return;
+    }
+
+    // every level of the subtree as a select nested into the one of the
+    // level above, the statement grows with the depth of the subtree and
+    // not with the number of its containers
+    String level = String::from(containerID);
+    *buf << '(' << TQD('f', "parent_id") << " IN (" << level << ')';
+    while (true) {
+        Ref<StringBuffer> next(new StringBuffer());
+        *next << "SELECT " << TQ("id") << " FROM " << TQ(CDS_OBJECT_TABLE)
+              << " WHERE " << TQ("parent_id") << " IN (" << level << ')'
+              << " AND " << TQ("object_type") << '=' << OBJECT_TYPE_CONTAINER;
+        Ref<StringBuffer> q(new StringBuffer());
+        *q << next << " LIMIT 1";
+        Ref<SQLResult> res = select(q);
+        if (res == nullptr || res->nextRow() == nullptr)
+            break;
+        level = next->toString();
+        *buf << " OR " << TQD('f', "parent_id") << " IN (" << level << ')';
+    }
+    *buf << ')';
+}
+
+void SQLStorage::searchCondition(Ref<SearchExpression> exp, Ref<StringBuffer> buf)
+{
+    if (exp->type != SEARCH_RELATION) {
+        *buf << '(';
+        searchCondition(exp->left, buf);
+        *buf << (exp->type == SEARCH_AND ? " AND " : " OR ");
+        searchCondition(exp->right, buf);
+        *buf << ')';
+        return;
+    }
+
+    bool exists = (exp->value == "true");
+    if (exp->property == "@refID") {
+        *buf << TQD('f', "ref_id") << (exists ? " IS NOT NULL" : " IS NULL");
+        return;
+    }
+
+    String value = exp->value;
+    String pattern = searchLikeEscape(value);
+    if (exp->property == "upnp:class") {
+        Ref<StringBuffer> upnpClass(new StringBuffer());
+        *upnpClass << "COALESCE(" << TQD('f', "upnp_class") << ',' << TQD("rf", "upnp_class") << ')';
+        switch (exp->op) {
+        case SEARCH_OP_EXISTS:
+            *buf << upnpClass << (exists ? " IS NOT NULL" : " IS NULL");
+            break;
+        case SEARCH_OP_DERIVED_FROM:
+            *buf << '(' << upnpClass << '=' << quote(value) << " OR "
+                 << upnpClass << " LIKE " << quote(pattern + ".%") << " ESCAPE '!')";
+            break;
+        case SEARCH_OP_CONTAINS:
+            *buf << upnpClass << " LIKE " << quote(_("%") + pattern + "%") << " ESCAPE '!'";
+            break;
+        case SEARCH_OP_DOES_NOT_CONTAIN:
+            *buf << upnpClass << " NOT LIKE " << quote(_("%") + pattern + "%") << " ESCAPE '!'";
+            break;
+        case SEARCH_OP_STARTS_WITH:
+            *buf << upnpClass << " LIKE " << quote(pattern + "%") << " ESCAPE '!'";
+            break;
+        default:
+            *buf << upnpClass << searchOperators[exp->op] << quote(value);
+        }
+        return;
+    }
+
+    int i;
+    for (i = 0; searchColumns[i].property != nullptr; i++) {
+        if (exp->property == searchColumns[i].property)
+            break;
+    }
+    if (searchColumns[i].property == nullptr)
+        throw _Exception(_("property can not be searched: ") + exp->property);
+    const char* column = searchColumns[i].column;
+
+    // the property has to be set for any relation to hold
+    *buf << TQD('f', "id") << (exp->op == SEARCH_OP_EXISTS && !exists ? " NOT IN (" : " IN (")
+         << "SELECT " << TQ(searchIDColumn) << " FROM " << TQ(CDS_SEARCH_TABLE) << " WHERE ";
+    // a word index matches words by their beginning, the first word of a
+    // contains relation may start in the middle of a word though and
+    // only the LIKE below decides about it; a substring index narrows
+    // down all of them
+    std::vector<String> words;
+    if (exp->op == SEARCH_OP_EQUAL || exp->op == SEARCH_OP_CONTAINS || exp->op == SEARCH_OP_STARTS_WITH)
+        words = searchWords(value);
+    if (exp->op == SEARCH_OP_CONTAINS && !words.empty() && !searchMatchesSubstrings())
+        words.erase(words.begin());
+    String match = searchMatch(_(column), words);
+    if (match != nullptr)
+        *buf << match << " AND ";
+    switch (exp->op) {
+    case SEARCH_OP_EXISTS:
+        *buf << TQ(column) << " IS NOT NULL";
+        break;
+    case SEARCH_OP_EQUAL:
+        *buf << TQ(column) << " LIKE " << quote(pattern) << " ESCAPE '!'";
+        break;
+    case SEARCH_OP_NOT_EQUAL:
+        *buf << TQ(column) << " NOT LIKE " << quote(pattern) << " ESCAPE '!'";
+        break;
+    case SEARCH_OP_CONTAINS:
+        *buf << TQ(column) << " LIKE " << quote(_("%") + pattern + "%") << " ESCAPE '!'";
+        break;
+    case SEARCH_OP_DOES_NOT_CONTAIN:
+        *buf << TQ(column) << " NOT LIKE " << quote(_("%") + pattern + "%") << " ESCAPE '!'";
+        break;
+    case SEARCH_OP_STARTS_WITH:
+        *buf << TQ(column) << " LIKE " << quote(pattern + "%") << " ESCAPE '!'";
+        break;
+    default:
+        *buf << TQ(column) << searchOperators[exp->op] << quote(value);
+    }
+    *buf << ')';
+}
+
 int SQLStorage::getChildCount(int contId, bool containers, bool items, bool hideFsRoot)
 {
     if (!containers && !items)
@@ -733,13 +1260,9 @@ int SQLStorage::getChildCount(int contId, bool containers, bool items, bool hide
 
     /* check cache */
     if (cacheOn() && containers && items && !(contId == CDS_ID_ROOT && hideFsRoot)) {
-        AutoLock lock(cache->getMutex());
-        Ref<CacheObject> cObj = cache->getObject(contId);
-        if (cObj != nullptr) {
-            if (cObj->knowsNumChildren())
-                return cObj->getNumChildren();
-            //cObj->debug();
-        }
+        int numChildren;
+        if (cache->getNumChildren(contId, &numChildren))
+            return numChildren;
     }
     /* ----------- */
 
@@ -747,28 +1270,18 @@ int SQLStorage::getChildCount(int contId, bool containers, bool items, bool hide
 
     Ref<SQLRow> row;
     Ref<SQLResult> res;
-    Ref<StringBuffer> qb(new StringBuffer());
-    *qb << "SELECT COUNT(*) FROM " << TQ(CDS_OBJECT_TABLE)
-        << " WHERE " << TQ("parent_id") << '=' << contId;
-    if (containers && !items)
-        *qb << " AND " << TQ("object_type") << '=' << OBJECT_TYPE_CONTAINER;
-    else if (items && !containers)
-        *qb << " AND (" << TQ("object_type") << " & " << OBJECT_TYPE_ITEM
-            << ") = " << OBJECT_TYPE_ITEM;
-    if (contId == CDS_ID_ROOT && hideFsRoot) {
-        *qb << " AND " << TQ("id") << "!=" << quote(CDS_ID_FS_ROOT);
-    }
-    res = select(qb);
+    Ref<SQLStatement> stmt(new SQLStatement(childCountQuery));
+    stmt->bind(contId);
+    res = select(stmt);
     if (res != nullptr && (row = res->nextRow()) != nullptr) {
-        int childCount = row->col(0).toInt();
+        int childCount = (containers ? row->col_int(0, 0) : 0) + (items ? row->col_int(1, 0) : 0);
+        // only the root container has the fs root as a child
+        if (contId == CDS_ID_ROOT && hideFsRoot && containers && childCount > 0)
+            childCount--;
 
         /* add to cache */
-        if (cacheOn() && containers && items && !(contId == CDS_ID_ROOT && hideFsRoot)) {
-            AutoLock lock(cache->getMutex());
-            cache->getObjectDefinitely(contId)->setNumChildren(childCount);
-            if (cache->flushed())
-                flushInsertBuffer();
-        }
+        if (cacheOn() && containers && items && !(contId == CDS_ID_ROOT && hideFsRoot))
+            cache->setNumChildren(contId, childCount);
         /* ------------ */
 
         return childCount;
@@ -800,7 +1313,7 @@ Ref<Array<StringBase>> SQLStorage::getMimeTypes()
     return arr;
 }
 
-Ref<CdsObject> SQLStorage::_findObjectByPath(String fullpath)
+String SQLStorage::getPathLocation(String fullpath)
 {
     //log_debug("fullpath: %s\n", fullpath.c_str());
     fullpath = fullpath.reduce(DIR_SEPARATOR);
@@ -818,34 +1331,41 @@ Ref<CdsObject> SQLStorage::_findObjectByPath(String fullpath)
     } else
         dbLocation = addLocationPrefix(LOC_DIR_PREFIX, path);
 
+    return dbLocation;
+}
+
+Ref<CdsObject> SQLStorage::_findObjectByPath(String fullpath)
+{
+    String dbLocation = getPathLocation(fullpath);
+
     /* check cache */
     if (cacheOn()) {
-        AutoLock lock(cache->getMutex());
-        Ref<Array<CacheObject>> objects = cache->getObjects(dbLocation);
-        if (objects != nullptr) {
-            for (int i = 0; i < objects->size(); i++) {
-                Ref<CacheObject> cObj = objects->get(i);
-                if (cObj->knowsObject() && cObj->knowsVirtual() && !cObj->getVirtual())
-                    return cObj->getObject();
-            }
-        }
+        Ref<CdsObject> obj = cache->getObjectByLocation(dbLocation);
+        if (obj != nullptr)
+            return obj;
     }
     /* ----------- */
 
-    Ref<StringBuffer> qb(new StringBuffer());
-    *qb << SQL_QUERY
-        << " WHERE " << TQD('f', "location_hash") << '=' << quote(stringHash(dbLocation))
-        << " AND " << TQD('f', "location") << '=' << quote(dbLocation)
-        << " AND " << TQD('f', "ref_id") << " IS NULL "
-                                            "LIMIT 1";
+    // the path index knows all locations, only existing objects are loaded
+    int objectID = pathIndex->find(dbLocation);
+    if (objectID == INVALID_OBJECT_ID)
+        return nullptr;
 
-    Ref<SQLResult> res = select(qb);
+    // the object may still be in the insert buffer
+    flushInsertBuffer();
+    Ref<SQLStatement> stmt(new SQLStatement(loadObjectQuery));
+    stmt->bind(objectID);
+
+    Ref<SQLResult> res = select(stmt);
     if (res == nullptr)
-        throw _Exception(_("error while doing select: ") + qb->toString());
+        throw _Exception(_("error while doing select: ") + loadObjectQuery);
 
     Ref<SQLRow> row = res->nextRow();
-    if (row == nullptr)
+    if (row == nullptr) {
+        log_warning("path index is out of sync for %s\n", dbLocation.c_str());
+        pathIndex->remove(objectID);
         return nullptr;
+    }
     return createObjectFromRow(row);
 }
 
@@ -856,10 +1376,94 @@ Ref<CdsObject> SQLStorage::findObjectByPath(String fullpath)
 
 int SQLStorage::findObjectIDByPath(String fullpath)
 {
-    Ref<CdsObject> obj = _findObjectByPath(fullpath);
-    if (obj == nullptr)
-        return INVALID_OBJECT_ID;
-    return obj->getID();
+    return pathIndex->find(getPathLocation(fullpath));
+}
+
+void SQLStorage::loadPathIndex()
+{
+    pathIndex->clear();
+
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << "SELECT " << TQ("id") << ',' << TQ("location")
+        << " FROM " << TQ(CDS_OBJECT_TABLE)
+        << " WHERE " << TQ("ref_id") << " IS NULL AND "
+        << TQ("location_hash") << " IS NOT NULL";
+    Ref<SQLResult> res = select(qb);
+    Ref<SQLRow> row;
+    while ((row = res->nextRow()) != nullptr) {
+        const char* location = row->col_c_str(1);
+        if (location != nullptr && (location[0] == LOC_DIR_PREFIX || location[0] == LOC_FILE_PREFIX))
+            pathIndex->add(location, row->col_int(0, INVALID_OBJECT_ID));
+    }
+    log_debug("path index holds %d locations\n", (int)pathIndex->size());
+}
+
+Ref<SQLStatement> SQLStorage::childCountUpdate(int parentID, int containers, int items)
+{
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << "UPDATE " << TQ(CDS_OBJECT_TABLE) << " SET "
+        << TQ("child_containers") << '=' << TQ("child_containers") << "+?,"
+        << TQ("child_items") << '=' << TQ("child_items") << "+?"
+        << " WHERE " << TQ("id") << "=?";
+    Ref<SQLStatement> stmt(new SQLStatement(qb->toString()));
+    stmt->bind(containers);
+    stmt->bind(items);
+    stmt->bind(parentID);
+    return stmt;
+}
+
+void SQLStorage::repairChildCounts()
+{
+    Ref<StringBuffer> countContainers(new StringBuffer());
+    *countContainers << "SUM(CASE WHEN " << TQD('c', "object_type") << '=' << OBJECT_TYPE_CONTAINER
+                     << " THEN 1 ELSE 0 END)";
+
+    // only containers whose stored counts differ from the real ones
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << "SELECT " << TQD('p', "id") << ',' << countContainers
+        << ",COUNT(" << TQD('c', "id") << ")-" << countContainers
+        << " FROM " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('p')
+        << " LEFT JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('c')
+        << " ON " << TQD('c', "parent_id") << '=' << TQD('p', "id")
+        << " AND " << TQD('c', "id") << "!=" << TQD('p', "id")
+        << " WHERE " << TQD('p', "object_type") << '=' << OBJECT_TYPE_CONTAINER
+        << " GROUP BY " << TQD('p', "id") << ',' << TQD('p', "child_containers") << ',' << TQD('p', "child_items")
+        << " HAVING " << TQD('p', "child_containers") << "!=" << countContainers
+        << " OR " << TQD('p', "child_items") << "!=COUNT(" << TQD('c', "id") << ")-" << countContainers;
+    Ref<SQLResult> res = select(qb);
+
+    std::vector<Ref<StringBuffer>> updates;
+    Ref<SQLRow> row;
+    while (res != nullptr && (row = res->nextRow()) != nullptr) {
+        Ref<StringBuffer> ub(new StringBuffer());
+        *ub << "UPDATE " << TQ(CDS_OBJECT_TABLE) << " SET "
+            << TQ("child_containers") << '=' << row->col_int(1, 0) << ','
+            << TQ("child_items") << '=' << row->col_int(2, 0)
+            << " WHERE " << TQ("id") << '=' << quote(row->col_int(0, INVALID_OBJECT_ID));
+        updates.push_back(ub);
+    }
+    row = nullptr;
+    res = nullptr;
+
+    if (updates.empty())
+        return;
+
+    beginTransaction();
+    for (auto& update : updates)
+        exec(update);
+    commitTransaction();
+    log_info("repaired the child counts of %d containers\n", (int)updates.size());
+}
+
+void SQLStorage::updatePathIndex(Ref<CdsObject> obj)
+{
+    if (!IS_CDS_ITEM(obj->getObjectType()))
+        return;
+    // same condition as for the location written by _addUpdateObject
+    if (IS_CDS_PURE_ITEM(obj->getObjectType()) && !obj->isVirtual() && obj->getRefID() <= 0)
+        pathIndex->add(addLocationPrefix(LOC_FILE_PREFIX, obj->getLocation()), obj->getID());
+    else
+        pathIndex->remove(obj->getID());
 }
 
 int SQLStorage::ensurePathExistence(String path, int* changedContainer)
@@ -916,6 +1520,7 @@ int SQLStorage::createContainer(int parentID, String name, String path, bool isV
     }
 
     int newID = getNextID();
+    String sortTitle = SortCriteria::makeKey(name);
 
     Ref<StringBuffer> qb(new StringBuffer());
     *qb << "INSERT INTO "
@@ -929,7 +1534,8 @@ int SQLStorage::createContainer(int parentID, String name, String path, bool isV
         << TQ("location") << ','
         << TQ("location_hash") << ','
         << TQ("metadata") << ','
-        << TQ("ref_id") << ") VALUES ("
+        << TQ("ref_id") << ','
+        << TQ(sortColumns[SORT_TITLE]) << ") VALUES ("
         << newID << ','
         << parentID << ','
         << OBJECT_TYPE_CONTAINER << ','
@@ -937,25 +1543,23 @@ int SQLStorage::createContainer(int parentID, String name, String path, bool isV
         << quote(name) << ','
         << quote(dbLocation) << ','
         << quote(stringHash(dbLocation)) << ','
-        << (metadata == nullptr ? _(SQL_NULL) : metadata->encode()) << ','
-        << (refID > 0 ? quote(refID) : _(SQL_NULL))
+        << (metadata == nullptr ? _(SQL_NULL) : quote(metadata->encodeCompact())) << ','
+        << (refID > 0 ? quote(refID) : _(SQL_NULL)) << ','
+        << (string_ok(sortTitle) ? quote(sortTitle) : _(SQL_NULL))
         << ')';
 
     exec(qb);
+    exec(childCountUpdate(parentID, 1, 0));
+    exec(searchIndexUpdate(newID, name, nullptr));
+    contentChanged(parentID);
+
+    if (!isVirtual && refID <= 0)
+        pathIndex->add(dbLocation, newID);
 
     /* inform cache */
     if (cacheOn()) {
-        AutoLock lock(cache->getMutex());
         cache->addChild(parentID);
-        if (cache->flushed())
-            flushInsertBuffer();
-        Ref<CacheObject> cObj = cache->getObjectDefinitely(newID);
-        if (cache->flushed())
-            flushInsertBuffer();
-        cObj->setParentID(parentID);
-        cObj->setNumChildren(0);
-        cObj->setObjectType(OBJECT_TYPE_CONTAINER);
-        cObj->setLocation(path);
+        cache->addContainer(newID, parentID, path);
     }
     /* ------------ */
 
@@ -1047,39 +1651,24 @@ String SQLStorage::stripLocationPrefix(String path)
 
 Ref<CdsObject> SQLStorage::createObjectFromRow(Ref<SQLRow> row)
 {
-    int objectType = row->col(_object_type).toInt();
+    int objectType = row->col_int(_object_type, 0);
     Ref<CdsObject> obj = CdsObject::createObject(objectType);
 
     /* set common properties */
-    obj->setID(row->col(_id).toInt());
-    obj->setRefID(row->col(_ref_id).toInt());
+    obj->setID(row->col_int(_id, INVALID_OBJECT_ID));
+    obj->setRefID(row->col_int(_ref_id, 0));
 
-    obj->setParentID(row->col(_parent_id).toInt());
+    obj->setParentID(row->col_int(_parent_id, 0));
     obj->setTitle(row->col(_dc_title));
     obj->setClass(fallbackString(row->col(_upnp_class), row->col(_ref_upnp_class)));
-    obj->setFlags(row->col(_flags).toUInt());
-
-    String metadataStr = fallbackString(row->col(_metadata), row->col(_ref_metadata));
-    Ref<Dictionary> meta(new Dictionary());
-    meta->decode(metadataStr);
-    obj->setMetadata(meta);
-
-    String auxdataStr = fallbackString(row->col(_auxdata), row->col(_ref_auxdata));
-    Ref<Dictionary> aux(new Dictionary());
-    aux->decode(auxdataStr);
-    obj->setAuxData(aux);
+    obj->setFlags((unsigned int)row->col_int(_flags, 0));
 
+    // decoded on demand, most callers only need a few of them
     String resources_str = fallbackString(row->col(_resources), row->col(_ref_resources));
-    bool resource_zero_ok = false;
-    if (string_ok(resources_str)) {
-        Ref<Array<StringBase>> resources = split_string(resources_str,
-            RESOURCE_SEP);
-        for (int i = 0; i < resources->size(); i++) {
-            if (i == 0)
-                resource_zero_ok = true;
-            obj->addResource(CdsResource::decode(resources->get(i)));
-        }
-    }
+    bool resource_zero_ok = string_ok(resources_str);
+    obj->setSerializedData(fallbackString(row->col(_metadata), row->col(_ref_metadata)),
+        fallbackString(row->col(_auxdata), row->col(_ref_auxdata)),
+        resources_str);
 
     if ((obj->getRefID() && IS_CDS_PURE_ITEM(objectType)) || (IS_CDS_ITEM(objectType) && !IS_CDS_PURE_ITEM(objectType)))
         obj->setVirtual(true);
@@ -1090,7 +1679,7 @@ Ref<CdsObject> SQLStorage::createObjectFromRow(Ref<SQLRow> row)
 
     if (IS_CDS_CONTAINER(objectType)) {
         Ref<CdsContainer> cont = RefCast(obj, CdsContainer);
-        cont->setUpdateID(row->col(_update_id).toInt());
+        cont->setUpdateID(getUpdateID(cont->getID(), row->col_int(_update_id, 0)));
         char locationPrefix;
         cont->setLocation(stripLocationPrefix(&locationPrefix, row->col(_location)));
         if (locationPrefix == LOC_VIRT_PREFIX)
@@ -1123,7 +1712,7 @@ Ref<CdsObject> SQLStorage::createObjectFromRow(Ref<SQLRow> row)
             item->setLocation(fallbackString(row->col(_location), row->col(_ref_location)));
         }
 
-        item->setTrackNumber(row->col(_track_number).toInt());
+        item->setTrackNumber(row->col_int(_track_number, 0));
 
         if (string_ok(row->col(_ref_service_id)))
             item->setServiceID(row->col(_ref_service_id));
@@ -1136,17 +1725,19 @@ Ref<CdsObject> SQLStorage::createObjectFromRow(Ref<SQLRow> row)
     if (IS_CDS_ACTIVE_ITEM(objectType)) {
         Ref<CdsActiveItem> aitem = RefCast(obj, CdsActiveItem);
 
-        Ref<StringBuffer> query(new StringBuffer());
-        *query << "SELECT " << TQ("id") << ',' << TQ("action") << ','
-               << TQ("state") << " FROM " << TQ(CDS_ACTIVE_ITEM_TABLE)
-               << " WHERE " << TQ("id") << '=' << quote(aitem->getID());
-        Ref<SQLResult> resAI = select(query);
-        Ref<SQLRow> rowAI;
-        if (resAI != nullptr && (rowAI = resAI->nextRow()) != nullptr) {
-            aitem->setAction(rowAI->col(1));
-            aitem->setState(rowAI->col(2));
-        } else
-            throw _Exception(_("Active Item in cds_objects, but not in cds_active_item"));
+        // action and state are only needed when the item is played or edited
+        int objectID = aitem->getID();
+        aitem->setActiveDataLoader([this, objectID](String& action, String& state) {
+            Ref<SQLStatement> stmt(new SQLStatement(activeItemQuery));
+            stmt->bind(objectID);
+            Ref<SQLResult> resAI = select(stmt);
+            Ref<SQLRow> rowAI;
+            if (resAI != nullptr && (rowAI = resAI->nextRow()) != nullptr) {
+                action = rowAI->col(1);
+                state = rowAI->col(2);
+            } else
+                throw _Exception(_("Active Item in cds_objects, but not in cds_active_item"));
+        });
 
         matched_types++;
     }
@@ -1159,6 +1750,211 @@ Ref<CdsObject> SQLStorage::createObjectFromRow(Ref<SQLRow> row)
     return obj;
 }
 
+void SQLStorage::migrateObjectEncoding()
+{
+    const char* columns[] = { "metadata", "auxdata", "resources" };
+
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << "SELECT " << TQ("id") << ',' << TQ("metadata") << ','
+        << TQ("auxdata") << ',' << TQ("resources")
+        << " FROM " << TQ(CDS_OBJECT_TABLE)
+        << " WHERE " << TQ("id") << ">? AND (";
+    for (int i = 0; i < 3; i++) {
+        if (i > 0)
+            *qb << " OR ";
+        *qb << '(' << TQ(columns[i]) << " IS NOT NULL AND "
+            << TQ(columns[i]) << " NOT LIKE '" << DICTIONARY_COMPACT_PREFIX << "%')";
+    }
+    *qb << ") ORDER BY " << TQ("id") << " LIMIT " << MIGRATE_ENCODING_BATCH;
+    String query = qb->toString();
+
+    int lastID = INVALID_OBJECT_ID;
+    int converted = 0;
+    while (true) {
+        // read the whole batch first, the updates must not run while the
+        // result is still open
+        std::vector<Ref<StringBuffer>> updates;
+        Ref<SQLStatement> stmt(new SQLStatement(query));
+        stmt->bind(lastID);
+        Ref<SQLResult> res = select(stmt);
+        Ref<SQLRow> row;
+        while ((row = res->nextRow()) != nullptr) {
+            lastID = row->col_int(0, INVALID_OBJECT_ID);
+            Ref<StringBuffer> ub(new StringBuffer());
+            *ub << "UPDATE " << TQ(CDS_OBJECT_TABLE) << " SET ";
+            for (int i = 0; i < 3; i++) {
+                String value = row->col(i + 1);
+                String encoded = value;
+                if (string_ok(value) && !value.startsWith(_(DICTIONARY_COMPACT_PREFIX))) {
+                    if (i == 2)
+                        encoded = CdsResource::encodeList(CdsResource::decodeList(value));
+                    else {
+                        Ref<Dictionary> dict(new Dictionary());
+                        dict->decode(value);
+                        encoded = dict->size() > 0 ? dict->encodeCompact() : nullptr;
+                    }
+                }
+                if (i > 0)
+                    *ub << ',';
+                *ub << TQ(columns[i]) << '=' << (encoded == nullptr ? _(SQL_NULL) : quote(encoded));
+            }
+            *ub << " WHERE " << TQ("id") << '=' << quote(lastID);
+            updates.push_back(ub);
+        }
+        row = nullptr;
+        res = nullptr;
+
+        if (updates.empty())
+            break;
+
+        beginTransaction();
+        for (auto& update : updates)
+            exec(update);
+        commitTransaction();
+        converted += updates.size();
+    }
+
+    if (converted > 0)
+        log_info("converted metadata and resources of %d objects to the compact encoding\n", converted);
+}
+
+void SQLStorage::migrateSortKeys()
+{
+    // references without own metadata share the one of the original
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << "SELECT " << TQD('f', "id") << ',' << TQD('f', "dc_title")
+        << ",COALESCE(" << TQD('f', "metadata") << ',' << TQD("rf", "metadata") << ')'
+        << " FROM " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('f')
+        << " LEFT JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ("rf")
+        << " ON " << TQD('f', "ref_id") << '=' << TQD("rf", "id")
+        << " WHERE " << TQD('f', "id") << ">?"
+        << " ORDER BY " << TQD('f', "id") << " LIMIT " << SORT_KEY_BATCH;
+    String query = qb->toString();
+
+    int lastID = INVALID_OBJECT_ID;
+    int migrated = 0;
+    while (true) {
+        std::vector<Ref<StringBuffer>> updates;
+        Ref<SQLStatement> stmt(new SQLStatement(query));
+        stmt->bind(lastID);
+        Ref<SQLResult> res = select(stmt);
+        Ref<SQLRow> row;
+        while ((row = res->nextRow()) != nullptr) {
+            lastID = row->col_int(0, INVALID_OBJECT_ID);
+            Ref<Dictionary> metadata = nullptr;
+            String encoded = row->col(2);
+            if (string_ok(encoded)) {
+                metadata = Ref<Dictionary>(new Dictionary());
+                metadata->decodeCompact(encoded);
+            }
+            Ref<StringBuffer> ub(new StringBuffer());
+            *ub << "UPDATE " << TQ(CDS_OBJECT_TABLE) << " SET ";
+            for (int i = 0; i < SORT_TRACK; i++) {
+                String key = SortCriteria::getKey((sort_field_t)i, row->col(1), metadata);
+                if (i > 0)
+                    *ub << ',';
+                *ub << TQ(sortColumns[i]) << '=' << (string_ok(key) ? quote(key) : _(SQL_NULL));
+            }
+            *ub << " WHERE " << TQ("id") << '=' << quote(lastID);
+            updates.push_back(ub);
+        }
+        row = nullptr;
+        res = nullptr;
+
+        if (updates.empty())
+            break;
+
+        beginTransaction();
+        for (auto& update : updates)
+            exec(update);
+        commitTransaction();
+        migrated += updates.size();
+    }
+
+    log_info("added sort keys to %d objects\n", migrated);
+}
+
+Ref<SQLStatement> SQLStorage::searchIndexUpdate(int id, String title, Ref<Dictionary> metadata)
+{
+    Ref<StringBuffer> qb(new StringBuffer(256));
+    *qb << "REPLACE INTO " << TQ(CDS_SEARCH_TABLE) << " (" << TQ(searchIDColumn);
+    for (int i = 0; searchColumns[i].property != nullptr; i++)
+        *qb << ',' << TQ(searchColumns[i].column);
+    *qb << ") VALUES (?";
+    for (int i = 0; searchColumns[i].property != nullptr; i++)
+        *qb << ",?";
+    *qb << ')';
+
+    Ref<SQLStatement> stmt(new SQLStatement(qb->toString()));
+    stmt->bind(id);
+    for (int i = 0; searchColumns[i].property != nullptr; i++) {
+        String value = title;
+        if (searchColumns[i].field != M_TITLE)
+            value = (metadata != nullptr) ? metadata->get(MetadataHandler::getMetaFieldName(searchColumns[i].field)) : nullptr;
+        stmt->bind(string_ok(value) ? value : nullptr);
+    }
+    return stmt;
+}
+
+void SQLStorage::initSearchIndex()
+{
+    String indexType = getSearchIndexType();
+    if (getInternalSetting(_("search_index")) == indexType)
+        return;
+
+    log_info("Creating the search index...\n");
+    createSearchIndex();
+    rebuildSearchIndex();
+    storeInternalSetting(_("search_index"), indexType);
+}
+
+void SQLStorage::rebuildSearchIndex()
+{
+    // references without own metadata share the one of the original
+    Ref<StringBuffer> qb(new StringBuffer());
+    *qb << "SELECT " << TQD('f', "id") << ',' << TQD('f', "dc_title")
+        << ",COALESCE(" << TQD('f', "metadata") << ',' << TQD("rf", "metadata") << ')'
+        << " FROM " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('f')
+        << " LEFT JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ("rf")
+        << " ON " << TQD('f', "ref_id") << '=' << TQD("rf", "id")
+        << " WHERE " << TQD('f', "id") << ">?"
+        << " ORDER BY " << TQD('f', "id") << " LIMIT " << SEARCH_INDEX_BATCH;
+    String query = qb->toString();
+
+    int lastID = INVALID_OBJECT_ID;
+    int indexed = 0;
+    while (true) {
+        std::vector<Ref<SQLStatement>> updates;
+        Ref<SQLStatement> stmt(new SQLStatement(query));
+        stmt->bind(lastID);
+        Ref<SQLResult> res = select(stmt);
+        Ref<SQLRow> row;
+        while ((row = res->nextRow()) != nullptr) {
+            lastID = row->col_int(0, INVALID_OBJECT_ID);
+            Ref<Dictionary> metadata = nullptr;
+            String encoded = row->col(2);
+            if (string_ok(encoded)) {
+                metadata = Ref<Dictionary>(new Dictionary());
+                metadata->decodeCompact(encoded);
+            }
+            updates.push_back(searchIndexUpdate(lastID, row->col(1), metadata));
+        }
+        row = nullptr;
+        res = nullptr;
+
+        if (updates.empty())
+            break;
+
+        beginTransaction();
+        for (auto& update : updates)
+            exec(update);
+        commitTransaction();
+        indexed += updates.size();
+    }
+
+    log_info("added %d objects to the search index\n", indexed);
+}
+
 int SQLStorage::getTotalFiles()
 {
     flushInsertBuffer();
@@ -1179,105 +1975,317 @@ String SQLStorage::incrementUpdateIDs(shared_ptr<unordered_set<int>> ids)
 {
     if (ids->empty())
         return nullptr;
-    Ref<StringBuffer> inBuf(new StringBuffer()); // ??? what was that: size * sizeof(int)));
 
-    bool first = true;
-    for (const auto& id : *ids) {
-        if (first) {
-            *inBuf << "IN (" << id;
-            first = false;
-        } else {
-            *inBuf << ',' << id;
+    // control points browse the changed containers right after the event
+    commitWrites();
+    contentGeneration++;
+
+    std::vector<int> unknown;
+    {
+        AutoLock lock(updateIDMutex);
+        for (const auto& id : *ids) {
+            if (updateIDs.find(id) == updateIDs.end())
+                unknown.push_back(id);
+        }
+    }
+
+    // only containers not seen since startup are read from the table, in
+    // chunks of a fixed size so that the statement text never changes
+    std::unordered_map<int, int> loaded;
+    if (!unknown.empty()) {
+        Ref<StringBuffer> qb(new StringBuffer());
+        *qb << "SELECT " << TQ("id") << ',' << TQ("update_id") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE " << TQ("id") << " IN (?";
+        for (int i = 1; i < UPDATE_ID_SELECT_BATCH; i++)
+            *qb << ",?";
+        *qb << ')';
+        String query = qb->toString();
+        for (size_t first = 0; first < unknown.size(); first += UPDATE_ID_SELECT_BATCH) {
+            Ref<SQLStatement> stmt(new SQLStatement(query));
+            // the last chunk is padded by repeating its last id
+            for (size_t i = first; i < first + UPDATE_ID_SELECT_BATCH; i++)
+                stmt->bind(unknown[std::min(i, unknown.size() - 1)]);
+            Ref<SQLResult> res = select(stmt);
+            if (res == nullptr)
+                throw _Exception(_("Error while fetching update ids"));
+            Ref<SQLRow> row;
+            while ((row = res->nextRow()) != nullptr)
+                loaded[row->col_int(0, INVALID_OBJECT_ID)] = row->col_int(1, 0);
         }
     }
-    *inBuf << ')';
 
     Ref<StringBuffer> buf(new StringBuffer());
-    *buf << "UPDATE " << TQ(CDS_OBJECT_TABLE) << " SET " << TQ("update_id") << '=' << TQ("update_id") << " + 1 WHERE " << TQ("id") << ' ';
-    *buf << inBuf;
-    exec(buf);
+    bool flush;
+    {
+        AutoLock lock(updateIDMutex);
+        for (const auto& id : *ids) {
+            auto it = updateIDs.find(id);
+            if (it == updateIDs.end()) {
+                auto stored = loaded.find(id);
+                if (stored == loaded.end())
+                    continue; // removed in the meantime
+                it = updateIDs.emplace(id, stored->second).first;
+            }
+            it->second++;
+            dirtyUpdateIDs.insert(id);
+            *buf << ',' << id << ',' << it->second;
+        }
+
+        struct timespec now;
+        getTimespecNow(&now);
+        flush = dirtyUpdateIDs.size() >= UPDATE_ID_FLUSH_COUNT
+            || getDeltaMillis(&lastUpdateIDFlush, &now) >= UPDATE_ID_FLUSH_INTERVAL;
+    }
+    if (flush)
+        flushUpdateIDs();
 
-    buf->clear();
-    *buf << "SELECT " << TQ("id") << ',' << TQ("update_id") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE " << TQ("id") << ' ';
-    *buf << inBuf;
-    Ref<SQLResult> res = select(buf);
-    if (res == nullptr)
-        throw _Exception(_("Error while fetching update ids"));
-    Ref<SQLRow> row;
-    buf->clear();
-    while ((row = res->nextRow()) != nullptr)
-        *buf << ',' << row->col(0) << ',' << row->col(1);
     if (buf->length() <= 0)
         return nullptr;
     return buf->toString(1);
 }
 
-// id is the parent_id for cover media to find, and if set, trackArtBase is the case-folded
-// name of the track to try as artwork; we rely on LIKE being case-insensitive
+int SQLStorage::getUpdateID(int objectID, int storedUpdateID)
+{
+    AutoLock lock(updateIDMutex);
+    auto it = updateIDs.find(objectID);
+    if (it == updateIDs.end())
+        return storedUpdateID;
+    return it->second;
+}
+
+void SQLStorage::forgetUpdateIDs(const std::unordered_set<int>& ids)
+{
+    AutoLock lock(updateIDMutex);
+    for (int id : ids) {
+        updateIDs.erase(id);
+        dirtyUpdateIDs.erase(id);
+    }
+}
+
+void SQLStorage::flushUpdateIDs()
+{
+    std::vector<std::pair<int, int>> pending;
+    {
+        AutoLock lock(updateIDMutex);
+        getTimespecNow(&lastUpdateIDFlush);
+        for (int id : dirtyUpdateIDs)
+            pending.emplace_back(id, updateIDs[id]);
+        dirtyUpdateIDs.clear();
+    }
+    if (pending.empty())
+        return;
+
+    log_debug("writing back %d container update ids\n", (int)pending.size());
+    Ref<StringBuffer> ids(new StringBuffer());
+    Ref<StringBuffer> buf(new StringBuffer());
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (buf->length() == 0)
+            *buf << "UPDATE " << TQ(CDS_OBJECT_TABLE) << " SET " << TQ("update_id") << "=CASE " << TQ("id");
+        *buf << " WHEN " << pending[i].first << " THEN " << pending[i].second;
+        *ids << ',' << pending[i].first;
+        if ((i + 1) % UPDATE_ID_FLUSH_BATCH == 0 || i + 1 == pending.size()) {
+            *buf << " END WHERE " << TQ("id") << " IN (";
+            buf->concat(ids, 1);
+            *buf << ')';
+            exec(buf);
+            buf->clear();
+            ids->clear();
+        }
+    }
+}
 
 // This limit massively improves performance, but is not currently usable on MySql and MariaDB, apparently
 // Since the actual driver in use is determined at runtime, not build time, we check for sqlite3 and
 // only run when that's what we are using.
 #define MAX_ART_CONTAINERS 100
 
+// number of containers kept in the folder art index before it is cleared
+#define FOLDER_ART_INDEX_MAXFILL 9973u
+
+// folder.jpg or cover.jpg [and variants], title is expected to be case-folded
+static bool isFolderArtName(String title)
+{
+    if (title.startsWith(_("cover.jp"))
+        || title.startsWith(_("album.jp"))
+        || title.startsWith(_("front.jp"))
+        || title.startsWith(_("folder.jp")))
+        return true;
+    return title.startsWith(_("albumart")) && title.substring(8).find(".jp") >= 0;
+}
+
+String SQLStorage::FolderArt::find(String trackArtBase)
+{
+    if (string_ok(trackArtBase)) {
+        String trackArtName = trackArtBase + ".jp";
+        for (auto const& image : images) {
+            if (String(image.first).startsWith(trackArtName))
+                return String::from(image.second);
+        }
+    }
+    for (auto const& image : images) {
+        if (isFolderArtName(image.first))
+            return String::from(image.second);
+    }
+    return nullptr;
+}
+
+// id is the parent_id for cover media to find, and if set, trackArtBase is the case-folded
+// name of the track to try as artwork
 String SQLStorage::findFolderImage(int id, String trackArtBase)
 {
+    return getFolderArt(id)->find(trackArtBase);
+}
+
+Ref<CdsItem> SQLStorage::findEmbeddedArtItem(int id)
+{
+    Ref<FolderArt> art = getFolderArt(id);
+    {
+        AutoLock lock(folderArtMutex);
+        if (art->embeddedArtResolved)
+            return art->embeddedArtItem;
+    }
+
+    // first music track below the container that carries an album art resource
     Ref<StringBuffer> q(new StringBuffer());
-    // folder.jpg or cover.jpg [and variants]
-    // note - "_" is regexp "." and "%" is regexp ".*" in sql LIKE land
-    *q << "SELECT " << TQ("id") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE ";
-    *q << "( ";
-    if (trackArtBase.length() > 0) {
-        *q << TQ("dc_title") << "LIKE " << quote(trackArtBase + _(".jp%")) << " OR ";
-    }
-    *q << TQ("dc_title") << "LIKE " << quote(_("cover.jp%")) << " OR ";
-    *q << TQ("dc_title") << "LIKE " << quote(_("albumart%.jp%")) << " OR ";
-    *q << TQ("dc_title") << "LIKE " << quote(_("album.jp%")) << " OR ";
-    *q << TQ("dc_title") << "LIKE " << quote(_("front.jp%")) << " OR ";
-    *q << TQ("dc_title") << "LIKE " << quote(_("folder.jp%"));
-    *q << " ) AND ";
-    *q << TQ("upnp_class") << '=' << quote(_(UPNP_DEFAULT_CLASS_IMAGE_ITEM)) << " AND ";
+    *q << SQL_QUERY << " WHERE " << TQD('f', "parent_id") << '=' << id
+       << " AND " << TQD('f', "object_type") << " & " << OBJECT_TYPE_ITEM
+       << " = " << OBJECT_TYPE_ITEM;
+    Ref<SQLResult> res = select(q);
+    if (res == nullptr)
+        throw _Exception(_("db error"));
+
+    Ref<CdsItem> artItem;
+    Ref<SQLRow> row;
+    while (artItem == nullptr && (row = res->nextRow()) != nullptr) {
+        String upnpClass = fallbackString(row->col(_upnp_class), row->col(_ref_upnp_class));
+        if (upnpClass != UPNP_DEFAULT_CLASS_MUSIC_TRACK)
+            continue;
+
+        Ref<Array<CdsResource>> resources = CdsResource::decodeList(fallbackString(row->col(_resources), row->col(_ref_resources)));
+        for (int i = 1; i < resources->size(); i++) {
+            int handlerType = resources->get(i)->getHandlerType();
+            if ((handlerType == CH_ID3) || (handlerType == CH_MP4) || (handlerType == CH_FLAC) || (handlerType == CH_FANART) || (handlerType == CH_EXTURL)) {
+                artItem = RefCast(createObjectFromRow(row), CdsItem);
+                break;
+            }
+        }
+    }
+
+    AutoLock lock(folderArtMutex);
+    art->embeddedArtItem = artItem;
+    art->embeddedArtResolved = true;
+    return artItem;
+}
+
+Ref<SQLStorage::FolderArt> SQLStorage::getFolderArt(int id)
+{
+    unsigned long long generation;
+    {
+        AutoLock lock(folderArtMutex);
+        auto it = folderArtIndex.find(id);
+        if (it != folderArtIndex.end())
+            return it->second;
+        generation = folderArtGeneration;
+    }
+
+    // directories the artwork may come from: the container itself and,
+    // for a virtual listing via Album, Artist etc, the directories of the
+    // tracks it references
+    std::vector<int> sources;
+    sources.push_back(id);
 #ifndef ONLY_REAL_FOLDER_ART
-    *q << "( ";
-    *q <<       "( ";
-        // virtual listing via Album, Artist etc
-    *q << TQ("parent_id") << " IN ";
-    *q <<       "(";
-    *q << "SELECT " << TQ("parent_id") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE ";
+    Ref<StringBuffer> q(new StringBuffer());
+    *q << "SELECT DISTINCT " << TQ("parent_id") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE ";
     *q << TQ("upnp_class") << '=' << quote(_(UPNP_DEFAULT_CLASS_MUSIC_TRACK)) << " AND ";
     *q << TQ("id") << " IN ";
-    *q <<               "(";
+    *q <<       "(";
     *q << "SELECT " << TQ("ref_id") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE ";
     *q << TQ("parent_id") << '=' << quote(String::from(id)) << " AND ";
     *q << TQ("object_type") << '=' << quote(OBJECT_TYPE_ITEM);
 
     // only use this optimization on sqlite3
     if (ConfigManager::getInstance()->getOption(CFG_SERVER_STORAGE_DRIVER) == "sqlite3") {
-        *q <<               " LIMIT " << MAX_ART_CONTAINERS << ")";
+        *q <<       " LIMIT " << MAX_ART_CONTAINERS << ")";
     } else {
-        *q <<               ")";
+        *q <<       ")";
     }
-    *q <<       ")";
-    *q << "     ) OR ";
-#endif
-        // straightforward folder listing of real filesystem
-    *q << TQ("parent_id") << '=' << quote(String::from(id));
-#ifndef ONLY_REAL_FOLDER_ART
-    *q << ")";
-#endif
-    *q << " LIMIT 1";
 
-    //log_debug("findFolderImage %d, %s\n", id, q->c_str());
     Ref<SQLResult> res = select(q);
     if (res == nullptr)
         throw _Exception(_("db error"));
     Ref<SQLRow> row;
-    if ((row = res->nextRow()) != nullptr) // we only care about the first result
-    {
-        log_debug("findFolderImage result: %s\n", row->col(0).c_str());
-        return row->col(0);
+    while ((row = res->nextRow()) != nullptr) {
+        int source = row->col_int(0, INVALID_OBJECT_ID);
+        if (source != INVALID_OBJECT_ID && source != id)
+            sources.push_back(source);
+    }
+#endif
+
+    // collect all jpeg images that may serve as artwork for the container,
+    // LIKE is case-insensitive, matching against the art names is done in
+    // FolderArt::find()
+    Ref<StringBuffer> qi(new StringBuffer());
+    *qi << "SELECT " << TQ("id") << ',' << TQ("dc_title") << " FROM " << TQ(CDS_OBJECT_TABLE) << " WHERE ";
+    *qi << TQ("dc_title") << " LIKE " << quote(_("%.jp%")) << " AND ";
+    *qi << TQ("upnp_class") << '=' << quote(_(UPNP_DEFAULT_CLASS_IMAGE_ITEM)) << " AND ";
+    *qi << TQ("parent_id") << " IN (";
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (i > 0)
+            *qi << ',';
+        *qi << sources[i];
+    }
+    *qi << ") ORDER BY " << TQ("id");
+
+    Ref<SQLResult> images = select(qi);
+    if (images == nullptr)
+        throw _Exception(_("db error"));
+
+    Ref<FolderArt> art(new FolderArt());
+    Ref<SQLRow> image;
+    while ((image = images->nextRow()) != nullptr)
+        art->images.push_back(std::make_pair(image->col(1).toLower(), image->col(0).toInt()));
+    log_debug("folder art index: %d candidate images for container %d\n", (int)art->images.size(), id);
+
+    AutoLock lock(folderArtMutex);
+    // an image or track was added while the lookup ran
+    if (generation != folderArtGeneration)
+        return art;
+    if (folderArtIndex.size() >= FOLDER_ART_INDEX_MAXFILL) {
+        folderArtIndex.clear();
+        folderArtSources.clear();
+    }
+    folderArtIndex[id] = art;
+    for (int source : sources)
+        folderArtSources[source].insert(id);
+    return art;
+}
+
+void SQLStorage::invalidateFolderArt(Ref<CdsObject> obj, int oldParentID)
+{
+    if (obj == nullptr) {
+        AutoLock lock(folderArtMutex);
+        folderArtGeneration++;
+        folderArtIndex.clear();
+        folderArtSources.clear();
+        return;
+    }
+
+    // a new or changed image or track may change the artwork of its
+    // directory and of the containers that reference tracks in it
+    if (!IS_CDS_ITEM(obj->getObjectType()) || (obj->getClass() != UPNP_DEFAULT_CLASS_IMAGE_ITEM && obj->getClass() != UPNP_DEFAULT_CLASS_MUSIC_TRACK))
+        return;
+    AutoLock lock(folderArtMutex);
+    folderArtGeneration++;
+    for (int parentID : { obj->getParentID(), oldParentID }) {
+        if (parentID == INVALID_OBJECT_ID)
+            continue;
+        folderArtIndex.erase(parentID);
+        auto it = folderArtSources.find(parentID);
+        if (it == folderArtSources.end())
+            continue;
+        for (int id : it->second)
+            folderArtIndex.erase(id);
+        folderArtSources.erase(it);
     }
-    return nullptr;
 }
 
 /*
@@ -1334,18 +2342,14 @@ shared_ptr<unordered_set<int>> SQLStorage::getObjects(int parentID, bool without
         throw _Exception(_("db error"));
     Ref<SQLRow> row;
 
-    if (res->getNumRows() <= 0)
-        return nullptr;
-
-    unsigned long long capacity = res->getNumRows() * 5 + 1;
-    if (capacity < 521)
-        capacity = 521;
-
+    // the number of rows is only known after reading them all
     shared_ptr<unordered_set<int>> ret = make_shared<unordered_set<int>>();
 
     while ((row = res->nextRow()) != nullptr) {
-        ret->insert(row->col(0).toInt());
+        ret->insert(row->col_int(0, INVALID_OBJECT_ID));
     }
+    if (ret->empty())
+        return nullptr;
     return ret;
 }
 
@@ -1388,8 +2392,16 @@ Ref<Storage::ChangedContainers> SQLStorage::removeObjects(shared_ptr<unordered_s
     return _purgeEmptyContainers(_recursiveRemove(items, containers, all));
 }
 
-void SQLStorage::_removeObjects(Ref<StringBuffer> objectIDs, int offset)
+void SQLStorage::_removeObjects(Ref<StringBuffer> objectIDs, int offset, bool updateParents)
 {
+    std::unordered_set<int> ids;
+    const char* idList = objectIDs->c_str() + offset;
+    char* next;
+    for (int id = (int)strtol(idList, &next, 10); next != idList; id = (int)strtol(idList, &next, 10)) {
+        ids.insert(id);
+        idList = (*next == ',') ? next + 1 : next;
+    }
+
     Ref<StringBuffer> q(new StringBuffer());
     *q << "SELECT " << TQD('a', "id") << ',' << TQD('a', "persistent")
        << ',' << TQD('o', "location")
@@ -1433,6 +2445,32 @@ void SQLStorage::_removeObjects(Ref<StringBuffer> objectIDs, int offset)
         }
     }
 
+    if (updateParents) {
+        q->clear();
+        *q << "SELECT " << TQ("parent_id") << ',' << TQ("object_type")
+           << " FROM " << TQ(CDS_OBJECT_TABLE)
+           << " WHERE " << TQ("id") << " IN (";
+        q->concat(objectIDs, offset);
+        *q << ')';
+        res = select(q);
+        // parents removed by the same call need no update
+        unordered_map<int, std::pair<int, int>> removedChildren;
+        Ref<SQLRow> row;
+        while (res != nullptr && (row = res->nextRow()) != nullptr) {
+            int parentID = row->col_int(0, INVALID_OBJECT_ID);
+            if (ids.find(parentID) != ids.end())
+                continue;
+            if (IS_CDS_CONTAINER(row->col_int(1, 0)))
+                removedChildren[parentID].first--;
+            else
+                removedChildren[parentID].second--;
+        }
+        for (auto const& parent : removedChildren) {
+            exec(childCountUpdate(parent.first, parent.second.first, parent.second.second));
+            contentChanged(parent.first);
+        }
+    }
+
     q->clear();
     *q << "DELETE FROM " << TQ(CDS_ACTIVE_ITEM_TABLE)
        << " WHERE " << TQ("id") << " IN (";
@@ -1440,12 +2478,28 @@ void SQLStorage::_removeObjects(Ref<StringBuffer> objectIDs, int offset)
     *q << ')';
     exec(q);
 
+    q->clear();
+    *q << "DELETE FROM " << TQ(CDS_SEARCH_TABLE)
+       << " WHERE " << TQ(searchIDColumn) << " IN (";
+    q->concat(objectIDs, offset);
+    *q << ')';
+    exec(q);
+
     q->clear();
     *q << "DELETE FROM " << TQ(CDS_OBJECT_TABLE)
        << " WHERE " << TQ("id") << " IN (";
     q->concat(objectIDs, offset);
     *q << ')';
     exec(q);
+
+    for (int id : ids) {
+        pathIndex->remove(id);
+        contentChanged(id);
+    }
+    forgetUpdateIDs(ids);
+
+    invalidateFolderArt(nullptr);
+    invalidateBrowseCursors(INVALID_OBJECT_ID);
 }
 
 Ref<Storage::ChangedContainers> SQLStorage::removeObject(int objectID, bool all)
@@ -1488,6 +2542,9 @@ Ref<Storage::ChangedContainers> SQLStorage::removeObject(int objectID, bool all)
 
 Ref<SQLStorage::ChangedContainersStr> SQLStorage::_recursiveRemove(Ref<StringBuffer> items, Ref<StringBuffer> containers, bool all)
 {
+    if (recursiveQueries)
+        return _removeSubtree(items, containers, all);
+
     log_debug("start\n");
     Ref<StringBuffer> recurseItems(new StringBuffer());
     *recurseItems << "SELECT DISTINCT " << TQ("id") << ',' << TQ("parent_id")
@@ -1617,6 +2674,102 @@ Ref<SQLStorage::ChangedContainersStr> SQLStorage::_recursiveRemove(Ref<StringBuf
     return changedContainers;
 }
 
+Ref<SQLStorage::ChangedContainersStr> SQLStorage::_removeSubtree(Ref<StringBuffer> items, Ref<StringBuffer> containers, bool all)
+{
+    Ref<ChangedContainersStr> changedContainers(new ChangedContainersStr());
+    Ref<StringBuffer> roots(new StringBuffer());
+    if (items != nullptr && items->length() > 1)
+        *roots << items;
+    if (containers != nullptr && containers->length() > 1)
+        *roots << containers;
+    if (roots->length() <= 1)
+        return changedContainers;
+
+    // the subtree grows by the children of removed objects, the references
+    // to removed items and, if all is set, the originals of removed references
+    Ref<StringBuffer> q(new StringBuffer());
+    *q << "WITH RECURSIVE " << TQ("subtree") << '(' << TQ("id") << ',' << TQ("ref_id") << ") AS ("
+       << "SELECT " << TQ("id") << ',' << TQ("ref_id")
+       << " FROM " << TQ(CDS_OBJECT_TABLE)
+       << " WHERE " << TQ("id") << " IN (";
+    q->concat(roots, 1);
+    *q << ") UNION SELECT " << TQD('o', "id") << ',' << TQD('o', "ref_id")
+       << " FROM " << TQ("subtree") << ' ' << TQ('s')
+       << " JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('o')
+       << " ON " << TQD('o', "parent_id") << '=' << TQD('s', "id")
+       << " OR " << TQD('o', "ref_id") << '=' << TQD('s', "id");
+    if (all)
+        *q << " OR " << TQD('o', "id") << '=' << TQD('s', "ref_id");
+    *q << ") SELECT " << TQD('s', "id") << ',' << TQD('o', "parent_id")
+       << ',' << TQD('o', "object_type")
+       << " FROM " << TQ("subtree") << ' ' << TQ('s')
+       << " JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('o')
+       << " ON " << TQD('o', "id") << '=' << TQD('s', "id");
+
+    Ref<SQLResult> res = select(q);
+    if (res == nullptr)
+        throw _StorageException(nullptr, _("sql error"));
+
+    std::vector<int> ids;
+    std::unordered_set<int> removed;
+    std::vector<std::pair<int, int>> parents;
+    Ref<SQLRow> row;
+    while ((row = res->nextRow()) != nullptr) {
+        int id = row->col_int(0, INVALID_OBJECT_ID);
+        if (IS_FORBIDDEN_CDS_ID(id))
+            throw _Exception(_("tried to delete a forbidden ID (") + id + ")!");
+        ids.push_back(id);
+        removed.insert(id);
+        parents.emplace_back(row->col_int(1, INVALID_OBJECT_ID), row->col_int(2, 0));
+    }
+    row = nullptr;
+    res = nullptr;
+
+    // only the parents that survive the removal have changed
+    std::unordered_set<int> uiParents;
+    std::unordered_set<int> upnpParents;
+    unordered_map<int, std::pair<int, int>> removedChildren;
+    for (auto& parent : parents) {
+        if (removed.find(parent.first) != removed.end())
+            continue;
+        if (IS_CDS_CONTAINER(parent.second)) {
+            removedChildren[parent.first].first--;
+            if (uiParents.insert(parent.first).second)
+                *changedContainers->ui << ',' << parent.first;
+        } else {
+            removedChildren[parent.first].second--;
+            if (upnpParents.insert(parent.first).second)
+                *changedContainers->upnp << ',' << parent.first;
+        }
+    }
+
+    log_debug("removing %d objects\n", (int)ids.size());
+    beginTransaction();
+    try {
+        Ref<StringBuffer> remove(new StringBuffer());
+        for (size_t i = 0; i < ids.size(); i++) {
+            *remove << ',' << ids[i];
+            if ((i + 1) % REMOVE_BATCH_IDS == 0) {
+                _removeObjects(remove, 1, false);
+                remove->clear();
+            }
+        }
+        if (remove->length() > 0)
+            _removeObjects(remove, 1, false);
+        for (auto const& parent : removedChildren) {
+            exec(childCountUpdate(parent.first, parent.second.first, parent.second.second));
+            contentChanged(parent.first);
+        }
+        commitTransaction();
+    } catch (const Exception&) {
+        rollbackTransaction();
+        // ids of the rolled back batches are already gone from the index
+        loadPathIndex();
+        throw;
+    }
+    return changedContainers;
+}
+
 void SQLStorage::addCSV(String csv, std::vector<int>& target)
 {
     const char sep = ',';
@@ -1659,16 +2812,14 @@ Ref<Storage::ChangedContainers> SQLStorage::_purgeEmptyContainers(Ref<ChangedCon
         return changedContainers;
 
     Ref<StringBuffer> bufSelUI(new StringBuffer());
-    *bufSelUI << "SELECT " << TQD('a', "id")
-              << ", COUNT(" << TQD('b', "parent_id")
-              << ")," << TQD('a', "parent_id") << ',' << TQD('a', "flags")
-              << " FROM " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('a')
-              << " LEFT JOIN " << TQ(CDS_OBJECT_TABLE) << ' ' << TQ('b')
-              << " ON " << TQD('a', "id") << '=' << TQD('b', "parent_id")
-              << " WHERE " << TQD('a', "object_type") << '=' << quote(1)
-              << " AND " << TQD('a', "id") << " IN ("; //(a.flags & " << OBJECT_FLAG_PERSISTENT_CONTAINER << ") = 0 AND
+    *bufSelUI << "SELECT " << TQ("id")
+              << ',' << TQ("child_containers") << '+' << TQ("child_items")
+              << ',' << TQ("parent_id") << ',' << TQ("flags")
+              << " FROM " << TQ(CDS_OBJECT_TABLE)
+              << " WHERE " << TQ("object_type") << '=' << quote(1)
+              << " AND " << TQ("id") << " IN ("; //(flags & " << OBJECT_FLAG_PERSISTENT_CONTAINER << ") = 0 AND
     int bufSelLen = bufSelUI->length();
-    String strSel2 = _(") GROUP BY a.id"); // HAVING COUNT(b.parent_id)=0");
+    String strSel2 = _(")");
 
     Ref<StringBuffer> bufSelUpnp(new StringBuffer());
     *bufSelUpnp << bufSelUI;
@@ -2279,24 +3430,18 @@ void SQLStorage::loadLastID()
         throw _Exception(_("could not load correct lastID (db not initialized?)"));
 }
 
-void SQLStorage::addObjectToCache(Ref<CdsObject> object, bool dontLock)
+void SQLStorage::addObjectToCache(Ref<CdsObject> object)
 {
-    if (cacheOn() && object != nullptr) {
-        unique_lock<std::mutex> lock(cache->getMutex(), std::defer_lock);
-        if (!dontLock)
-            lock.lock();
-        Ref<CacheObject> cObj = cache->getObjectDefinitely(object->getID());
-        if (cache->flushed())
-            flushInsertBuffer();
-        cObj->setObject(object);
-        cache->checkLocation(cObj);
-    }
+    if (cacheOn() && object != nullptr)
+        cache->addObject(object);
 }
 
-void SQLStorage::addToInsertBuffer(Ref<StringBuffer> query)
+void SQLStorage::addToInsertBuffer(Ref<SQLStatement> stmt)
 {
     assert(doInsertBuffering());
 
+    // the buffer is sent as one multi-statement exec, so it holds text
+    Ref<StringBuffer> query = renderStatement(stmt);
     AutoLock lock(mutex);
     _addToInsertBuffer(query);
 
@@ -2339,4 +3484,7 @@ void SQLStorage::clearFlagInDB(int flag)
         << TQ("flags")
         << "&" << flag;
     exec(qb);
+    contentGeneration++;
+    if (didlCache != nullptr)
+        didlCache->clear();
 }
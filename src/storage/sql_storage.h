@@ -35,9 +35,12 @@
 #include "zmm/zmmf.h"
 #include "cds_objects.h"
 #include "dictionary.h"
+#include "path_index.h"
 #include "storage.h"
 #include "storage_cache.h"
 
+#include <atomic>
+#include <unordered_map>
 #include <unordered_set>
 #include <mutex>
 
@@ -48,6 +51,7 @@
 #define CDS_ACTIVE_ITEM_TABLE       "mt_cds_active_item"
 #define INTERNAL_SETTINGS_TABLE     "mt_internal_setting"
 #define AUTOSCAN_TABLE              "mt_autoscan"
+#define CDS_SEARCH_TABLE            "mt_cds_search"
 
 class SQLResult;
 
@@ -58,16 +62,66 @@ public:
     //virtual ~SQLRow();
     zmm::String col(int index) { return col_c_str(index); }
     virtual char* col_c_str(int index) = 0;
+
+    /// \brief returns the column as integer without creating a String
+    /// \param index column index
+    /// \param null_value value to return if the column is NULL
+    virtual int col_int(int index, int null_value)
+    {
+        char *c = col_c_str(index);
+        if (c == nullptr)
+            return null_value;
+        return (int)strtol(c, nullptr, 10);
+    }
 protected:
     zmm::Ref<SQLResult> sqlResult;
 };
 
+/// \brief A SQL query with "?" placeholders and the parameters bound to them.
+///
+/// Drivers that support prepared statements keep the compiled statement
+/// for each distinct query text, all others get the parameters quoted
+/// into the query text.
+class SQLStatement : public zmm::Object
+{
+public:
+    SQLStatement(zmm::String query) { this->query = query; }
+
+    zmm::String getQuery() { return query; }
+
+    /// \brief binds the next parameter, in the order of the placeholders
+    void bind(long long val) { params.push_back(Param(val)); }
+    /// \brief binds the next parameter, nullptr binds NULL
+    void bind(zmm::String val) { params.push_back(Param(val)); }
+
+    int getParamCount() { return params.size(); }
+    bool isIntParam(int index) { return params[index].isInt; }
+    long long getIntParam(int index) { return params[index].intVal; }
+    zmm::String getStringParam(int index) { return params[index].strVal; }
+
+protected:
+    class Param
+    {
+    public:
+        Param(long long val) { isInt = true; intVal = val; }
+        Param(zmm::String val) { isInt = false; intVal = 0; strVal = val; }
+        bool isInt;
+        long long intVal;
+        zmm::String strVal;
+    };
+
+    zmm::String query;
+    std::vector<Param> params;
+};
+
 class SQLResult : public zmm::Object
 {
 public:
     //SQLResult();
     //virtual ~SQLResult();
     virtual zmm::Ref<SQLRow> nextRow() = 0;
+    /// \brief number of rows of the result, drivers that stream their
+    /// results only know the rows returned by nextRow() so far
     virtual unsigned long long getNumRows() = 0;
 };
 
@@ -94,6 +148,14 @@ public:
     int exec(zmm::Ref<zmm::StringBuffer> buf, bool getLastInsertId = false)
         { return exec(buf->c_str(), buf->length(), getLastInsertId); }
     
+    /// \brief runs a parameterized select, drivers with prepared statement
+    /// support override this, the default quotes the parameters into the query
+    virtual zmm::Ref<SQLResult> select(zmm::Ref<SQLStatement> stmt)
+        { return select(renderStatement(stmt)); }
+    /// \brief runs a parameterized exec, like select(Ref<SQLStatement>)
+    virtual int exec(zmm::Ref<SQLStatement> stmt, bool getLastInsertId = false)
+        { return exec(renderStatement(stmt), getLastInsertId); }
+    
     virtual void addObject(zmm::Ref<CdsObject> object, int *changedContainer) override;
     virtual void updateObject(zmm::Ref<CdsObject> object, int *changedContainer) override;
     
@@ -111,11 +173,13 @@ public:
     virtual std::unique_ptr<std::vector<int>> getServiceObjectIDs(char servicePrefix) override;
 
     virtual zmm::String findFolderImage(int id, zmm::String trackArtBase) override;
+    virtual zmm::Ref<CdsItem> findEmbeddedArtItem(int id) override;
     
     /* accounting methods */
     virtual int getTotalFiles() override;
     
     virtual zmm::Ref<zmm::Array<CdsObject> > browse(zmm::Ref<BrowseParam> param) override;
+    virtual zmm::Ref<zmm::Array<CdsObject> > search(zmm::Ref<SearchParam> param) override;
     virtual zmm::Ref<zmm::Array<zmm::StringBase> > getMimeTypes() override;
     
     //virtual zmm::Ref<CdsObject> findObjectByTitle(zmm::String title, int parentID);
@@ -152,14 +216,68 @@ public:
     
     virtual void clearFlagInDB(int flag) override;
 
+    virtual zmm::Ref<QueryStats> getQueryStats() override { return queryStats; }
+    virtual zmm::Ref<DIDLCache> getDIDLCache() override { return didlCache; }
+    virtual unsigned long long getContentGeneration() override { return contentGeneration; }
+    virtual zmm::String explainQuery(zmm::String query) override { return nullptr; }
+
 protected:
     SQLStorage();
     //virtual ~SQLStorage();
     virtual void init() override;
+
+    /// \brief rewrites metadata, auxdata and resources that are still url
+    /// encoded in the compact encoding, used by the database upgrades
+    void migrateObjectEncoding();
+    
+    /// \brief fills the sort keys of objects stored before they existed,
+    /// used by the database upgrades
+    void migrateSortKeys();
     
     char table_quote_begin;
     char table_quote_end;
     
+    /// \brief set by the driver if the server understands WITH RECURSIVE
+    bool recursiveQueries;
+    
+    /// \brief makes all writes so far visible to other connections,
+    /// called before changes are announced
+    virtual void commitWrites() { flushInsertBuffer(); }
+
+    /// \brief drops all cached content and reloads the path index, for
+    /// drivers that lost writes the callers already took as stored
+    void discardCachedContent();
+    
+    virtual void beginTransaction() { exec("BEGIN", 5); }
+    virtual void commitTransaction() { exec("COMMIT", 6); }
+    virtual void rollbackTransaction() { exec("ROLLBACK", 8); }
+    
+    /// \brief latencies of the queries run by the driver, nullptr if disabled
+    zmm::Ref<QueryStats> queryStats;
+    
+    /// \brief rendered objects, nullptr if disabled
+    zmm::Ref<DIDLCache> didlCache;
+    std::atomic<unsigned long long> contentGeneration;
+    
+    /// \brief column of the search index holding the object id
+    const char *searchIDColumn;
+    
+    /// \brief kind of search index the driver keeps, the index is created
+    /// and filled again when this differs from the stored one
+    virtual zmm::String getSearchIndexType() = 0;
+    
+    /// \brief drops and creates the empty search index table
+    virtual void createSearchIndex() = 0;
+    
+    /// \brief full text condition on the search index that selects the rows
+    /// where each of the words starts a word of the column
+    /// \return nullptr if the index can not narrow down the rows
+    virtual zmm::String searchMatch(zmm::String column, const std::vector<zmm::String>& words) = 0;
+
+    /// \brief true if searchMatch() finds the words anywhere in the column,
+    /// not only at the start of a word
+    virtual bool searchMatchesSubstrings() { return false; }
+    
 private:
     
     class ChangedContainersStr : public Object
@@ -176,13 +294,89 @@ private:
     
     zmm::String sql_query;
     
+    /* parameterized queries for the hot paths, built once in init() */
+    zmm::String loadObjectQuery;
+    zmm::String objectTypeQuery;
+    zmm::String parentIDQuery;
+    zmm::String childCountQuery;
+    zmm::String activeItemQuery;
+    
+    /* replaces the "?" placeholders of the statement by the quoted parameters */
+    zmm::Ref<zmm::StringBuffer> renderStatement(zmm::Ref<SQLStatement> stmt);
+    
     /* helper for createObjectFromRow() */
     zmm::String getRealLocation(int parentID, zmm::String location);
     
     zmm::Ref<CdsObject> createObjectFromRow(zmm::Ref<SQLRow> row);
     
+    /* folder art index, candidate images per container are looked up
+     * once and kept until an image or a track is added to one of the
+     * directories they come from, or any object is removed */
+    class FolderArt : public Object
+    {
+    public:
+        FolderArt() { embeddedArtResolved = false; }
+        zmm::String find(zmm::String trackArtBase);
+        /* case-folded title and object id of every jpeg image */
+        std::vector<std::pair<zmm::String, int> > images;
+        /* guarded by folderArtMutex with embeddedArtItem */
+        bool embeddedArtResolved;
+        zmm::Ref<CdsItem> embeddedArtItem;
+    };
+    
+    std::unordered_map<int, zmm::Ref<FolderArt> > folderArtIndex;
+    /* containers of the index by the directories their images come from */
+    std::unordered_map<int, std::unordered_set<int> > folderArtSources;
+    /* incremented by every invalidation, a lookup that ran meanwhile is
+     * not stored; all three are guarded by folderArtMutex */
+    unsigned long long folderArtGeneration;
+    std::mutex folderArtMutex;
+    zmm::Ref<FolderArt> getFolderArt(int id);
+    /* drops the containers that draw their artwork from the directory of
+     * obj, or from oldParentID if obj was moved; nullptr drops all */
+    void invalidateFolderArt(zmm::Ref<CdsObject> obj, int oldParentID = INVALID_OBJECT_ID);
+
+    /* browse cursor, sort key of the last row returned for a container,
+     * lets the following page be selected by key instead of by OFFSET */
+    struct BrowseCursor
+    {
+        int flags;
+        int nextIndex;
+        int totalMatches;
+        bool isContainer;
+        int trackNumber;
+        zmm::String title;
+        int id;
+    };
+
+    std::unordered_map<int, BrowseCursor> browseCursors;
+    std::mutex browseCursorMutex;
+    bool getBrowseCursor(int objectID, zmm::Ref<BrowseParam> param, BrowseCursor& cursor);
+    void setBrowseCursor(int objectID, zmm::Ref<BrowseParam> param, zmm::Ref<zmm::Array<CdsObject> > page, bool lastTrackNumberNull);
+    /* INVALID_OBJECT_ID drops all cursors */
+    void invalidateBrowseCursors(int parentID);
+    /* the object changed: drops its fragments and starts a new content
+     * generation */
+    void contentChanged(int id);
+
+    /* container update ids, read from the table on first use and written
+     * back in batches; the table is behind until flushUpdateIDs() ran */
+    std::unordered_map<int, int> updateIDs;
+    std::unordered_set<int> dirtyUpdateIDs;
+    std::mutex updateIDMutex;
+    struct timespec lastUpdateIDFlush;
+    void flushUpdateIDs();
+    int getUpdateID(int objectID, int storedUpdateID);
+    void forgetUpdateIDs(const std::unordered_set<int>& ids);
+
     /* helper for findObjectByPath and findObjectIDByPath */ 
     zmm::Ref<CdsObject> _findObjectByPath(zmm::String fullpath);
+    zmm::String getPathLocation(zmm::String fullpath);
+    
+    /* location -> object id of all filesystem objects, filled in dbReady() */
+    zmm::Ref<PathIndex> pathIndex;
+    void loadPathIndex();
+    void updatePathIndex(zmm::Ref<CdsObject> obj);
     
     int _ensurePathExistence(zmm::String path, int *changedContainer);
     
@@ -190,26 +384,73 @@ private:
     class AddUpdateTable : public Object
     {
     public:
-        AddUpdateTable(zmm::String table, zmm::Ref<Dictionary> dict)
+        AddUpdateTable(zmm::String table) { this->table = table; }
+        zmm::String getTable() { return table; }
+        /* sets the value of a column, nullptr writes NULL */
+        void put(zmm::String column, long long val) { set(column).set(val); }
+        void put(zmm::String column, zmm::String val) { set(column).set(val); }
+        int size() { return columns.size(); }
+        zmm::String getColumn(int index) { return columns[index].name; }
+        /* binds the value of the column to the next placeholder */
+        void bindValue(int index, zmm::Ref<SQLStatement> stmt)
         {
-            this->table = table;
-            this->dict = dict;
+            if (columns[index].isInt)
+                stmt->bind(columns[index].intVal);
+            else
+                stmt->bind(columns[index].strVal);
         }
-        zmm::String getTable() { return table; }
-        zmm::Ref<Dictionary> getDict() { return dict; }
     protected:
+        class Column
+        {
+        public:
+            zmm::String name;
+            bool isInt;
+            long long intVal;
+            zmm::String strVal;
+            void set(long long val) { isInt = true; intVal = val; strVal = nullptr; }
+            void set(zmm::String val) { isInt = false; intVal = 0; strVal = val; }
+        };
+        Column& set(zmm::String column)
+        {
+            for (auto& c : columns) {
+                if (c.name == column)
+                    return c;
+            }
+            columns.emplace_back();
+            columns.back().name = column;
+            return columns.back();
+        }
         zmm::String table;
-        zmm::Ref<Dictionary> dict;
+        std::vector<Column> columns;
     };
     zmm::Ref<zmm::Array<AddUpdateTable> > _addUpdateObject(zmm::Ref<CdsObject> obj, bool isUpdate, int *changedContainer);
     
+    /* search index, the searchable text properties of every object */
+    void initSearchIndex();
+    void rebuildSearchIndex();
+    zmm::Ref<SQLStatement> searchIndexUpdate(int id, zmm::String title, zmm::Ref<Dictionary> metadata);
+    /* compiles parsed search criteria into a condition on the SQL_QUERY columns */
+    void searchCondition(zmm::Ref<SearchExpression> exp, zmm::Ref<zmm::StringBuffer> buf);
+    /* condition selecting the objects below the given container */
+    void searchScope(int containerID, zmm::Ref<zmm::StringBuffer> buf);
+    
+    /* ORDER BY list for the sort criteria, ends with the id */
+    void sortOrder(zmm::Ref<SortCriteria> sortCriteria, zmm::Ref<zmm::StringBuffer> buf);
+    
     /* helper for removeObject(s) */
-    void _removeObjects(zmm::Ref<zmm::StringBuffer> objectIDs, int offset);
+    void _removeObjects(zmm::Ref<zmm::StringBuffer> objectIDs, int offset, bool updateParents = true);
+    
+    /* child_containers and child_items are adjusted by these deltas */
+    zmm::Ref<SQLStatement> childCountUpdate(int parentID, int containers, int items);
+    /* recounts the children of containers whose stored counts are wrong */
+    void repairChildCounts();
 
     void addCSV(zmm::String csv, std::vector<int>& target);
     zmm::String toCSV(const std::vector<int>& input);
 
     zmm::Ref<ChangedContainersStr> _recursiveRemove(zmm::Ref<zmm::StringBuffer> items, zmm::Ref<zmm::StringBuffer> containers, bool all);
+    /* collects the subtree with one recursive query and deletes it in one transaction */
+    zmm::Ref<ChangedContainersStr> _removeSubtree(zmm::Ref<zmm::StringBuffer> items, zmm::Ref<zmm::StringBuffer> containers, bool all);
     
     virtual zmm::Ref<ChangedContainers> _purgeEmptyContainers(zmm::Ref<ChangedContainersStr> changedContainersStr);
     
@@ -243,10 +484,10 @@ private:
     
     zmm::Ref<StorageCache> cache;
     inline bool cacheOn() { return cache != nullptr; }
-    void addObjectToCache(zmm::Ref<CdsObject> object, bool dontLock = false);
+    void addObjectToCache(zmm::Ref<CdsObject> object);
     
     inline bool doInsertBuffering() { return insertBufferOn; }
-    void addToInsertBuffer(zmm::Ref<zmm::StringBuffer> query);
+    void addToInsertBuffer(zmm::Ref<SQLStatement> stmt);
     void flushInsertBuffer(bool dontLock = false);
     
     /* insert buffer functions to be overridden by implementing classes */
@@ -33,63 +33,71 @@
 
 #ifndef __SQLITE3_CREATE_SQL_H__
 #define __SQLITE3_CREATE_SQL_H__
-#define SL3_CREATE_SQL_INFLATED_SIZE 2933
-#define SL3_CREATE_SQL_DEFLATED_SIZE 760
+#define SL3_CREATE_SQL_INFLATED_SIZE 3913
+#define SL3_CREATE_SQL_DEFLATED_SIZE 883
 
 /* begin binary data: */
-const unsigned char sqlite3_create_sql[] = /* 760 */
-{0x78,0x9C,0xB5,0x56,0x5B,0x6F,0xDA,0x30,0x14,0x7E,0xE7,0x57,0x58,0x79,0x09
-,0x95,0xD8,0x04,0xDD,0x2A,0x6D,0xEA,0x53,0x1A,0xDC,0x2A,0x1A,0x4D,0xBA,0x10
-,0xA6,0xED,0xC9,0x32,0x89,0x01,0xAF,0xB9,0xC9,0x71,0xA2,0xF2,0xEF,0x67,0x27
-,0x90,0x0B,0xB9,0x90,0x4D,0x9D,0x84,0x10,0x9C,0xF3,0x9D,0x8B,0xCF,0xF9,0x7C
-,0x8E,0x1F,0xE0,0x93,0x61,0x02,0xC7,0xD6,0xCC,0xB5,0xA6,0x3B,0x86,0x65,0xDE
-,0x4F,0x74,0x1B,0x6A,0x0E,0x04,0x8E,0xF6,0xB0,0x82,0x40,0x09,0x38,0x72,0xBD
-,0x04,0x45,0xDB,0xDF,0xC4,0xE5,0x0A,0x98,0x4E,0x00,0x50,0xA8,0xA7,0x00,0x1A
-,0x72,0xB2,0x27,0x0C,0xC4,0x8C,0x06,0x98,0x1D,0xC1,0x2B,0x39,0xCE,0xA4,0x8E
-,0x91,0x1D,0xAA,0xEB,0x3D,0xB2,0xC3,0xA9,0xCF,0x81,0xB9,0x59,0xAD,0x72,0x40
-,0x8C,0x19,0x09,0x79,0x03,0x63,0x5A,0x4E,0xAE,0x2F,0xC1,0xEA,0x5C,0xCD,0xB1
-,0x45,0x54,0xC4,0x8F,0x31,0x51,0x00,0xA7,0xE1,0x51,0x58,0x80,0x34,0x4C,0xE8
-,0x3E,0x24,0x5E,0x69,0x96,0x43,0xD3,0x38,0x8C,0x91,0xEB,0xE3,0x24,0x51,0x40
-,0x86,0x99,0x7B,0xC0,0x6C,0xFA,0x65,0x7E,0xD3,0x8E,0xEF,0xB9,0x88,0x53,0xEE
-,0x93,0x0A,0x76,0x7B,0x77,0xD7,0x81,0xF3,0x23,0x17,0x73,0x1A,0x85,0x22,0x30
-,0x79,0xE3,0xFD,0x7A,0x74,0xC0,0xC9,0xA1,0x3A,0x4B,0x99,0x5D,0xCB,0x20,0x20
-,0x1C,0x7B,0x98,0xE3,0x3E,0x87,0x38,0x7D,0x1B,0x52,0x33,0x92,0x44,0x29,0x73
-,0x49,0xD2,0x07,0x48,0x63,0x61,0x4E,0xC6,0x15,0x36,0xA0,0x01,0x39,0x95,0xF5
-,0x5C,0x85,0xCF,0x5D,0xC5,0xDA,0xF9,0x78,0x9F,0x74,0x1C,0xAE,0xED,0x78,0x51
-,0x38,0xE6,0x0C,0xBB,0xAF,0x28,0x4C,0x83,0x2D,0x61,0x03,0x24,0x48,0x08,0xCB
-,0xA8,0x5B,0x24,0x3B,0xD8,0x06,0xDD,0x32,0xD7,0x82,0x9D,0x86,0xE9,0x00,0xA5
-,0xE2,0x21,0xA2,0xDB,0xDD,0x2B,0x5A,0x28,0xE0,0xD1,0xB2,0xA1,0xF1,0x64,0x82
-,0x6F,0xF0,0x17,0x98,0x9E,0xB9,0x77,0x03,0x6C,0xF8,0x08,0x6D,0x68,0xEA,0x70
-,0x5D,0xB7,0x12,0xEC,0x55,0x72,0xB5,0x65,0x82,0x25,0x5C,0x41,0x41,0x72,0x5D
-,0x5B,0xEB,0xDA,0x12,0x4A,0xC9,0xE6,0x65,0xA9,0x55,0x92,0x6B,0xB1,0x6F,0x2F
-,0x63,0x57,0xB4,0x7E,0x8F,0xF0,0x93,0x9B,0xFB,0x89,0x61,0xAE,0xA1,0xED,0x00
-,0x11,0xDE,0x6A,0x5D,0xC3,0x1F,0xDA,0x6A,0x03,0xD7,0xD3,0x0F,0x8B,0x59,0x51
-,0x29,0x20,0x7F,0xCD,0xCF,0x7F,0xC6,0x7C,0x97,0xE0,0xAF,0x75,0xF9,0xB8,0xB0
-,0xF3,0x7A,0x54,0xF1,0x51,0x0B,0xFD,0x47,0x37,0x0A,0x39,0xA6,0x21,0x61,0xAA
-,0x90,0xD9,0x51,0xC4,0xD5,0xFF,0x99,0xC5,0xA2,0xE6,0xA4,0x2F,0x89,0x17,0x1D
-,0x2C,0x29,0x13,0xE2,0x88,0x1D,0xFF,0x3D,0x99,0xCE,0x89,0x88,0x5D,0x4E,0x33
-,0xC1,0x60,0x4E,0x82,0x11,0x63,0x51,0xA2,0xE5,0x2C,0x69,0x90,0xBD,0x31,0xC0
-,0x12,0x2E,0x6E,0xEF,0x00,0xA0,0xCE,0xC6,0x76,0x0A,0x3D,0x37,0xA2,0x45,0xC7
-,0xCB,0x71,0xFE,0x57,0x8C,0x6C,0xD5,0x41,0x9E,0x96,0x85,0xD8,0x47,0x09,0xE1
-,0x62,0x3C,0xEF,0x4F,0x85,0x10,0x87,0x6E,0xCE,0x95,0x5A,0x35,0x9A,0x87,0xCE
-,0xB0,0x9F,0xF6,0x1D,0xBA,0xEB,0x0E,0xB4,0x03,0x9E,0xC8,0xA0,0x7A,0x5B,0x94
-,0x11,0x96,0x88,0x22,0xCB,0xBE,0x7F,0x52,0xBB,0xD2,0xC5,0x29,0x8F,0x12,0x17
-,0x87,0x23,0xFA,0x25,0x0A,0x34,0xBC,0xC6,0xA4,0x1F,0xE4,0x93,0x8C,0xF8,0x55
-,0xFA,0x8B,0xF9,0x65,0x4F,0x25,0x28,0x88,0x3C,0x32,0x80,0x11,0xEC,0x4C,0x45
-,0xDE,0xD9,0xD5,0x0D,0x77,0xA0,0x9E,0x47,0xC2,0x6B,0xA8,0xBC,0x42,0xA2,0xAC
-,0x63,0x36,0x92,0xD8,0x96,0x5C,0xA6,0x47,0x77,0x94,0x78,0x63,0x0C,0x62,0x59
-,0xE1,0x84,0x8B,0x41,0x37,0x90,0x46,0x6B,0xD9,0x5C,0xDB,0xA4,0x31,0xE6,0x07
-,0x51,0xEC,0xDE,0xC5,0xC6,0xA3,0xD4,0x3D,0xC8,0x04,0x47,0x84,0x2C,0xD6,0xD0
-,0xC5,0x5D,0x39,0xF7,0x3D,0xEF,0x68,0xF3,0x82,0x9C,0xFA,0xFC,0xFE,0x97,0xC4
-,0x30,0x97,0xF0,0x27,0x68,0x78,0x42,0xC5,0x7E,0x92,0x66,0x0D,0xF9,0xB4,0x90
-,0x0F,0xDB,0x96,0xFB,0xA5,0x6D,0x5E,0xAA,0x66,0xB5,0xF7,0xD2,0xEC,0xFC,0xCE
-,0xE9,0x70,0x5B,0x83,0xB5,0xBD,0xD5,0x94,0x1D,0xA6,0xE5,0xAB,0xA7,0x08,0xDA
-,0x36,0x6F,0x3C,0x8B,0x66,0x65,0x6A,0x1D,0xAE,0xEA,0x4F,0x85,0xB6,0x9F,0xBA
-,0xB6,0xC3,0xF8,0x72,0x10,0x20,0x39,0x5A,0x0A,0x27,0x97,0xAA,0xA9,0x50,0x55
-,0x1E,0x36,0xA6,0xF1,0x7D,0x53,0x73,0x54,0x72,0xA3,0x60,0xC2,0xC9,0xC7,0x59
-,0x3A,0x2D,0xA4,0xC3,0xAD,0xA9,0x1E,0x33,0xED,0x63,0x54,0x3A,0xE9,0xC3,0x7A
-,0x7E,0x36,0x9C,0xFB,0xC9,0x1F,0x6D,0x27,0x91,0x85};
-/* end binary data. size = 760 bytes */
+const unsigned char sqlite3_create_sql[] = /* 883 */
+{0x78,0x9C,0xAD,0x56,0x5B,0x6F,0xDA,0x30,0x14,0x7E,0xE7,0x57,0x58,0xBC,0x84
+,0x4A,0x6C,0x82,0x6E,0xD5,0x36,0xF5,0x29,0x85,0xB4,0x8A,0x46,0x43,0x07,0x61
+,0xDA,0x9E,0x22,0x93,0x18,0xF0,0x9A,0x9B,0x6C,0x07,0x95,0x7F,0x3F,0x3B,0x86
+,0x5C,0x70,0x2E,0xDE,0x54,0x09,0x21,0xF0,0xF9,0xCE,0x77,0x8E,0x8F,0xCF,0xED
+,0xC1,0x7A,0xB2,0x1D,0xE0,0xAE,0x4C,0x67,0x6D,0xCE,0x5C,0x7B,0xE9,0xDC,0x0F
+,0x66,0x2B,0xCB,0x74,0x2D,0xE0,0x9A,0x0F,0x0B,0x0B,0x0C,0x23,0xE6,0xF9,0x01
+,0xF5,0x92,0xED,0x1F,0xE4,0xB3,0x21,0x18,0x0D,0x00,0x18,0xE2,0x60,0x08,0x70
+,0xCC,0xD0,0x1E,0x11,0x90,0x12,0x1C,0x41,0x72,0x02,0xAF,0xE8,0x34,0x16,0x32
+,0x82,0x76,0x5E,0x55,0x1E,0xA0,0x1D,0xCC,0x42,0x06,0x9C,0xCD,0x62,0x91,0x03
+,0x52,0x48,0x50,0xCC,0x6A,0x18,0x67,0xE9,0xE6,0xF2,0x02,0x6C,0x4C,0x8C,0x1C
+,0x2B,0xAD,0x7A,0xEC,0x94,0xA2,0x21,0x60,0x38,0x3E,0x71,0x0D,0x90,0xC5,0x14
+,0xEF,0x63,0x14,0x14,0x6A,0x39,0x34,0x4B,0xE3,0xD4,0xF3,0x43,0x48,0xE9,0x10
+,0x1C,0x21,0xF1,0x0F,0x90,0x8C,0xBE,0x4E,0x6E,0x54,0xFB,0x81,0xEF,0x31,0xCC
+,0x42,0x54,0xC2,0x6E,0xEF,0xEE,0x1A,0x70,0x61,0xE2,0x43,0x86,0x93,0x98,0x1B
+,0x46,0x6F,0xAC,0x5D,0xEE,0x1D,0x20,0x3D,0x94,0x77,0x29,0xBC,0x53,0x14,0x22
+,0xC4,0x60,0x00,0x19,0x6C,0x23,0x84,0xD9,0x5B,0x97,0x98,0x20,0x9A,0x64,0xC4
+,0x47,0xB4,0x0D,0x90,0xA5,0x5C,0x1D,0xE9,0x05,0x36,0xC2,0x11,0x3A,0x87,0xF5
+,0x12,0x85,0xCF,0x4D,0xC1,0xDA,0x85,0x70,0x4F,0x1B,0x2E,0xA7,0x12,0x4F,0x25
+,0x31,0x23,0xD0,0x7F,0xF5,0xE2,0x2C,0xDA,0x22,0xD2,0x91,0x04,0x14,0x91,0x23
+,0xF6,0xA5,0xB3,0xDD,0xCF,0xE0,0x1F,0x70,0x18,0x78,0x7E,0x12,0x33,0x88,0x63
+,0x44,0xA8,0xC6,0xE5,0xA4,0x0A,0x66,0x28,0xD2,0x41,0xD3,0x84,0x30,0xBD,0x8C
+,0xC8,0x91,0x22,0xC6,0x25,0xF0,0xD3,0x6D,0x1B,0x0E,0x12,0x86,0x29,0xD3,0xA2
+,0x84,0xE1,0x36,0x8B,0xB4,0x90,0x3E,0x41,0x90,0x25,0xA4,0x07,0x3B,0x5B,0x3A
+,0x6B,0x5E,0xD1,0xB6,0xE3,0xF2,0x58,0x14,0xB5,0xEB,0xE1,0xED,0xEE,0xD5,0x9B
+,0x0E,0xC1,0xE3,0x72,0x65,0xD9,0x4F,0x0E,0xF8,0x6E,0xFD,0x06,0xA3,0x4B,0xBD
+,0xDE,0x80,0x95,0xF5,0x68,0xAD,0x2C,0x67,0x66,0xAD,0xAB,0x5A,0xBC,0xE2,0x87
+,0xB9,0x78,0xE9,0x80,0xB9,0xB5,0xB0,0x78,0x63,0x98,0x99,0xEB,0x99,0x39,0xB7
+,0xC4,0xC9,0xE6,0x65,0x6E,0x96,0x27,0x7D,0xB6,0x6F,0xAF,0x6D,0x97,0xAD,0xE0
+,0x3D,0xCC,0x0F,0x6E,0xEE,0x07,0xB6,0xB3,0xB6,0x56,0x2E,0xE0,0xE6,0x97,0x4A
+,0xEB,0xFA,0x69,0x2E,0x36,0xD6,0x7A,0xF4,0x61,0x3A,0x96,0x91,0x02,0xE2,0xD7
+,0xE4,0xF2,0x47,0xE7,0xBB,0x00,0x7F,0x53,0xCE,0x7B,0x78,0xF4,0x5C,0x9B,0x54
+,0x3D,0xE3,0x1F,0x43,0xCA,0x3F,0x16,0xD9,0x6F,0xF0,0xB3,0x55,0x92,0x30,0xE3
+,0x7F,0x3D,0x95,0x37,0x36,0x48,0x17,0x87,0x9E,0xAF,0xD3,0x8A,0xA9,0x36,0x57
+,0x5F,0x66,0x60,0x8E,0x09,0x3F,0x4E,0xC8,0xE9,0xBF,0x5D,0x96,0xC1,0x35,0x52
+,0x1F,0x04,0xBD,0x5C,0x37,0x2D,0xD3,0x0B,0xFA,0x0C,0x1F,0x51,0xDE,0x12,0x34
+,0x46,0x98,0x40,0x8B,0xBE,0x5F,0x2B,0xB2,0xDA,0xB0,0xA1,0xAC,0xD6,0x05,0x14
+,0x40,0xB5,0x0A,0x54,0x17,0x5A,0x2A,0x51,0x29,0x83,0xEB,0xD1,0xFB,0x4F,0x95
+,0xA0,0xC4,0x41,0xDC,0x96,0xC4,0x30,0xF4,0x28,0x62,0x7C,0x94,0xEE,0xCF,0x81
+,0xE0,0x97,0xAE,0xCF,0x80,0x4A,0x34,0xEA,0x97,0x3E,0xC2,0x30,0x6B,0xBB,0x74
+,0x53,0xED,0xA9,0x06,0xCF,0xA9,0x63,0x04,0x5B,0xEF,0xC8,0x5B,0x39,0x0F,0xB2
+,0xC8,0x92,0x2F,0x46,0x93,0xBB,0x30,0x63,0x09,0xF5,0x61,0xAC,0xF1,0x5E,0x3C
+,0x40,0xDD,0x2B,0x87,0xE0,0xF1,0x42,0x74,0x44,0x61,0xE9,0xFE,0x74,0x72,0xFD
+,0xA6,0x02,0x14,0x25,0x01,0xEA,0xC0,0xF0,0xFC,0xCB,0xB8,0xDF,0xC7,0xDE,0x6D
+,0xE4,0x80,0x83,0x00,0xC5,0x7D,0xA8,0x3C,0x42,0x3C,0xAC,0x3A,0xDB,0x03,0xDF
+,0x6C,0x98,0x70,0x0F,0xEF,0x30,0x0A,0x74,0x14,0x52,0x11,0x61,0xCA,0x78,0x83
+,0xED,0x70,0x43,0x99,0x86,0x7D,0x5B,0x4F,0x0A,0xD9,0x81,0x07,0xBB,0x75,0x09
+,0x61,0x49,0xE6,0x1F,0x84,0x83,0x1A,0x26,0xE5,0xCA,0x70,0x55,0x2B,0x97,0x77
+,0xCF,0x5F,0xB4,0x5E,0x20,0xE7,0x77,0x7E,0xFF,0x22,0xB1,0x9D,0xB9,0xF5,0x0B
+,0xD4,0x98,0x3C,0x39,0x17,0x85,0x5A,0xED,0x7C,0x24,0xCF,0xBB,0x75,0x8B,0xB9
+,0xA6,0xAA,0x17,0xA2,0x71,0x65,0xB7,0x1D,0x5F,0x76,0x52,0x2D,0xDA,0x1C,0xD9
+,0xC5,0xDC,0xC1,0x56,0x31,0xAA,0x32,0x54,0x84,0x0D,0xAA,0xC5,0xBE,0x2B,0x0D
+,0xA9,0xEA,0xB5,0x85,0x78,0x5C,0xB8,0xD3,0x40,0x55,0x5D,0x12,0x55,0x9E,0xAA
+,0xB4,0x41,0xF9,0xBA,0xAD,0x78,0xA2,0x51,0x49,0x92,0x6B,0xD1,0x88,0x8B,0x4A
+,0x86,0x8D,0x63,0xFF,0xD8,0x54,0x88,0x8A,0x4C,0x93,0x79,0x75,0xE6,0xB8,0x9C
+,0x8E,0xE4,0x69,0xF7,0x8B,0x94,0x6B,0xAC,0x7A,0x8D,0x52,0xD6,0xC3,0x51,0xEC
+,0x9F,0x5D,0x6F,0x5A,0xA2,0x34,0xD8,0xC4,0x8E,0xDA,0x4B,0x26,0x40,0x1A,0x5C
+,0x72,0x8F,0xED,0x65,0x93,0x30,0x1D,0x3E,0xB1,0xEC,0xF6,0xD3,0x09,0x94,0x06
+,0xDB,0x79,0x21,0xEE,0xE5,0x3B,0xE3,0x74,0x5E,0x42,0x64,0x5F,0x17,0xDF,0x75
+,0x7A,0x2E,0x9F,0x9F,0x6D,0xF7,0x7E,0xF0,0x17,0x46,0x97,0xDA,0x14};
+/* end binary data. size = 883 bytes */
 
 #endif // __SQLITE3_CREATE_SQL_H__
 
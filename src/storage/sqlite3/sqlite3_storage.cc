@@ -41,6 +41,7 @@
 #include "config_manager.h"
 
 #include "sqlite3_create_sql.h"
+#include <climits>
 #include <zlib.h>
 
 // updates 1->2
@@ -54,8 +55,52 @@
 #define SQLITE3_UPDATE_2_3_2 "CREATE INDEX mt_cds_object_service_id ON mt_cds_object(service_id)"
 #define SQLITE3_UPDATE_2_3_3 "UPDATE \"mt_internal_setting\" SET \"value\"='3' WHERE \"key\"='db_version' AND \"value\"='2'"
 
+// updates 3->4
+#define SQLITE3_UPDATE_3_4_1 "CREATE INDEX mt_cds_object_parent_title ON mt_cds_object(parent_id,dc_title)"
+#define SQLITE3_UPDATE_3_4_2 "UPDATE \"mt_internal_setting\" SET \"value\"='4' WHERE \"key\"='db_version' AND \"value\"='3'"
+
+// updates 4->5, metadata and resources are converted by migrateObjectEncoding()
+#define SQLITE3_UPDATE_4_5_1 "UPDATE \"mt_internal_setting\" SET \"value\"='5' WHERE \"key\"='db_version' AND \"value\"='4'"
+
+// updates 5->6, the counts are filled by repairChildCounts()
+#define SQLITE3_UPDATE_5_6_1 "ALTER TABLE \"mt_cds_object\" ADD \"child_containers\" integer NOT NULL default '0'"
+#define SQLITE3_UPDATE_5_6_2 "ALTER TABLE \"mt_cds_object\" ADD \"child_items\" integer NOT NULL default '0'"
+#define SQLITE3_UPDATE_5_6_3 "UPDATE \"mt_internal_setting\" SET \"value\"='6' WHERE \"key\"='db_version' AND \"value\"='5'"
+
+// updates 6->7, the keys are filled by migrateSortKeys()
+#define SQLITE3_UPDATE_6_7_1 "ALTER TABLE \"mt_cds_object\" ADD \"sort_title\" varchar(255) default NULL"
+#define SQLITE3_UPDATE_6_7_2 "ALTER TABLE \"mt_cds_object\" ADD \"sort_date\" varchar(32) default NULL"
+#define SQLITE3_UPDATE_6_7_3 "ALTER TABLE \"mt_cds_object\" ADD \"sort_artist\" varchar(255) default NULL"
+#define SQLITE3_UPDATE_6_7_4 "ALTER TABLE \"mt_cds_object\" ADD \"sort_album\" varchar(255) default NULL"
+#define SQLITE3_UPDATE_6_7_5 "ALTER TABLE \"mt_cds_object\" ADD \"sort_creator\" varchar(255) default NULL"
+#define SQLITE3_UPDATE_6_7_6 "CREATE INDEX mt_cds_object_sort_title ON mt_cds_object(parent_id,sort_title)"
+#define SQLITE3_UPDATE_6_7_7 "CREATE INDEX mt_cds_object_sort_date ON mt_cds_object(parent_id,sort_date)"
+#define SQLITE3_UPDATE_6_7_8 "CREATE INDEX mt_cds_object_sort_artist ON mt_cds_object(parent_id,sort_artist)"
+#define SQLITE3_UPDATE_6_7_9 "CREATE INDEX mt_cds_object_sort_album ON mt_cds_object(parent_id,sort_album)"
+#define SQLITE3_UPDATE_6_7_10 "CREATE INDEX mt_cds_object_sort_creator ON mt_cds_object(parent_id,sort_creator)"
+#define SQLITE3_UPDATE_6_7_11 "CREATE INDEX mt_cds_object_sort_track ON mt_cds_object(parent_id,track_number)"
+#define SQLITE3_UPDATE_6_7_12 "UPDATE \"mt_internal_setting\" SET \"value\"='7' WHERE \"key\"='db_version' AND \"value\"='6'"
+
+// search index, a full text index if the library has FTS5
+#define SQLITE3_SEARCH_INDEX_DROP "DROP TABLE IF EXISTS \"mt_cds_search\""
+#define SQLITE3_SEARCH_INDEX_FTS5 "CREATE VIRTUAL TABLE \"mt_cds_search\" USING fts5(\"title\", \"artist\", \"album\", \"genre\", tokenize = 'unicode61 remove_diacritics 1')"
+#define SQLITE3_SEARCH_INDEX_TRIGRAM "CREATE VIRTUAL TABLE \"mt_cds_search\" USING fts5(\"title\", \"artist\", \"album\", \"genre\", tokenize = 'trigram')"
+#define SQLITE3_SEARCH_INDEX_PLAIN "CREATE TABLE \"mt_cds_search\" (\"id\" integer PRIMARY KEY, \"title\" varchar(255) default NULL, \"artist\" text, \"album\" text, \"genre\" text)"
+
 #define SL3_INITITAL_QUEUE_SIZE 20
 
+// maximum number of prepared statements kept by the sqlite3 thread
+#define SL3_STATEMENT_CACHE_SIZE 64
+
+// number of rows a select fetches per round trip to the sqlite3 thread
+#define SL3_FETCH_SIZE 256
+
+// milliseconds a connection waits for a lock held by another connection
+#define SL3_BUSY_TIMEOUT 5000
+
+// pages copied per step of an online backup
+#define SL3_BACKUP_STEP_PAGES 128
+
 using namespace zmm;
 using namespace mxml;
 using namespace std;
@@ -66,9 +111,21 @@ Sqlite3Storage::Sqlite3Storage()
     shutdownFlag = false;
     table_quote_begin = '"';
     table_quote_end = '"';
+    searchIDColumn = "rowid";
+    fullTextSearch = false;
+    trigramSearch = false;
     startupError = nullptr;
     insertBuffer = nullptr;
     dirty = false;
+    groupCommit = false;
+    groupCommitStatements = 0;
+    groupOpen = false;
+    groupStatementCount = 0;
+    groupLost = false;
+    groupLostError = nullptr;
+    backupDb = nullptr;
+    backup = nullptr;
+    backupSteps = 0;
 }
 
 void Sqlite3Storage::init()
@@ -86,6 +143,10 @@ void Sqlite3Storage::init()
 
     String dbFilePath = ConfigManager::getInstance()->getOption(CFG_SERVER_STORAGE_SQLITE_DATABASE_FILE);
 
+    groupCommit = ConfigManager::getInstance()->getBoolOption(CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_ENABLED);
+    groupCommitStatements = ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_STATEMENTS);
+    groupCommitDelay = chrono::milliseconds(ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_SQLITE_GROUP_COMMIT_DELAY));
+
     // check for db-file
     if (access(dbFilePath.c_str(), R_OK | W_OK) != 0 && errno != ENOENT)
         throw _StorageException(nullptr, _("Error while accessing sqlite database file (") + dbFilePath + "): " + mt_strerror(errno));
@@ -156,11 +217,20 @@ void Sqlite3Storage::init()
         throw _Exception(_("sqlite3 database seems to be corrupt and restoring from backup failed"));
     }
 
-    _exec("PRAGMA locking_mode = EXCLUSIVE");
+    String journalMode = ConfigManager::getInstance()->getOption(CFG_SERVER_STORAGE_SQLITE_JOURNAL_MODE);
+    bool walMode = (journalMode == "WAL");
+    // the pragmas can not be changed inside a transaction, so they are not
+    // grouped: a pending group is committed before they run
+    // readers need shared access to the database file
+    if (!walMode)
+        execTask("PRAGMA locking_mode = EXCLUSIVE", false, false);
+    Ref<StringBuffer> jbuf(new StringBuffer());
+    *jbuf << "PRAGMA journal_mode = " << journalMode;
+    execTask(jbuf->c_str(), false, false);
     int synchronousOption = ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_SQLITE_SYNCHRONOUS);
     Ref<StringBuffer> buf(new StringBuffer());
     *buf << "PRAGMA synchronous = " << synchronousOption;
-    SQLStorage::exec(buf);
+    execTask(buf->c_str(), false, false);
 
     log_debug("db_version: %s\n", dbVersion.c_str());
 
@@ -185,9 +255,53 @@ void Sqlite3Storage::init()
         dbVersion = _("3");
     }
 
+    if (dbVersion == "3") {
+        log_info("Doing an automatic database upgrade from database version 3 to version 4...\n");
+        _exec(SQLITE3_UPDATE_3_4_1);
+        _exec(SQLITE3_UPDATE_3_4_2);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("4");
+    }
+
+    if (dbVersion == "4") {
+        log_info("Doing an automatic database upgrade from database version 4 to version 5...\n");
+        migrateObjectEncoding();
+        _exec(SQLITE3_UPDATE_4_5_1);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("5");
+    }
+
+    if (dbVersion == "5") {
+        log_info("Doing an automatic database upgrade from database version 5 to version 6...\n");
+        _exec(SQLITE3_UPDATE_5_6_1);
+        _exec(SQLITE3_UPDATE_5_6_2);
+        _exec(SQLITE3_UPDATE_5_6_3);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("6");
+    }
+
+    if (dbVersion == "6") {
+        log_info("Doing an automatic database upgrade from database version 6 to version 7...\n");
+        _exec(SQLITE3_UPDATE_6_7_1);
+        _exec(SQLITE3_UPDATE_6_7_2);
+        _exec(SQLITE3_UPDATE_6_7_3);
+        _exec(SQLITE3_UPDATE_6_7_4);
+        _exec(SQLITE3_UPDATE_6_7_5);
+        migrateSortKeys();
+        _exec(SQLITE3_UPDATE_6_7_6);
+        _exec(SQLITE3_UPDATE_6_7_7);
+        _exec(SQLITE3_UPDATE_6_7_8);
+        _exec(SQLITE3_UPDATE_6_7_9);
+        _exec(SQLITE3_UPDATE_6_7_10);
+        _exec(SQLITE3_UPDATE_6_7_11);
+        _exec(SQLITE3_UPDATE_6_7_12);
+        log_info("database upgrade successful.\n");
+        dbVersion = _("7");
+    }
+
     /* --- --- ---*/
 
-    if (!string_ok(dbVersion) || dbVersion != "3")
+    if (!string_ok(dbVersion) || dbVersion != "7")
         throw _Exception(_("The database seems to be from a newer version!"));
 
     // add timer for backups
@@ -201,9 +315,73 @@ void Sqlite3Storage::init()
         btask->waitForTask();
     }
 
+    if (walMode) {
+        int readerCount = ConfigManager::getInstance()->getIntOption(CFG_SERVER_STORAGE_SQLITE_READERS);
+        for (int i = 0; i < readerCount; i++) {
+            Ref<Sqlite3Reader> reader(new Sqlite3Reader(this));
+            readers.push_back(reader);
+            reader->start(dbFilePath);
+        }
+        log_debug("started %d sqlite3 reader connections\n", readerCount);
+    }
+
+    // recursive common table expressions are available since 3.8.3
+    recursiveQueries = sqlite3_libversion_number() >= 3008003;
+    fullTextSearch = sqlite3_compileoption_used("ENABLE_FTS5");
+    // the trigram tokenizer is available since 3.34.0
+    trigramSearch = fullTextSearch && sqlite3_libversion_number() >= 3034000;
+
     dbReady();
 }
 
+// number of characters of an UTF-8 string
+static int utf8Length(String str)
+{
+    int length = 0;
+    for (const char* p = str.c_str(); *p; p++) {
+        if ((*p & 0xc0) != 0x80)
+            length++;
+    }
+    return length;
+}
+
+String Sqlite3Storage::getSearchIndexType()
+{
+    if (trigramSearch)
+        return _("fts5-trigram");
+    return fullTextSearch ? _("fts5") : _("plain");
+}
+
+void Sqlite3Storage::createSearchIndex()
+{
+    _exec(SQLITE3_SEARCH_INDEX_DROP);
+    if (trigramSearch)
+        _exec(SQLITE3_SEARCH_INDEX_TRIGRAM);
+    else
+        _exec(fullTextSearch ? SQLITE3_SEARCH_INDEX_FTS5 : SQLITE3_SEARCH_INDEX_PLAIN);
+}
+
+String Sqlite3Storage::searchMatch(String column, const std::vector<String>& words)
+{
+    if (!fullTextSearch || words.empty())
+        return nullptr;
+    // every word as a prefix query on the column, or as a substring with
+    // the trigram tokenizer, which can not find less than three characters
+    Ref<StringBuffer> terms(new StringBuffer());
+    for (const String& word : words) {
+        if (trigramSearch && utf8Length(word) < 3)
+            continue;
+        if (terms->length() > 0)
+            *terms << " AND ";
+        *terms << '"' << word << (trigramSearch ? "\"" : "\" *");
+    }
+    if (terms->length() == 0)
+        return nullptr;
+    Ref<StringBuffer> match(new StringBuffer());
+    *match << '{' << column << "} : (" << terms->toString() << ')';
+    return _("\"" CDS_SEARCH_TABLE "\" MATCH ") + quote(match->toString());
+}
+
 void Sqlite3Storage::_exec(const char* query)
 {
     exec(query, strlen(query), false);
@@ -228,25 +406,309 @@ Ref<SQLResult> Sqlite3Storage::select(const char* query, int length)
 {
     //fprintf(stdout, "%s\n",query);
     //fflush(stdout);
-    Ref<SLSelectTask> ptask(new SLSelectTask(query));
-    addTask(RefCast(ptask, SLTask));
+    recoverLostGroup();
+    auto start = std::chrono::steady_clock::now();
+    Ref<Sqlite3Reader> reader = getReader();
+    Ref<SLSelectTask> ptask(new SLSelectTask(query, reader));
+    if (reader != nullptr)
+        reader->addTask(RefCast(ptask, SLTask));
+    else
+        addTask(RefCast(ptask, SLTask));
+    ptask->waitForTask();
+    Ref<SQLResult> res = ptask->getResult();
+    // recorded when the result is released, the fetches are added up
+    RefCast(res, Sqlite3Result)->micros = QueryStats::elapsedMicros(start);
+    return res;
+}
+
+Ref<SQLResult> Sqlite3Storage::select(Ref<SQLStatement> stmt)
+{
+    recoverLostGroup();
+    auto start = std::chrono::steady_clock::now();
+    Ref<Sqlite3Reader> reader = getReader();
+    Ref<SLStatementSelectTask> ptask(new SLStatementSelectTask(stmt));
+    if (reader != nullptr)
+        reader->addTask(RefCast(ptask, SLTask));
+    else
+        addTask(RefCast(ptask, SLTask));
     ptask->waitForTask();
-    return ptask->getResult();
+    Ref<SQLResult> res = ptask->getResult();
+    if (queryStats != nullptr) {
+        String query = stmt->getQuery();
+        queryStats->record(query.c_str(), query.length(), QueryStats::elapsedMicros(start), res->getNumRows());
+    }
+    return res;
+}
+
+String Sqlite3Storage::explainQuery(String query)
+{
+    Ref<StringBuffer> buf(new StringBuffer());
+    *buf << "EXPLAIN QUERY PLAN " << query;
+    Ref<SQLResult> res = SQLStorage::select(buf);
+    buf->clear();
+    Ref<SQLRow> row;
+    // the detail column is the fourth one in all sqlite versions
+    while ((row = res->nextRow()) != nullptr)
+        *buf << '\n' << row->col(3);
+    if (buf->length() == 0)
+        return nullptr;
+    return buf->toString(1);
+}
+
+Ref<Sqlite3Reader> Sqlite3Storage::getReader()
+{
+    if (hasGroupedWrites() || inTransaction())
+        return nullptr;
+
+    Ref<Sqlite3Reader> reader;
+    int queueSize = INT_MAX;
+    for (const auto& r : readers) {
+        int size = r->getQueueSize();
+        if (size < queueSize) {
+            reader = r;
+            queueSize = size;
+        }
+    }
+    return reader;
+}
+
+sqlite3_stmt* Sqlite3Storage::getStatement(sqlite3* db, String query)
+{
+    auto* cache = &statementCache;
+    for (const auto& reader : readers) {
+        if (reader->db == db)
+            cache = &reader->statementCache;
+    }
+
+    std::string key(query.c_str(), query.length());
+    auto it = cache->find(key);
+    if (it != cache->end())
+        return it->second;
+
+    sqlite3_stmt* stmt = nullptr;
+    int ret = sqlite3_prepare_v2(db, query.c_str(), query.length(), &stmt, nullptr);
+    if (ret != SQLITE_OK) {
+        if (stmt)
+            sqlite3_finalize(stmt);
+        throw _StorageException(nullptr, getError(query, nullptr, db));
+    }
+
+    if (cache->size() >= SL3_STATEMENT_CACHE_SIZE)
+        clearStatementCache(*cache);
+    (*cache)[key] = stmt;
+    return stmt;
+}
+
+void Sqlite3Storage::bindStatement(sqlite3* db, sqlite3_stmt* s, Ref<SQLStatement> stmt)
+{
+    int ret = SQLITE_OK;
+    for (int i = 0; i < stmt->getParamCount() && ret == SQLITE_OK; i++) {
+        if (stmt->isIntParam(i))
+            ret = sqlite3_bind_int64(s, i + 1, stmt->getIntParam(i));
+        else if (stmt->getStringParam(i) == nullptr)
+            ret = sqlite3_bind_null(s, i + 1);
+        else {
+            String val = stmt->getStringParam(i);
+            ret = sqlite3_bind_text(s, i + 1, val.c_str(), val.length(), SQLITE_TRANSIENT);
+        }
+    }
+    if (ret != SQLITE_OK) {
+        sqlite3_reset(s);
+        sqlite3_clear_bindings(s);
+        throw _StorageException(nullptr, getError(stmt->getQuery(), _("could not bind parameters"), db));
+    }
+}
+
+void Sqlite3Storage::clearStatementCache(std::unordered_map<std::string, sqlite3_stmt*>& cache)
+{
+    for (auto& entry : cache)
+        sqlite3_finalize(entry.second);
+    cache.clear();
 }
 
 int Sqlite3Storage::exec(const char* query, int length, bool getLastInsertId)
 {
     //fprintf(stdout, "%s\n",query);
     //fflush(stdout);
-    Ref<SLExecTask> ptask(new SLExecTask(query, getLastInsertId));
+    recoverLostGroup();
+    return execTask(query, getLastInsertId, groupCommit);
+}
+
+int Sqlite3Storage::exec(Ref<SQLStatement> stmt, bool getLastInsertId)
+{
+    recoverLostGroup();
+    auto start = std::chrono::steady_clock::now();
+    Ref<SLStatementExecTask> ptask(new SLStatementExecTask(stmt, getLastInsertId, groupCommit));
+    addTask(RefCast(ptask, SLTask));
+    ptask->waitForTask();
+    if (queryStats != nullptr) {
+        String query = stmt->getQuery();
+        queryStats->record(query.c_str(), query.length(), QueryStats::elapsedMicros(start), 0);
+    }
+    if (getLastInsertId)
+        return ptask->getLastInsertId();
+    else
+        return -1;
+}
+
+int Sqlite3Storage::execTask(const char* query, bool getLastInsertId, bool grouped)
+{
+    auto start = std::chrono::steady_clock::now();
+    Ref<SLExecTask> ptask(new SLExecTask(query, getLastInsertId, grouped));
     addTask(RefCast(ptask, SLTask));
     ptask->waitForTask();
+    if (queryStats != nullptr)
+        queryStats->record(query, -1, QueryStats::elapsedMicros(start), 0);
     if (getLastInsertId)
         return ptask->getLastInsertId();
     else
         return -1;
 }
 
+void Sqlite3Storage::commitWrites()
+{
+    SQLStorage::commitWrites();
+    if (!groupCommit)
+        return;
+    Ref<SLCommitTask> ptask(new SLCommitTask());
+    addTask(RefCast(ptask, SLTask));
+    String error = nullptr;
+    try {
+        ptask->waitForTask();
+    } catch (const Exception& e) {
+        error = e.getMessage();
+    }
+    recoverLostGroup();
+    {
+        // the error of a group that was lost since the last barrier
+        AutoLock lock(sqliteMutex);
+        if (error == nullptr)
+            error = groupLostError;
+        groupLostError = nullptr;
+    }
+    if (error != nullptr)
+        throw _StorageException(nullptr, error);
+}
+
+void Sqlite3Storage::loseGroup(String error)
+{
+    log_error("group transaction was rolled back, %d statements are lost\n", groupStatementCount);
+    groupOpen = false;
+    AutoLock lock(sqliteMutex);
+    groupWriters.clear();
+    if (groupLostError == nullptr)
+        groupLostError = error;
+    groupLost = true;
+}
+
+void Sqlite3Storage::recoverLostGroup()
+{
+    if (!groupLost.exchange(false))
+        return;
+    log_warning("reloading cached content after a lost group transaction\n");
+    discardCachedContent();
+}
+
+// explicit transactions are not grouped, the group is committed first
+// and the statements of the thread in between join the explicit
+// transaction, the other threads wait for it
+void Sqlite3Storage::beginTransaction()
+{
+    {
+        AutoLockU lock(sqliteMutex);
+        transactionCond.wait(lock, [this] { return transactionThread == thread::id(); });
+        transactionThread = this_thread::get_id();
+    }
+    try {
+        execTask("BEGIN", false, false);
+    } catch (const Exception&) {
+        endTransaction();
+        throw;
+    }
+}
+
+// a failed commit is followed by a rollback, which ends the transaction
+void Sqlite3Storage::commitTransaction()
+{
+    execTask("COMMIT", false, false);
+    endTransaction();
+}
+
+void Sqlite3Storage::rollbackTransaction()
+{
+    try {
+        execTask("ROLLBACK", false, false);
+    } catch (const Exception&) {
+        endTransaction();
+        throw;
+    }
+    endTransaction();
+}
+
+void Sqlite3Storage::endTransaction()
+{
+    AutoLock lock(sqliteMutex);
+    if (transactionThread != this_thread::get_id())
+        return;
+    transactionThread = thread::id();
+    transactionCond.notify_all();
+}
+
+bool Sqlite3Storage::inTransaction()
+{
+    AutoLock lock(sqliteMutex);
+    return transactionThread == this_thread::get_id();
+}
+
+void Sqlite3Storage::beginGroup(sqlite3* db)
+{
+    // inside an explicit transaction nothing needs to be grouped
+    if (groupOpen || !sqlite3_get_autocommit(db))
+        return;
+    char* err = nullptr;
+    if (sqlite3_exec(db, "BEGIN", nullptr, nullptr, &err) != SQLITE_OK) {
+        String error = err;
+        sqlite3_free(err);
+        throw _StorageException(nullptr, getError(_("BEGIN"), error, db));
+    }
+    groupOpen = true;
+    groupStatementCount = 0;
+    groupStart = chrono::steady_clock::now();
+}
+
+void Sqlite3Storage::commitGroup(sqlite3* db)
+{
+    if (!groupOpen)
+        return;
+    log_debug("committing %d grouped statements\n", groupStatementCount);
+    char* err = nullptr;
+    int ret = sqlite3_exec(db, "COMMIT", nullptr, nullptr, &err);
+    String error = nullptr;
+    if (ret != SQLITE_OK) {
+        error = getError(_("COMMIT"), err, db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        sqlite3_free(err);
+        loseGroup(error);
+        throw _StorageException(nullptr, error);
+    }
+    sqlite3_free(err);
+    groupOpen = false;
+    {
+        // the writers may read from the readers again, which only see
+        // the group once it is committed
+        AutoLock lock(sqliteMutex);
+        groupWriters.clear();
+    }
+}
+
+bool Sqlite3Storage::hasGroupedWrites()
+{
+    if (!groupCommit)
+        return false;
+    AutoLock lock(sqliteMutex);
+    return groupWriters.find(this_thread::get_id()) != groupWriters.end();
+}
+
 void* Sqlite3Storage::staticThreadProc(void* arg)
 {
     auto* inst = (Sqlite3Storage*)arg;
@@ -269,27 +731,67 @@ void Sqlite3Storage::threadProc()
         startupError = _("Sqlite3Storage.init: could not open ") + dbFilePath;
         return;
     }
+    // readers may hold the database for a moment in WAL mode
+    sqlite3_busy_timeout(db, SL3_BUSY_TIMEOUT);
     AutoLockU lock(sqliteMutex);
     // tell init() that we are ready
     cond.notify_one();
 
     while (!shutdownFlag) {
         if ((task = taskQueue->dequeue()) == nullptr) {
+            if (groupOpen) {
+                // commit the group once it is old enough
+                auto age = chrono::steady_clock::now() - groupStart;
+                if (age < groupCommitDelay) {
+                    cond.wait_for(lock, groupCommitDelay - age);
+                    continue;
+                }
+                lock.unlock();
+                try {
+                    commitGroup(db);
+                } catch (const Exception& e) {
+                    log_error("%s\n", e.getMessage().c_str());
+                }
+                lock.lock();
+                continue;
+            }
             /* if nothing to do, sleep until awakened */
             cond.wait(lock);
             continue;
         }
         lock.unlock();
         try {
+            if (task->isBarrier())
+                commitGroup(db);
+            else if (task->isGrouped())
+                beginGroup(db);
             task->run(&db, this);
             if (task->didContamination())
                 dirty = true;
             else if (task->didDecontamination())
                 dirty = false;
+            if (groupOpen && task->isGrouped()) {
+                groupStatementCount++;
+                AutoLock writersLock(sqliteMutex);
+                groupWriters.insert(task->getCreator());
+            }
+            if (groupOpen && groupStatementCount >= groupCommitStatements)
+                commitGroup(db);
+            // after the commit, the creator may read from a reader next
             task->sendSignal();
         } catch (const Exception& e) {
-            task->sendSignal(e.getMessage());
+            // a failed statement leaves the transaction open, unless
+            // sqlite had to roll it back
+            if (groupOpen && sqlite3_get_autocommit(db))
+                loseGroup(e.getMessage());
+            if (task->is_running())
+                task->sendSignal(e.getMessage());
+            else
+                log_error("%s\n", e.getMessage().c_str());
         }
+        // the task may hold the last reference to a result, whose
+        // destructor must not run under the lock
+        task = nullptr;
         lock.lock();
     }
 
@@ -297,15 +799,31 @@ void Sqlite3Storage::threadProc()
     while ((task = taskQueue->dequeue()) != nullptr) {
         task->sendSignal(_("Sorry, sqlite3 thread is shutting down"));
     }
+    lock.unlock();
+    try {
+        commitGroup(db);
+    } catch (const Exception& e) {
+        log_error("%s\n", e.getMessage().c_str());
+    }
+    abortBackup();
+    clearStatementCache();
+    // results that are still open finalize their statements later,
+    // sqlite3_close_v2 defers the close until then
     if (db)
-        sqlite3_close(db);
+        sqlite3_close_v2(db);
 }
 
 void Sqlite3Storage::addTask(zmm::Ref<SLTask> task, bool onlyIfDirty)
 {
     if (!taskQueueOpen)
         throw _Exception(_("sqlite3 task queue is already closed"));
-    AutoLock lock(sqliteMutex);
+    AutoLockU lock(sqliteMutex);
+    // the db thread queues its follow-up backup steps itself
+    if (!pthread_equal(pthread_self(), sqliteThread)) {
+        transactionCond.wait(lock, [this] {
+            return transactionThread == thread::id() || transactionThread == this_thread::get_id() || shutdownFlag;
+        });
+    }
     if (!taskQueueOpen) {
         throw _Exception(_("sqlite3 task queue is already closed"));
     }
@@ -318,6 +836,11 @@ void Sqlite3Storage::addTask(zmm::Ref<SLTask> task, bool onlyIfDirty)
 void Sqlite3Storage::shutdownDriver()
 {
     log_debug("start\n");
+    // results that are still referenced finalize their statements themselves
+    for (const auto& reader : readers)
+        reader->shutdown();
+    readers.clear();
+
     AutoLockU lock(sqliteMutex);
     shutdownFlag = true;
     if (ConfigManager::getInstance()->getBoolOption(CFG_SERVER_STORAGE_SQLITE_BACKUP_ENABLED)) {
@@ -342,11 +865,26 @@ void Sqlite3Storage::storeInternalSetting(String key, String value)
     SQLStorage::exec(q);
 }
 
+void Sqlite3Storage::abortBackup()
+{
+    if (backup == nullptr)
+        return;
+    sqlite3_backup_finish(backup);
+    sqlite3_close(backupDb);
+    backup = nullptr;
+    backupDb = nullptr;
+    String dbFilePath = ConfigManager::getInstance()->getOption(CFG_SERVER_STORAGE_SQLITE_DATABASE_FILE);
+    unlink((dbFilePath + ".backup.tmp").c_str());
+    log_debug("sqlite3 backup aborted\n");
+}
+
 void Sqlite3Storage::_addToInsertBuffer(Ref<StringBuffer> query)
 {
+    // with group commit the buffer becomes part of the group transaction
     if (insertBuffer == nullptr) {
         insertBuffer = Ref<StringBuffer>(new StringBuffer());
-        *insertBuffer << "BEGIN TRANSACTION;";
+        if (!groupCommit)
+            *insertBuffer << "BEGIN TRANSACTION;";
     }
 
     *insertBuffer << query << ';';
@@ -356,10 +894,115 @@ void Sqlite3Storage::_flushInsertBuffer()
 {
     if (insertBuffer == nullptr)
         return;
-    *insertBuffer << "COMMIT;";
+    if (!groupCommit)
+        *insertBuffer << "COMMIT;";
     SQLStorage::exec(insertBuffer);
     insertBuffer->clear();
-    *insertBuffer << "BEGIN TRANSACTION;";
+    if (!groupCommit)
+        *insertBuffer << "BEGIN TRANSACTION;";
+}
+
+/* Sqlite3Reader */
+
+Sqlite3Reader::Sqlite3Reader(Sqlite3Storage* sl)
+{
+    this->sl = sl;
+    db = nullptr;
+    thread = 0;
+    shutdownFlag = false;
+    taskQueue = Ref<ObjectQueue<SLTask>>(new ObjectQueue<SLTask>(SL3_INITITAL_QUEUE_SIZE));
+    taskQueueOpen = false;
+}
+
+Sqlite3Reader::~Sqlite3Reader()
+{
+    shutdown();
+}
+
+void Sqlite3Reader::start(String dbFilePath)
+{
+    int res = sqlite3_open_v2(dbFilePath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
+    if (res != SQLITE_OK)
+        throw _StorageException(nullptr, _("Sqlite3Storage.init: could not open reader connection for ") + dbFilePath);
+    sqlite3_busy_timeout(db, SL3_BUSY_TIMEOUT);
+
+    taskQueueOpen = true;
+    int ret = pthread_create(&thread, nullptr, Sqlite3Reader::staticThreadProc, this);
+    if (ret != 0) {
+        taskQueueOpen = false;
+        thread = 0;
+        throw _StorageException(nullptr, _("Could not start sqlite reader thread: ") + mt_strerror(errno));
+    }
+}
+
+void Sqlite3Reader::shutdown()
+{
+    AutoLockU lock(mutex);
+    shutdownFlag = true;
+    taskQueueOpen = false;
+    cond.notify_one();
+    lock.unlock();
+    if (thread)
+        pthread_join(thread, nullptr);
+    thread = 0;
+    if (db) {
+        sl->clearStatementCache(statementCache);
+        sqlite3_close_v2(db);
+        db = nullptr;
+    }
+}
+
+void Sqlite3Reader::addTask(Ref<SLTask> task)
+{
+    AutoLock lock(mutex);
+    if (!taskQueueOpen)
+        throw _Exception(_("sqlite3 reader task queue is already closed"));
+    taskQueue->enqueue(task);
+    cond.notify_one();
+}
+
+int Sqlite3Reader::getQueueSize()
+{
+    AutoLock lock(mutex);
+    return taskQueue->size();
+}
+
+void* Sqlite3Reader::staticThreadProc(void* arg)
+{
+    auto* inst = (Sqlite3Reader*)arg;
+    inst->threadProc();
+    log_debug("Sqlite3Reader::staticThreadProc - exiting thread\n");
+    pthread_exit(nullptr);
+    return nullptr;
+}
+
+void Sqlite3Reader::threadProc()
+{
+    Ref<SLTask> task;
+
+    AutoLockU lock(mutex);
+    while (!shutdownFlag) {
+        if ((task = taskQueue->dequeue()) == nullptr) {
+            /* if nothing to do, sleep until awakened */
+            cond.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        try {
+            task->run(&db, sl);
+            task->sendSignal();
+        } catch (const Exception& e) {
+            task->sendSignal(e.getMessage());
+        }
+        // see Sqlite3Storage::threadProc()
+        task = nullptr;
+        lock.lock();
+    }
+
+    taskQueueOpen = false;
+    while ((task = taskQueue->dequeue()) != nullptr) {
+        task->sendSignal(_("Sorry, sqlite3 reader thread is shutting down"));
+    }
 }
 
 /* SLTask */
@@ -371,6 +1014,9 @@ SLTask::SLTask()
     error = nullptr;
     contamination = false;
     decontamination = false;
+    grouped = false;
+    barrier = false;
+    creator = this_thread::get_id();
 }
 bool SLTask::is_running()
 {
@@ -411,6 +1057,7 @@ void SLInitTask::run(sqlite3** db, Sqlite3Storage* sl)
 {
     String dbFilePath = ConfigManager::getInstance()->getOption(CFG_SERVER_STORAGE_SQLITE_DATABASE_FILE);
 
+    sl->clearStatementCache();
     sqlite3_close(*db);
 
     if (unlink(dbFilePath.c_str()) != 0)
@@ -447,45 +1094,114 @@ void SLInitTask::run(sqlite3** db, Sqlite3Storage* sl)
 
 /* SLSelectTask */
 
-SLSelectTask::SLSelectTask(const char* query)
+SLSelectTask::SLSelectTask(const char* query, Ref<Sqlite3Reader> reader)
     : SLTask()
 {
     this->query = query;
+    this->reader = reader;
 }
 
 void SLSelectTask::run(sqlite3** db, Sqlite3Storage* sl)
 {
+    pres = Ref<Sqlite3Result>(new Sqlite3Result(sl, reader, query));
 
-    pres = Ref<Sqlite3Result>(new Sqlite3Result());
-
-    char* err;
-    int ret = sqlite3_get_table(
-        *db,
-        query,
-        &pres->table,
-        &pres->nrow,
-        &pres->ncolumn,
-        &err);
-    String error = nullptr;
-    if (err != nullptr) {
-        error = err;
-        sqlite3_free(err);
-    }
+    int ret = sqlite3_prepare_v2(*db, query, -1, &pres->stmt, nullptr);
     if (ret != SQLITE_OK) {
+        String error = sqlite3_errmsg(*db);
+        if (pres->stmt) {
+            sqlite3_finalize(pres->stmt);
+            pres->stmt = nullptr;
+        }
         throw _StorageException(nullptr, sl->getError(query, error, *db));
     }
 
-    pres->row = pres->table;
-    pres->cur_row = 0;
+    pres->fetch(*db);
+}
+
+/* SLFetchTask */
+
+void SLFetchTask::run(sqlite3** db, Sqlite3Storage* sl)
+{
+    res->fetch(*db);
+}
+
+/* SLFinalizeTask */
+
+void SLFinalizeTask::run(sqlite3** db, Sqlite3Storage* sl)
+{
+    sqlite3_finalize(stmt);
+}
+
+/* SLStatementSelectTask */
+
+SLStatementSelectTask::SLStatementSelectTask(Ref<SQLStatement> stmt)
+    : SLTask()
+{
+    this->stmt = stmt;
+}
+
+void SLStatementSelectTask::run(sqlite3** db, Sqlite3Storage* sl)
+{
+    sqlite3_stmt* s = sl->getStatement(*db, stmt->getQuery());
+    sl->bindStatement(*db, s, stmt);
+
+    int ret;
+    pres = Ref<Sqlite3StatementResult>(new Sqlite3StatementResult());
+    while ((ret = sqlite3_step(s)) == SQLITE_ROW) {
+        pres->rows.emplace_back();
+        Sqlite3Row::readColumns(s, pres->rows.back());
+    }
+
+    String error = nullptr;
+    if (ret != SQLITE_DONE)
+        error = sqlite3_errmsg(*db);
+    sqlite3_reset(s);
+    sqlite3_clear_bindings(s);
+    if (error != nullptr)
+        throw _StorageException(nullptr, sl->getError(stmt->getQuery(), error, *db));
+}
+
+/* SLStatementExecTask */
+
+SLStatementExecTask::SLStatementExecTask(Ref<SQLStatement> stmt, bool getLastInsertId, bool grouped)
+    : SLTask()
+{
+    this->stmt = stmt;
+    this->getLastInsertIdFlag = getLastInsertId;
+    this->grouped = grouped;
+    this->barrier = !grouped;
+}
+
+void SLStatementExecTask::run(sqlite3** db, Sqlite3Storage* sl)
+{
+    sqlite3_stmt* s = sl->getStatement(*db, stmt->getQuery());
+    sl->bindStatement(*db, s, stmt);
+
+    int ret;
+    while ((ret = sqlite3_step(s)) == SQLITE_ROW)
+        ;
+
+    String error = nullptr;
+    if (ret != SQLITE_DONE)
+        error = sqlite3_errmsg(*db);
+    sqlite3_reset(s);
+    sqlite3_clear_bindings(s);
+    if (error != nullptr)
+        throw _StorageException(nullptr, sl->getError(stmt->getQuery(), error, *db));
+    if (getLastInsertIdFlag)
+        lastInsertId = sqlite3_last_insert_rowid(*db);
+    contamination = true;
 }
 
 /* SLExecTask */
 
-SLExecTask::SLExecTask(const char* query, bool getLastInsertId)
+SLExecTask::SLExecTask(const char* query, bool getLastInsertId, bool grouped)
     : SLTask()
 {
     this->query = query;
     this->getLastInsertIdFlag = getLastInsertId;
+    this->grouped = grouped;
+    this->barrier = !grouped;
 }
 
 void SLExecTask::run(sqlite3** db, Sqlite3Storage* sl)
@@ -519,17 +1235,68 @@ void SLBackupTask::run(sqlite3** db, Sqlite3Storage* sl)
     String dbFilePath = ConfigManager::getInstance()->getOption(CFG_SERVER_STORAGE_SQLITE_DATABASE_FILE);
 
     if (!restore) {
-        try {
-            copy_file(
-                dbFilePath,
-                dbFilePath + ".backup");
-            log_debug("sqlite3 backup successful\n");
-            decontamination = true;
-        } catch (const Exception& e) {
-            log_error("error while making sqlite3 backup: %s\n", e.getMessage().c_str());
+        // only one backup at a time, a continuation without backup was aborted
+        if (continued != (sl->backup != nullptr))
+            return;
+
+        // the backup is written next to the old one and replaces it when complete
+        String backupPath = dbFilePath + ".backup";
+        String tmpPath = backupPath + ".tmp";
+        if (!continued) {
+            if (sqlite3_open(tmpPath.c_str(), &sl->backupDb) != SQLITE_OK) {
+                log_error("error while making sqlite3 backup: could not open %s\n", tmpPath.c_str());
+                sqlite3_close(sl->backupDb);
+                sl->backupDb = nullptr;
+                return;
+            }
+            sl->backup = sqlite3_backup_init(sl->backupDb, "main", *db, "main");
+            if (sl->backup == nullptr) {
+                log_error("error while making sqlite3 backup: %s\n", sqlite3_errmsg(sl->backupDb));
+                sqlite3_close(sl->backupDb);
+                sl->backupDb = nullptr;
+                unlink(tmpPath.c_str());
+                return;
+            }
+            sl->backupSteps = 0;
+            sl->backupStart = chrono::steady_clock::now();
         }
+
+        // writes of this connection in between are copied by the backup itself
+        int ret = sqlite3_backup_step(sl->backup, SL3_BACKUP_STEP_PAGES);
+        sl->backupSteps++;
+        if (ret == SQLITE_OK || ret == SQLITE_BUSY || ret == SQLITE_LOCKED) {
+            log_debug("sqlite3 backup: %d of %d pages remaining\n",
+                sqlite3_backup_remaining(sl->backup), sqlite3_backup_pagecount(sl->backup));
+            try {
+                sl->addTask(Ref<SLTask>(new SLBackupTask(false, true)));
+            } catch (const Exception& e) {
+                sl->abortBackup();
+            }
+            return;
+        }
+
+        int pageCount = sqlite3_backup_pagecount(sl->backup);
+        sqlite3_backup_finish(sl->backup);
+        sqlite3_close(sl->backupDb);
+        sl->backup = nullptr;
+        sl->backupDb = nullptr;
+        if (ret != SQLITE_DONE) {
+            log_error("error while making sqlite3 backup: %s\n", sqlite3_errstr(ret));
+            unlink(tmpPath.c_str());
+            return;
+        }
+        if (rename(tmpPath.c_str(), backupPath.c_str()) != 0) {
+            log_error("error while making sqlite3 backup: could not rename %s: %s\n", tmpPath.c_str(), mt_strerror(errno).c_str());
+            unlink(tmpPath.c_str());
+            return;
+        }
+        auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - sl->backupStart);
+        log_info("sqlite3 backup of %d pages done in %d steps, took %lld ms\n", pageCount, sl->backupSteps, (long long)duration.count());
+        decontamination = true;
     } else {
         log_info("trying to restore sqlite3 database from backup...\n");
+        sl->abortBackup();
+        sl->clearStatementCache();
         sqlite3_close(*db);
         try {
             copy_file(
@@ -549,39 +1316,143 @@ void SLBackupTask::run(sqlite3** db, Sqlite3Storage* sl)
 
 /* Sqlite3Result */
 
-Sqlite3Result::Sqlite3Result()
+Sqlite3Result::Sqlite3Result(Sqlite3Storage* sl, Ref<Sqlite3Reader> reader, String query)
     : SQLResult()
 {
-    table = nullptr;
+    this->sl = sl;
+    this->reader = reader;
+    this->query = query;
+    stmt = nullptr;
+    cur_row = 0;
+    numRows = 0;
+    micros = 0;
 }
+
 Sqlite3Result::~Sqlite3Result()
 {
-    if (table) {
-        sqlite3_free_table(table);
-        table = nullptr;
+    if (sl->queryStats != nullptr)
+        sl->queryStats->record(query.c_str(), query.length(), micros, numRows);
+    if (stmt == nullptr)
+        return;
+    // the caller stopped before the last row; the last reference may be
+    // dropped by the thread of the connection itself
+    pthread_t owner = (reader != nullptr) ? reader->thread : sl->sqliteThread;
+    if (pthread_equal(pthread_self(), owner)) {
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+        return;
+    }
+    try {
+        Ref<SLFinalizeTask> ptask(new SLFinalizeTask(stmt));
+        addTask(RefCast(ptask, SLTask));
+    } catch (const Exception& e) {
+        // the sqlite3 thread is gone, the database is closed as soon
+        // as the last statement is finalized
+        sqlite3_finalize(stmt);
+    }
+    stmt = nullptr;
+}
+
+void Sqlite3Result::addTask(Ref<SLTask> task)
+{
+    // the statement can only be stepped on its own connection
+    if (reader != nullptr)
+        reader->addTask(task);
+    else
+        sl->addTask(task);
+}
+
+void Sqlite3Result::fetch(sqlite3* db)
+{
+    rows.clear();
+    cur_row = 0;
+
+    int ret = SQLITE_DONE;
+    while (rows.size() < SL3_FETCH_SIZE && (ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+        rows.emplace_back();
+        Sqlite3Row::readColumns(stmt, rows.back());
     }
+    if (ret == SQLITE_ROW)
+        return;
+
+    String error = nullptr;
+    if (ret != SQLITE_DONE)
+        error = sqlite3_errmsg(db);
+    sqlite3_finalize(stmt);
+    stmt = nullptr;
+    if (error != nullptr)
+        throw _StorageException(nullptr, sl->getError(query, error, db));
 }
+
 Ref<SQLRow> Sqlite3Result::nextRow()
 {
-    if (nrow) {
-        row += ncolumn;
-        cur_row++;
-        if (cur_row <= nrow) {
-            Ref<Sqlite3Row> p(new Sqlite3Row(row, Ref<SQLResult>(this)));
-            p->res = Ref<Sqlite3Result>(this);
-            return RefCast(p, SQLRow);
-        } else
+    if (cur_row >= rows.size()) {
+        if (stmt == nullptr)
+            return nullptr;
+        auto start = std::chrono::steady_clock::now();
+        Ref<SLFetchTask> ptask(new SLFetchTask(Ref<Sqlite3Result>(this)));
+        addTask(RefCast(ptask, SLTask));
+        ptask->waitForTask();
+        micros += QueryStats::elapsedMicros(start);
+        if (rows.empty())
             return nullptr;
     }
-    return nullptr;
+    numRows++;
+    Ref<Sqlite3Row> p(new Sqlite3Row(std::move(rows[cur_row++]), Ref<SQLResult>(this)));
+    return RefCast(p, SQLRow);
+}
+
+/* Sqlite3StatementResult */
+
+Ref<SQLRow> Sqlite3StatementResult::nextRow()
+{
+    if (cur_row >= rows.size())
+        return nullptr;
+    Ref<Sqlite3Row> p(new Sqlite3Row(std::move(rows[cur_row++]), Ref<SQLResult>(this)));
+    return RefCast(p, SQLRow);
 }
 
 /* Sqlite3Row */
 
-Sqlite3Row::Sqlite3Row(char** row, Ref<SQLResult> sqlResult)
+Sqlite3Row::Sqlite3Row(std::vector<Column>&& columns, Ref<SQLResult> sqlResult)
     : SQLRow(sqlResult)
+    , columns(std::move(columns))
+{
+}
+
+void Sqlite3Row::readColumns(sqlite3_stmt* stmt, std::vector<Column>& columns)
+{
+    int ncolumn = sqlite3_column_count(stmt);
+    columns.resize(ncolumn);
+    for (int i = 0; i < ncolumn; i++) {
+        Column& col = columns[i];
+        int type = sqlite3_column_type(stmt, i);
+        col.isNull = (type == SQLITE_NULL);
+        col.isInt = (type == SQLITE_INTEGER);
+        col.intVal = col.isInt ? sqlite3_column_int64(stmt, i) : 0;
+        if (!col.isNull) {
+            auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+            col.text.assign(text, sqlite3_column_bytes(stmt, i));
+        }
+    }
+}
+
+char* Sqlite3Row::col_c_str(int index)
+{
+    Column& col = columns[index];
+    if (col.isNull)
+        return nullptr;
+    return const_cast<char*>(col.text.c_str());
+}
+
+int Sqlite3Row::col_int(int index, int null_value)
 {
-    this->row = row;
+    Column& col = columns[index];
+    if (col.isNull)
+        return null_value;
+    if (col.isInt)
+        return (int)col.intVal;
+    return SQLRow::col_int(index, null_value);
 }
 
 /* Sqlite3BackupTimerSubscriber */
@@ -35,15 +35,23 @@
 #ifndef __SQLITE3_STORAGE_H__
 #define __SQLITE3_STORAGE_H__
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "storage/sql_storage.h"
 #include "timer.h"
 
 class Sqlite3Storage;
+class Sqlite3Reader;
 class Sqlite3Result;
+class Sqlite3StatementResult;
 
 /// \brief A virtual class that represents a task to be done by the sqlite3 thread.
 class SLTask : public zmm::Object {
@@ -69,6 +77,15 @@ public:
     bool didContamination() { return contamination; }
     bool didDecontamination() { return decontamination; }
 
+    /// \brief true if the task may run inside the open group transaction
+    bool isGrouped() { return grouped; }
+
+    /// \brief true if the open group transaction has to be committed before the task runs
+    bool isBarrier() { return barrier; }
+
+    /// \brief the thread that created the task
+    std::thread::id getCreator() { return creator; }
+
     zmm::String getError() { return error; }
 
 protected:
@@ -83,6 +100,10 @@ protected:
     /// \brief true if this task has backuped the db
     bool decontamination;
 
+    bool grouped;
+    bool barrier;
+    std::thread::id creator;
+
     std::condition_variable cond;
     std::mutex mutex;
 
@@ -96,32 +117,92 @@ public:
     SLInitTask()
         : SLTask()
     {
+        barrier = true;
     }
     virtual void run(sqlite3** db, Sqlite3Storage* sl);
 };
 
 /// \brief A task for the sqlite3 thread to do a SQL select.
+///
+/// The task prepares the statement and fetches the first batch of rows,
+/// the remaining rows are fetched by SLFetchTask.
 class SLSelectTask : public SLTask {
 public:
     /// \brief Constructor for the sqlite3 select task
     /// \param query The SQL query string
-    SLSelectTask(const char* query);
+    /// \param reader The reader connection running the task, nullptr for the main sqlite3 thread
+    SLSelectTask(const char* query, zmm::Ref<Sqlite3Reader> reader = nullptr);
     virtual void run(sqlite3** db, Sqlite3Storage* sl);
     inline zmm::Ref<SQLResult> getResult() { return RefCast(pres, SQLResult); };
 
 protected:
     /// \brief The SQL query string
     const char* query;
+    zmm::Ref<Sqlite3Reader> reader;
     /// \brief The Sqlite3Result
     zmm::Ref<Sqlite3Result> pres;
 };
 
+/// \brief A task for the sqlite3 thread to fetch the next batch of rows of a select.
+class SLFetchTask : public SLTask {
+public:
+    /// \brief Constructor for the sqlite3 fetch task
+    /// \param res The result to fetch rows for, the caller waits for the task
+    SLFetchTask(zmm::Ref<Sqlite3Result> res) { this->res = res; }
+    virtual void run(sqlite3** db, Sqlite3Storage* sl);
+
+protected:
+    zmm::Ref<Sqlite3Result> res;
+};
+
+/// \brief A task for the sqlite3 thread to finalize an abandoned statement.
+class SLFinalizeTask : public SLTask {
+public:
+    SLFinalizeTask(sqlite3_stmt* stmt) { this->stmt = stmt; }
+    virtual void run(sqlite3** db, Sqlite3Storage* sl);
+
+protected:
+    sqlite3_stmt* stmt;
+};
+
+/// \brief A task for the sqlite3 thread to run a prepared SQL select.
+class SLStatementSelectTask : public SLTask {
+public:
+    /// \brief Constructor for the sqlite3 prepared select task
+    /// \param stmt The query and its bound parameters
+    SLStatementSelectTask(zmm::Ref<SQLStatement> stmt);
+    virtual void run(sqlite3** db, Sqlite3Storage* sl);
+    inline zmm::Ref<SQLResult> getResult() { return RefCast(pres, SQLResult); };
+
+protected:
+    zmm::Ref<SQLStatement> stmt;
+    zmm::Ref<Sqlite3StatementResult> pres;
+};
+
+/// \brief A task for the sqlite3 thread to run a prepared SQL exec.
+class SLStatementExecTask : public SLTask {
+public:
+    /// \brief Constructor for the sqlite3 prepared exec task
+    /// \param stmt The query and its bound parameters
+    /// \param grouped true if the statement may be committed together with others
+    SLStatementExecTask(zmm::Ref<SQLStatement> stmt, bool getLastInsertId, bool grouped = false);
+    virtual void run(sqlite3** db, Sqlite3Storage* sl);
+    inline int getLastInsertId() { return lastInsertId; }
+
+protected:
+    zmm::Ref<SQLStatement> stmt;
+
+    int lastInsertId;
+    bool getLastInsertIdFlag;
+};
+
 /// \brief A task for the sqlite3 thread to do a SQL exec.
 class SLExecTask : public SLTask {
 public:
     /// \brief Constructor for the sqlite3 exec task
     /// \param query The SQL query string
-    SLExecTask(const char* query, bool getLastInsertId);
+    /// \param grouped true if the statement may be committed together with others
+    SLExecTask(const char* query, bool getLastInsertId, bool grouped = false);
     virtual void run(sqlite3** db, Sqlite3Storage* sl);
     inline int getLastInsertId() { return lastInsertId; }
 
@@ -133,15 +214,72 @@ protected:
     bool getLastInsertIdFlag;
 };
 
-/// \brief A task for the sqlite3 thread to do a SQL exec.
+/// \brief A task for the sqlite3 thread to backup or restore the database.
+///
+/// A backup copies a limited number of pages per run and queues a
+/// continuation, so other tasks are served in between.
 class SLBackupTask : public SLTask {
 public:
     /// \brief Constructor for the sqlite3 backup task
-    SLBackupTask(bool restore) { this->restore = restore; };
+    /// \param restore true to restore the database from the backup file
+    /// \param continued true for the continuation of a running backup
+    SLBackupTask(bool restore, bool continued = false)
+    {
+        this->restore = restore;
+        this->continued = continued;
+        barrier = true;
+    };
     virtual void run(sqlite3** db, Sqlite3Storage* sl);
 
 protected:
     bool restore;
+    bool continued;
+};
+
+/// \brief A task for the sqlite3 thread that only commits the open group transaction.
+class SLCommitTask : public SLTask {
+public:
+    SLCommitTask() { barrier = true; }
+    virtual void run(sqlite3** db, Sqlite3Storage* sl) {}
+};
+
+/// \brief A read-only sqlite3 connection with its own thread.
+///
+/// In WAL mode readers run selects in parallel to the main sqlite3
+/// thread, which keeps doing all writes.
+class Sqlite3Reader : public zmm::Object {
+public:
+    Sqlite3Reader(Sqlite3Storage* sl);
+    ~Sqlite3Reader();
+
+    /// \brief opens the connection and starts the reader thread
+    void start(zmm::String dbFilePath);
+    void shutdown();
+    void addTask(zmm::Ref<SLTask> task);
+
+    /// \brief number of tasks waiting for the reader
+    int getQueueSize();
+
+private:
+    static void* staticThreadProc(void* arg);
+    void threadProc();
+
+    Sqlite3Storage* sl;
+    sqlite3* db;
+    pthread_t thread;
+    std::condition_variable cond;
+    std::mutex mutex;
+    using AutoLock = std::lock_guard<decltype(mutex)>;
+    using AutoLockU = std::unique_lock<decltype(mutex)>;
+    bool shutdownFlag;
+    zmm::Ref<zmm::ObjectQueue<SLTask>> taskQueue;
+    bool taskQueueOpen;
+
+    /// \brief prepared statements of this connection
+    std::unordered_map<std::string, sqlite3_stmt*> statementCache;
+
+    friend class Sqlite3Storage;
+    friend class Sqlite3Result;
 };
 
 /// \brief The Storage class for using SQLite3
@@ -164,15 +302,105 @@ private:
     virtual inline zmm::String quote(char val) override { return quote(zmm::String(val)); }
     virtual inline zmm::String quote(long long val) override { return zmm::String::from(val); }
     virtual zmm::Ref<SQLResult> select(const char* query, int length) override;
+    virtual zmm::Ref<SQLResult> select(zmm::Ref<SQLStatement> stmt) override;
     virtual int exec(const char* query, int length, bool getLastInsertId = false) override;
+    virtual int exec(zmm::Ref<SQLStatement> stmt, bool getLastInsertId = false) override;
     virtual void storeInternalSetting(zmm::String key, zmm::String value) override;
 
     void _exec(const char* query);
 
+    /// \brief runs an exec task on the sqlite3 thread
+    int execTask(const char* query, bool getLastInsertId, bool grouped);
+
+    virtual zmm::String explainQuery(zmm::String query) override;
+
+    virtual zmm::String getSearchIndexType() override;
+    virtual void createSearchIndex() override;
+    virtual zmm::String searchMatch(zmm::String column, const std::vector<zmm::String>& words) override;
+    virtual bool searchMatchesSubstrings() override { return trigramSearch; }
+
+    /// \brief true if the library has FTS5, the search index is a plain
+    /// table otherwise
+    bool fullTextSearch;
+
+    /// \brief true if the FTS5 index uses the trigram tokenizer (sqlite
+    /// 3.34 and later), which matches substrings instead of word prefixes
+    bool trigramSearch;
+
+    virtual void commitWrites() override;
+    virtual void beginTransaction() override;
+    virtual void commitTransaction() override;
+    virtual void rollbackTransaction() override;
+    /// \brief lets the other threads use the main connection again
+    void endTransaction();
+
+    /// \brief the thread with an open explicit transaction, guarded by
+    /// sqliteMutex; the tasks of other threads wait until it ends, they
+    /// would join the transaction or be rolled back with it otherwise
+    std::thread::id transactionThread;
+    std::condition_variable transactionCond;
+
+    /// \brief group commit settings, writes are collected in one transaction
+    /// until the statement limit or the delay is reached
+    bool groupCommit;
+    int groupCommitStatements;
+    std::chrono::milliseconds groupCommitDelay;
+
+    /// \brief state of the group transaction, only touched by the sqlite3 thread
+    bool groupOpen;
+    int groupStatementCount;
+    std::chrono::steady_clock::time_point groupStart;
+
+    /// \brief threads with uncommitted writes in the group, guarded by sqliteMutex
+    std::unordered_set<std::thread::id> groupWriters;
+
+    void beginGroup(sqlite3* db);
+    void commitGroup(sqlite3* db);
+
+    /// \brief the grouped statements were acknowledged before the commit,
+    /// if the group is lost the caches of the callers are stale; set by
+    /// the sqlite3 thread, the next caller discards them
+    std::atomic<bool> groupLost;
+    /// \brief error of the lost group, guarded by sqliteMutex, reported
+    /// by the next commitWrites()
+    zmm::String groupLostError;
+
+    /// \brief called on the sqlite3 thread when an open group is gone
+    void loseGroup(zmm::String error);
+    /// \brief called by the callers before they use the database
+    void recoverLostGroup();
+
+    /// \brief true if the calling thread has uncommitted writes, its selects
+    /// have to run on the main connection to see them
+    bool hasGroupedWrites();
+
+    /// \brief true if the calling thread has an open explicit transaction
+    bool inTransaction();
+
     zmm::String startupError;
 
     zmm::String getError(zmm::String query, zmm::String error, sqlite3* db);
 
+    /// \brief prepared statements by query text, only touched by the sqlite3 thread
+    std::unordered_map<std::string, sqlite3_stmt*> statementCache;
+
+    /// \brief returns the cached prepared statement of the connection for
+    /// the query, compiles it on first use
+    sqlite3_stmt* getStatement(sqlite3* db, zmm::String query);
+
+    /// \brief finalizes all cached statements, needs to be called before the db is closed
+    void clearStatementCache(std::unordered_map<std::string, sqlite3_stmt*>& cache);
+    void clearStatementCache() { clearStatementCache(statementCache); }
+
+    /// \brief binds the parameters of the statement to the prepared statement
+    void bindStatement(sqlite3* db, sqlite3_stmt* s, zmm::Ref<SQLStatement> stmt);
+
+    /// \brief reader connections, empty unless the database is in WAL mode
+    std::vector<zmm::Ref<Sqlite3Reader>> readers;
+
+    /// \brief returns the reader with the shortest queue, nullptr if there are no readers
+    zmm::Ref<Sqlite3Reader> getReader();
+
     static void* staticThreadProc(void* arg);
     void threadProc();
 
@@ -200,42 +428,99 @@ private:
 
     bool dirty;
 
+    /// \brief the running online backup, only touched by the sqlite3 thread
+    sqlite3* backupDb;
+    sqlite3_backup* backup;
+    int backupSteps;
+    std::chrono::steady_clock::time_point backupStart;
+
+    /// \brief stops a running backup and removes the incomplete file
+    void abortBackup();
+
     friend class SLSelectTask;
+    friend class SLStatementSelectTask;
+    friend class Sqlite3Reader;
+    friend class Sqlite3Result;
     friend class SLExecTask;
+    friend class SLStatementExecTask;
     friend class SLInitTask;
+    friend class SLBackupTask;
     friend class Sqlite3BackupTimerSubscriber;
 };
 
+/// \brief Represents a row of a result of a sqlite3 select with typed columns
+class Sqlite3Row : public SQLRow {
+public:
+    /// \brief a column value as read from the statement
+    class Column {
+    public:
+        bool isNull;
+        bool isInt;
+        long long intVal;
+        std::string text;
+    };
+
+    /// \brief reads the current row of a stepped statement
+    static void readColumns(sqlite3_stmt* stmt, std::vector<Column>& columns);
+
+private:
+    Sqlite3Row(std::vector<Column>&& columns, zmm::Ref<SQLResult> sqlResult);
+    virtual char* col_c_str(int index) override;
+    virtual int col_int(int index, int null_value) override;
+    std::vector<Column> columns;
+
+    friend class Sqlite3Result;
+    friend class Sqlite3StatementResult;
+};
+
 /// \brief Represents a result of a sqlite3 select
+///
+/// The statement is stepped on the sqlite3 thread in batches of
+/// SL3_FETCH_SIZE rows while the caller iterates, so only one batch is
+/// held in memory. getNumRows() returns the number of rows fetched so far.
 class Sqlite3Result : public SQLResult {
 private:
-    Sqlite3Result();
+    Sqlite3Result(Sqlite3Storage* sl, zmm::Ref<Sqlite3Reader> reader, zmm::String query);
+    void addTask(zmm::Ref<SLTask> task);
     virtual ~Sqlite3Result();
     virtual zmm::Ref<SQLRow> nextRow() override;
-    virtual unsigned long long getNumRows() override { return nrow; }
+    virtual unsigned long long getNumRows() override { return numRows; }
+
+    /// \brief steps the statement for the next batch, runs on the sqlite3 thread
+    void fetch(sqlite3* db);
+
+    Sqlite3Storage* sl;
+    zmm::String query;
+
+    /// \brief the connection the statement belongs to, nullptr for the main sqlite3 thread
+    zmm::Ref<Sqlite3Reader> reader;
 
-    char** table;
-    char** row;
+    /// \brief the running statement, nullptr as soon as all rows were read
+    sqlite3_stmt* stmt;
 
-    int cur_row;
+    std::vector<std::vector<Sqlite3Row::Column>> rows;
+    unsigned int cur_row;
+    unsigned long long numRows;
 
-    int nrow;
-    int ncolumn;
+    /// \brief time spent in the select and the fetches so far
+    long long micros;
 
     friend class SLSelectTask;
-    friend class Sqlite3Row;
+    friend class SLFetchTask;
     friend class Sqlite3Storage;
 };
 
-/// \brief Represents a row of a result of a sqlite3 select
-class Sqlite3Row : public SQLRow {
+/// \brief Represents the result of a prepared sqlite3 select
+class Sqlite3StatementResult : public SQLResult {
 private:
-    Sqlite3Row(char** row, zmm::Ref<SQLResult> sqlResult);
-    inline virtual char* col_c_str(int index) { return row[index]; }
-    char** row;
-    zmm::Ref<Sqlite3Result> res;
+    Sqlite3StatementResult() : SQLResult() { cur_row = 0; }
+    virtual zmm::Ref<SQLRow> nextRow() override;
+    virtual unsigned long long getNumRows() override { return rows.size(); }
 
-    friend class Sqlite3Result;
+    std::vector<std::vector<Sqlite3Row::Column>> rows;
+    unsigned int cur_row;
+
+    friend class SLStatementSelectTask;
 };
 
 #endif // __SQLITE3_STORAGE_H__
@@ -36,130 +36,303 @@
 using namespace zmm;
 using namespace std;
 
-StorageCache::StorageCache()
+StorageCache::StorageCache(size_t memoryLimit, function<void()> beforeEvict)
 {
-    capacity = STORAGE_CACHE_CAPACITY;
-    maxfill = STORAGE_CACHE_MAXFILL;
-    idHash = make_shared<unordered_map<int,Ref<CacheObject> > >();
-    locationHash = make_shared<unordered_map<zmm::String, Ref<Array<CacheObject> > > >();
-    hasBeenFlushed = false;
+    shardLimit = memoryLimit / STORAGE_CACHE_SHARDS;
+    this->beforeEvict = beforeEvict;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
 }
 
 void StorageCache::clear()
 {
-    AutoLock lock(mutex);
-    idHash->clear();
-    locationHash->clear();
+    for (auto& shard : shards) {
+        AutoLock lock(shard.mutex);
+        shard.entries.clear();
+        shard.probation.clear();
+        shard.protect.clear();
+        shard.memoryUsage = 0;
+        shard.protectedUsage = 0;
+    }
+    for (auto& shard : locationShards) {
+        AutoLock lock(shard.mutex);
+        shard.locations.clear();
+    }
 }
 
-Ref<CacheObject> StorageCache::getObject(int id)
+Ref<CdsObject> StorageCache::getObject(int id)
 {
-#ifdef TOMBDEBUG
-    //assert(mutex->isLocked());
-#endif
-    try {
-        return idHash->at(id);
-    } catch(out_of_range& nope) {
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    Entry* entry = lookup(shard, id);
+    if (entry == nullptr || !entry->obj->knowsObject()) {
+        misses++;
         return nullptr;
     }
+    hits++;
+    return entry->obj->getObject();
+}
+
+Ref<CdsObject> StorageCache::getObjectByLocation(String location)
+{
+    Ref<Array<CacheObject> > objects;
+    {
+        LocationShard& lShard = getLocationShard(location);
+        AutoLock lock(lShard.mutex);
+        auto it = lShard.locations.find(location);
+        if (it != lShard.locations.end())
+            objects = it->second;
+    }
+    if (objects != nullptr) {
+        for (int i = 0; i < objects->size(); i++) {
+            Ref<CacheObject> cObj = objects->get(i);
+            Shard& shard = getShard(cObj->getID());
+            AutoLock lock(shard.mutex);
+            // may have been evicted or replaced in the meantime
+            Entry* entry = lookup(shard, cObj->getID());
+            if (entry != nullptr && entry->obj == cObj && cObj->knowsObject()
+                && cObj->knowsVirtual() && !cObj->getVirtual()) {
+                hits++;
+                return cObj->getObject();
+            }
+        }
+    }
+    misses++;
+    return nullptr;
+}
+
+void StorageCache::addObject(Ref<CdsObject> obj)
+{
+    Shard& shard = getShard(obj->getID());
+    AutoLock lock(shard.mutex);
+    Entry& entry = lookupDefinitely(shard, obj->getID());
+    entry.obj->setObject(obj);
+    indexLocation(entry);
+    resize(shard, entry);
+    ensureFillLevelOk(shard);
+}
+
+void StorageCache::addContainer(int id, int parentID, String location)
+{
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    Entry& entry = lookupDefinitely(shard, id);
+    Ref<CacheObject> cObj = entry.obj;
+    cObj->setParentID(parentID);
+    cObj->setNumChildren(0);
+    cObj->setObjectType(OBJECT_TYPE_CONTAINER);
+    cObj->setLocation(location);
+    resize(shard, entry);
+    ensureFillLevelOk(shard);
+}
+
+bool StorageCache::getNumChildren(int id, int* numChildren)
+{
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    Entry* entry = lookup(shard, id);
+    if (entry == nullptr || !entry->obj->knowsNumChildren()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    *numChildren = entry->obj->getNumChildren();
+    return true;
 }
 
-Ref<CacheObject> StorageCache::getObjectDefinitely(int id)
+void StorageCache::setNumChildren(int id, int numChildren)
 {
-#ifdef TOMBDEBUG
-    //assert(mutex->isLocked());
-#endif
-    Ref<CacheObject> obj = nullptr;
-    try {
-        obj = idHash->at(id);
-    } catch (const out_of_range& ex) {
-        ensureFillLevelOk();
-        obj = Ref<CacheObject>(new CacheObject());
-        idHash->emplace(id, obj);
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    lookupDefinitely(shard, id).obj->setNumChildren(numChildren);
+    ensureFillLevelOk(shard);
+}
+
+bool StorageCache::getObjectType(int id, int* objectType)
+{
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    Entry* entry = lookup(shard, id);
+    if (entry == nullptr || !entry->obj->knowsObjectType()) {
+        misses++;
+        return false;
     }
-    return obj;
+    hits++;
+    *objectType = entry->obj->getObjectType();
+    return true;
+}
+
+void StorageCache::setObjectType(int id, int objectType)
+{
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    lookupDefinitely(shard, id).obj->setObjectType(objectType);
+    ensureFillLevelOk(shard);
 }
 
 void StorageCache::addChild(int id)
 {
-#ifdef TOMBDEBUG
-    //assert(mutex->isLocked());
-#endif
-    Ref<CacheObject> obj = nullptr;
-    try {
-        obj = idHash->at(id);
-        if (obj->knowsNumChildren())
-            obj->setNumChildren(obj->getNumChildren() + 1);
-    } catch(const out_of_range& ex) {} // id not found
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    auto it = shard.entries.find(id);
+    if (it == shard.entries.end())
+        return;
+    Ref<CacheObject> obj = it->second.obj;
+    if (obj->knowsNumChildren())
+        obj->setNumChildren(obj->getNumChildren() + 1);
 }
 
 bool StorageCache::removeObject(int id)
 {
-    AutoLock lock(mutex);
-    Ref<CacheObject> obj = getObject(id);
-    if (obj == nullptr)
+    Shard& shard = getShard(id);
+    AutoLock lock(shard.mutex);
+    auto it = shard.entries.find(id);
+    if (it == shard.entries.end())
         return false;
-    if (obj->knowsLocation())
-        locationHash->erase(obj->getLocation());
-    return idHash->erase(id);
+    erase(shard, it);
+    return true;
 }
 
-Ref<Array<CacheObject> > StorageCache::getObjects(String location)
+size_t StorageCache::getMemoryUsage()
 {
-#ifdef TOMBDEBUG
-    //assert(mutex->isLocked());
-#endif
-    try {
-        return locationHash->at(location);
-    } catch (const out_of_range& ex) {
+    size_t usage = 0;
+    for (auto& shard : shards) {
+        AutoLock lock(shard.mutex);
+        usage += shard.memoryUsage;
+    }
+    return usage;
+}
+
+/* private */
+
+StorageCache::LocationShard& StorageCache::getLocationShard(String location)
+{
+    return locationShards[hash<String>()(location) % STORAGE_CACHE_SHARDS];
+}
+
+StorageCache::Entry* StorageCache::lookup(Shard& shard, int id)
+{
+    auto it = shard.entries.find(id);
+    if (it == shard.entries.end())
         return nullptr;
+
+    // second use moves the entry into the protected segment
+    Entry& entry = it->second;
+    if (entry.isProtected) {
+        shard.protect.splice(shard.protect.begin(), shard.protect, entry.pos);
+        return &entry;
     }
+
+    shard.protect.splice(shard.protect.begin(), shard.probation, entry.pos);
+    entry.isProtected = true;
+    shard.protectedUsage += entry.size;
+
+    // demote the least recently used protected entries
+    while (shard.protectedUsage > shardLimit / 100 * STORAGE_CACHE_PROTECTED_PERCENT
+        && shard.protect.size() > 1) {
+        Entry& demoted = shard.entries.at(shard.protect.back());
+        shard.probation.splice(shard.probation.begin(), shard.protect, demoted.pos);
+        demoted.isProtected = false;
+        shard.protectedUsage -= demoted.size;
+    }
+    return &entry;
+}
+
+StorageCache::Entry& StorageCache::lookupDefinitely(Shard& shard, int id)
+{
+    Entry* found = lookup(shard, id);
+    if (found != nullptr)
+        return *found;
+
+    Entry& entry = shard.entries[id];
+    entry.obj = Ref<CacheObject>(new CacheObject(id));
+    entry.isProtected = false;
+    shard.probation.push_front(id);
+    entry.pos = shard.probation.begin();
+    entry.size = entry.obj->getSize();
+    shard.memoryUsage += entry.size;
+    return entry;
+}
+
+void StorageCache::resize(Shard& shard, Entry& entry)
+{
+    size_t size = entry.obj->getSize();
+    shard.memoryUsage += size - entry.size;
+    if (entry.isProtected)
+        shard.protectedUsage += size - entry.size;
+    entry.size = size;
 }
 
-void StorageCache::checkLocation(Ref<CacheObject> obj)
+void StorageCache::indexLocation(Entry& entry)
 {
-#ifdef TOMBDEBUG
-    //assert(mutex->isLocked());
-#endif
-    if (! obj->knowsLocation())
+    Ref<CacheObject> cObj = entry.obj;
+    if (!cObj->knowsLocation() || cObj->getLocation() == entry.indexedLocation)
         return;
-    String location = obj->getLocation();
-    Ref<Array<CacheObject> > objects = nullptr;
-    try {
-        objects = locationHash->at(location);
-        for (int i=0;i<objects->size();i++)
-        {
-            if (objects->get(i) == obj)
-                return;
-        }
-    } catch (const out_of_range& ex) {
+    unindexLocation(entry);
+
+    String location = cObj->getLocation();
+    LocationShard& lShard = getLocationShard(location);
+    AutoLock lock(lShard.mutex);
+    Ref<Array<CacheObject> > objects;
+    auto it = lShard.locations.find(location);
+    if (it == lShard.locations.end()) {
         objects = Ref<Array<CacheObject> >(new Array<CacheObject>());
-        locationHash->emplace(location, objects);
-    }
-    objects->append(obj);
+        lShard.locations.emplace(location, objects);
+    } else
+        objects = it->second;
+    objects->append(cObj);
+    entry.indexedLocation = location;
 }
 
-bool StorageCache::flushed()
+void StorageCache::unindexLocation(Entry& entry)
 {
-    if (! hasBeenFlushed)
-        return false;
-    hasBeenFlushed = false;
-    return true;
+    if (entry.indexedLocation == nullptr)
+        return;
+
+    LocationShard& lShard = getLocationShard(entry.indexedLocation);
+    AutoLock lock(lShard.mutex);
+    auto it = lShard.locations.find(entry.indexedLocation);
+    if (it != lShard.locations.end()) {
+        Ref<Array<CacheObject> > objects = it->second;
+        for (int i = 0; i < objects->size(); i++) {
+            if (objects->get(i) == entry.obj) {
+                objects->remove(i, 1);
+                break;
+            }
+        }
+        if (objects->size() == 0)
+            lShard.locations.erase(it);
+    }
+    entry.indexedLocation = nullptr;
 }
 
-/* private */
+void StorageCache::erase(Shard& shard, unordered_map<int, Entry>::iterator it)
+{
+    Entry& entry = it->second;
+    unindexLocation(entry);
+    shard.memoryUsage -= entry.size;
+    if (entry.isProtected) {
+        shard.protectedUsage -= entry.size;
+        shard.protect.erase(entry.pos);
+    } else
+        shard.probation.erase(entry.pos);
+    shard.entries.erase(it);
+}
 
-void StorageCache::ensureFillLevelOk()
+void StorageCache::ensureFillLevelOk(Shard& shard)
 {
-#ifdef TOMBDEBUG
-    //assert(mutex->isLocked());
-#endif
-    // TODO - much better...
-    // for now just clear cache if it gets too full
-    if (idHash->size() >= maxfill || locationHash->size() >= maxfill)
-    {
-        hasBeenFlushed = true;
-        idHash->clear();
-        locationHash->clear();
+    if (shard.memoryUsage <= shardLimit)
+        return;
+
+    if (beforeEvict)
+        beforeEvict();
+
+    size_t target = shardLimit / 100 * STORAGE_CACHE_EVICT_PERCENT;
+    while (shard.memoryUsage > target && shard.entries.size() > 1) {
+        // the entries that were only used once go first
+        int id = shard.probation.empty() ? shard.protect.back() : shard.probation.back();
+        erase(shard, shard.entries.find(id));
+        evictions++;
     }
 }
@@ -32,6 +32,9 @@
 #ifndef __STORAGE_CACHE_H__
 #define __STORAGE_CACHE_H__
 
+#include <atomic>
+#include <functional>
+#include <list>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
@@ -40,42 +43,118 @@
 #include "common.h"
 #include "cache_object.h"
 
-#define STORAGE_CACHE_CAPACITY 29989u
-#define STORAGE_CACHE_MAXFILL 9973u
+/// \brief number of independently locked parts of the cache
+#define STORAGE_CACHE_SHARDS 16
 
+/// \brief share of a shard's memory that entries used more than once may fill
+#define STORAGE_CACHE_PROTECTED_PERCENT 80
+
+/// \brief an overfull shard evicts down to this share of its memory, so
+/// evictions (and the insert buffer flushes before them) come in batches
+#define STORAGE_CACHE_EVICT_PERCENT 90
+
+/// \brief Cache of object information for SQLStorage.
+///
+/// The cache is limited by the estimated memory of its entries and evicts
+/// them with a segmented LRU: new entries start in a probationary segment
+/// and move into the protected segment when they are used again, so
+/// containers that are browsed over and over stay resident while a scan
+/// streams through the probationary segment. Every method locks the shard
+/// of the object it works on.
 class StorageCache : public zmm::Object
 {
 public:
-    StorageCache();
-    
-    zmm::Ref<CacheObject> getObject(int id);
-    zmm::Ref<CacheObject> getObjectDefinitely(int id);
-    bool removeObject(int id);
-    void clear();
-    
-    zmm::Ref<zmm::Array<CacheObject> > getObjects(zmm::String location);
-    void checkLocation(zmm::Ref<CacheObject> obj);
-    
+    /// \param memoryLimit size of the cache in bytes
+    /// \param beforeEvict called before entries are evicted, entries of
+    /// objects that are not yet written to the database must not get lost
+    StorageCache(size_t memoryLimit, std::function<void()> beforeEvict);
+
+    /// \brief returns the cached object, nullptr if it is not known
+    zmm::Ref<CdsObject> getObject(int id);
+
+    /// \brief returns the cached non-virtual object with the given location
+    zmm::Ref<CdsObject> getObjectByLocation(zmm::String location);
+
+    /// \brief stores a copy of the object
+    void addObject(zmm::Ref<CdsObject> obj);
+
+    /// \brief stores what is known about a newly created container
+    void addContainer(int id, int parentID, zmm::String location);
+
+    bool getNumChildren(int id, int *numChildren);
+    void setNumChildren(int id, int numChildren);
+
+    bool getObjectType(int id, int *objectType);
+    void setObjectType(int id, int objectType);
+
     // a child was added to the specified object - update numChildren accordingly,
     // if the object has cached information
     void addChild(int id);
-    
-    bool flushed();
-    
-    std::mutex & getMutex() { return mutex; }
-    
+
+    bool removeObject(int id);
+    void clear();
+
+    unsigned long long getHits() { return hits; }
+    unsigned long long getMisses() { return misses; }
+    unsigned long long getEvictions() { return evictions; }
+    size_t getMemoryUsage();
+
 private:
-    
-    int capacity;
-    unsigned int maxfill;
-    bool hasBeenFlushed;
-    
-    void ensureFillLevelOk();
-    
-    std::shared_ptr<std::unordered_map<int,zmm::Ref<CacheObject> > > idHash;
-    std::shared_ptr<std::unordered_map<zmm::String, zmm::Ref<zmm::Array<CacheObject> > > > locationHash;
-    std::mutex mutex;
+    class Entry
+    {
+    public:
+        zmm::Ref<CacheObject> obj;
+        size_t size;
+        bool isProtected;
+        std::list<int>::iterator pos;
+        /// location the object is indexed with in its location shard
+        zmm::String indexedLocation;
+    };
+
+    class Shard
+    {
+    public:
+        Shard() { memoryUsage = 0; protectedUsage = 0; }
+        std::unordered_map<int, Entry> entries;
+        std::list<int> probation;
+        std::list<int> protect;
+        size_t memoryUsage;
+        size_t protectedUsage;
+        std::mutex mutex;
+    };
+
+    class LocationShard
+    {
+    public:
+        std::unordered_map<zmm::String, zmm::Ref<zmm::Array<CacheObject> > > locations;
+        std::mutex mutex;
+    };
+
     using AutoLock = std::lock_guard<std::mutex>;
+
+    size_t shardLimit;
+    std::function<void()> beforeEvict;
+    Shard shards[STORAGE_CACHE_SHARDS];
+    LocationShard locationShards[STORAGE_CACHE_SHARDS];
+
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+    std::atomic<unsigned long long> evictions;
+
+    inline Shard &getShard(int id)
+    { return shards[(unsigned int)id % STORAGE_CACHE_SHARDS]; }
+    LocationShard &getLocationShard(zmm::String location);
+
+    /// \brief looks up an entry and marks it as used, shard must be locked
+    Entry *lookup(Shard &shard, int id);
+    /// \brief looks up or creates an entry, shard must be locked
+    Entry &lookupDefinitely(Shard &shard, int id);
+    /// \brief re-measures an entry after it was changed, shard must be locked
+    void resize(Shard &shard, Entry &entry);
+    void indexLocation(Entry &entry);
+    void unindexLocation(Entry &entry);
+    void erase(Shard &shard, std::unordered_map<int, Entry>::iterator it);
+    void ensureFillLevelOk(Shard &shard);
 };
 
 #endif // __STORAGE_CACHE_H__
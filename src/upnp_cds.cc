@@ -31,6 +31,7 @@
 
 #include "upnp_cds.h"
 #include "config_manager.h"
+#include "didl_writer.h"
 #include "server.h"
 #include "storage.h"
 
@@ -42,12 +43,63 @@ ContentDirectoryService::ContentDirectoryService(UpnpDevice_Handle deviceHandle)
     , stringLimit(ConfigManager::getInstance()->getIntOption(CFG_SERVER_UPNP_TITLE_AND_DESC_STRING_LIMIT))
     , deviceHandle(deviceHandle)
 {
+    int memory = ConfigManager::getInstance()->getIntOption(CFG_SERVER_UPNP_BROWSE_CACHE_MEMORY);
+    if (memory > 0)
+        browseCache = Ref<BrowseCache>(new BrowseCache((size_t)memory * 1024 * 1024));
 }
 
 ContentDirectoryService::~ContentDirectoryService()
 {
 }
 
+String ContentDirectoryService::renderDIDL(Ref<Array<CdsObject>> arr, String filter, unsigned long long generation)
+{
+    // the same options for the whole response
+    std::shared_ptr<const ConfigSnapshot> config = ConfigManager::getSnapshot();
+    Ref<DIDLCache> didlCache = Storage::getInstance()->getDIDLCache();
+    Ref<DIDLFilter> didlFilter = DIDLFilter::parse(filter);
+    std::string filterKey = (filter != nullptr) ? filter.c_str() : "";
+
+    // written escaped, the result goes into the response as it is
+    Ref<DIDLWriter> writer(new DIDLWriter(true));
+    bool samsungNamespace = false;
+#ifdef EXTEND_PROTOCOLINFO
+    samsungNamespace = config->samsungHack;
+#endif
+    writer->startDIDL(samsungNamespace);
+
+    for (int i = 0; i < arr->size(); i++) {
+        Ref<CdsObject> obj = arr->get(i);
+        if (config->markPlayedItems && obj->getFlag(OBJECT_FLAG_PLAYED)) {
+            String title = obj->getTitle();
+            String mark = config->markPlayedString;
+            if (config->markPlayedPrepend)
+                title = mark + title;
+            else
+                title = title + mark;
+
+            obj->setTitle(title);
+        }
+
+        // marked first, the artwork of a cached track is found by the same title
+        if (didlCache != nullptr) {
+            String fragment = didlCache->get(obj, filterKey);
+            if (fragment != nullptr) {
+                writer->writeCachedObject(obj, fragment, didlFilter);
+                continue;
+            }
+        }
+
+        if (didlCache != nullptr)
+            didlCache->put(obj, filterKey, writer->writeObjectFragment(obj, stringLimit, didlFilter), generation);
+        else
+            writer->writeObject(obj, stringLimit, didlFilter);
+    }
+
+    writer->endDIDL();
+    return writer->toString();
+}
+
 void ContentDirectoryService::upnp_action_Browse(Ref<ActionRequest> request)
 {
     log_debug("start\n");
@@ -58,13 +110,13 @@ void ContentDirectoryService::upnp_action_Browse(Ref<ActionRequest> request)
     String objID = req->getChildText(_("ObjectID"));
     int objectID;
     String BrowseFlag = req->getChildText(_("BrowseFlag"));
-    //String Filter; // not yet supported
+    String filter = req->getChildText(_("Filter"));
     String StartingIndex = req->getChildText(_("StartingIndex"));
     String RequestedCount = req->getChildText(_("RequestedCount"));
-    // String SortCriteria; // not yet supported
+    String sortCriteria = req->getChildText(_("SortCriteria"));
 
-    log_debug("Browse received parameters: ObjectID [%s] BrowseFlag [%s] StartingIndex [%s] RequestedCount [%s]\n",
-              objID.c_str(), BrowseFlag.c_str(), StartingIndex.c_str(), RequestedCount.c_str());
+    log_debug("Browse received parameters: ObjectID [%s] BrowseFlag [%s] Filter [%s] StartingIndex [%s] RequestedCount [%s] SortCriteria [%s]\n",
+              objID.c_str(), BrowseFlag.c_str(), filter.c_str(), StartingIndex.c_str(), RequestedCount.c_str(), sortCriteria.c_str());
 
     if (objID == nullptr)
         throw UpnpException(UPNP_E_NO_SUCH_ID, _("empty object id"));
@@ -79,18 +131,41 @@ void ContentDirectoryService::upnp_action_Browse(Ref<ActionRequest> request)
         throw UpnpException(UPNP_SOAP_E_INVALID_ARGS,
             _("invalid browse flag: ") + BrowseFlag);
 
+    // a result is only valid for the content it was rendered from, which
+    // is loaded after the generation was taken
+    unsigned long long contentGeneration = storage->getContentGeneration();
+    int updateID = systemUpdateID;
+    std::string cacheKey;
+    BrowseCache::Result result;
+    if (browseCache != nullptr) {
+        // XML text can not contain NUL, so the fields can not run into each other
+        cacheKey = std::to_string(objectID) + '\0' + BrowseFlag.c_str()
+            + '\0' + std::to_string(StartingIndex.toInt())
+            + '\0' + std::to_string(RequestedCount.toInt())
+            + '\0' + (filter != nullptr ? filter.c_str() : "")
+            + '\0' + (sortCriteria != nullptr ? sortCriteria.c_str() : "");
+        if (browseCache->get(cacheKey, contentGeneration, result)) {
+            log_debug("Browse answered from the cache\n");
+            respondBrowse(request, result, updateID);
+            return;
+        }
+    }
+
     Ref<CdsObject> parent = storage->loadObject(objectID);
     if ((parent->getClass() == UPNP_DEFAULT_CLASS_MUSIC_ALBUM) || (parent->getClass() == UPNP_DEFAULT_CLASS_PLAYLIST_CONTAINER))
         flag |= BROWSE_TRACK_SORT;
 
-    if (ConfigManager::getInstance()->getBoolOption(CFG_SERVER_HIDE_PC_DIRECTORY))
+    if (ConfigManager::getSnapshot()->hidePCDirectory)
         flag |= BROWSE_HIDE_FS_ROOT;
 
     Ref<BrowseParam> param(new BrowseParam(objectID, flag));
 
     param->setStartingIndex(StartingIndex.toInt());
     param->setRequestedCount(RequestedCount.toInt());
+    param->setSortCriteria(SortCriteria::parse(sortCriteria));
 
+    Ref<DIDLCache> didlCache = storage->getDIDLCache();
+    unsigned long long generation = (didlCache != nullptr) ? didlCache->getGeneration() : 0;
     Ref<Array<CdsObject>> arr;
 
     try {
@@ -99,44 +174,72 @@ void ContentDirectoryService::upnp_action_Browse(Ref<ActionRequest> request)
         throw UpnpException(UPNP_E_NO_SUCH_ID, _("no such object"));
     }
 
-    Ref<Element> didl_lite(new Element(_("DIDL-Lite")));
-    didl_lite->setAttribute(_(XML_NAMESPACE_ATTR),
-        _(XML_DIDL_LITE_NAMESPACE));
-    didl_lite->setAttribute(_(XML_DC_NAMESPACE_ATTR),
-        _(XML_DC_NAMESPACE));
-    didl_lite->setAttribute(_(XML_UPNP_NAMESPACE_ATTR),
-        _(XML_UPNP_NAMESPACE));
+    result.didl = renderDIDL(arr, filter, generation);
+    result.numberReturned = arr->size();
+    result.totalMatches = param->getTotalMatches();
+    if (browseCache != nullptr)
+        browseCache->put(cacheKey, contentGeneration, result);
 
-    Ref<ConfigManager> cfg = ConfigManager::getInstance();
+    respondBrowse(request, result, updateID);
+    log_debug("end\n");
+}
 
-#ifdef EXTEND_PROTOCOLINFO
-    if (cfg->getBoolOption(CFG_SERVER_EXTEND_PROTOCOLINFO_SM_HACK)) {
-        didl_lite->setAttribute(_(XML_SEC_NAMESPACE_ATTR),
-            _(XML_SEC_NAMESPACE));
-    }
-#endif
+void ContentDirectoryService::respondBrowse(Ref<ActionRequest> request, const BrowseCache::Result& result, int updateID)
+{
+    Ref<Element> response;
+    response = UpnpXML_CreateResponse(request->getActionName(), _(DESC_CDS_SERVICE_TYPE));
 
-    for (int i = 0; i < arr->size(); i++) {
-        Ref<CdsObject> obj = arr->get(i);
-        if (cfg->getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_ENABLED) && obj->getFlag(OBJECT_FLAG_PLAYED)) {
-            String title = obj->getTitle();
-            if (cfg->getBoolOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_STRING_MODE_PREPEND))
-                title = cfg->getOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_STRING) + title;
-            else
-                title = title + cfg->getOption(CFG_SERVER_EXTOPTS_MARK_PLAYED_ITEMS_STRING);
+    response->appendTextChild(_("Result"), result.didl, mxml_raw_type);
+    response->appendTextChild(_("NumberReturned"), String::from(result.numberReturned));
+    response->appendTextChild(_("TotalMatches"), String::from(result.totalMatches));
+    response->appendTextChild(_("UpdateID"), String::from(updateID));
 
-            obj->setTitle(title);
-        }
+    request->setResponse(response);
+}
+
+void ContentDirectoryService::upnp_action_Search(Ref<ActionRequest> request)
+{
+    log_debug("start\n");
+    Ref<Storage> storage = Storage::getInstance();
+
+    Ref<Element> req = request->getRequest();
+
+    String containerID = req->getChildText(_("ContainerID"));
+    String searchCriteria = req->getChildText(_("SearchCriteria"));
+    String filter = req->getChildText(_("Filter"));
+    String StartingIndex = req->getChildText(_("StartingIndex"));
+    String RequestedCount = req->getChildText(_("RequestedCount"));
+    String sortCriteria = req->getChildText(_("SortCriteria"));
 
-        Ref<Element> didl_object = UpnpXML_DIDLRenderObject(obj, false, stringLimit);
+    log_debug("Search received parameters: ContainerID [%s] SearchCriteria [%s] Filter [%s] StartingIndex [%s] RequestedCount [%s] SortCriteria [%s]\n",
+              containerID.c_str(), searchCriteria.c_str(), filter.c_str(), StartingIndex.c_str(), RequestedCount.c_str(), sortCriteria.c_str());
 
-        didl_lite->appendElementChild(didl_object);
+    if (containerID == nullptr)
+        throw UpnpException(UPNP_E_NO_SUCH_ID, _("empty container id"));
+
+    Ref<SearchParam> param(new SearchParam(containerID.toInt(), SearchCriteria::parse(searchCriteria)));
+    param->setRange(StartingIndex.toInt(), RequestedCount.toInt());
+    param->setSortCriteria(SortCriteria::parse(sortCriteria));
+
+    Ref<DIDLCache> didlCache = storage->getDIDLCache();
+    unsigned long long generation = (didlCache != nullptr) ? didlCache->getGeneration() : 0;
+    Ref<Array<CdsObject>> arr;
+
+    try {
+        Ref<CdsObject> container = storage->loadObject(param->getContainerID());
+        if (!IS_CDS_CONTAINER(container->getObjectType()))
+            throw UpnpException(UPNP_E_NO_SUCH_CONTAINER, _("not a container"));
+        arr = storage->search(param);
+    } catch (const UpnpException& e) {
+        throw;
+    } catch (const Exception& e) {
+        throw UpnpException(UPNP_E_NO_SUCH_CONTAINER, _("no such container"));
     }
 
     Ref<Element> response;
     response = UpnpXML_CreateResponse(request->getActionName(), _(DESC_CDS_SERVICE_TYPE));
 
-    response->appendTextChild(_("Result"), didl_lite->print());
+    response->appendTextChild(_("Result"), renderDIDL(arr, filter, generation), mxml_raw_type);
     response->appendTextChild(_("NumberReturned"), String::from(arr->size()));
     response->appendTextChild(_("TotalMatches"), String::from(param->getTotalMatches()));
     response->appendTextChild(_("UpdateID"), String::from(systemUpdateID));
@@ -151,7 +254,7 @@ void ContentDirectoryService::upnp_action_GetSearchCapabilities(Ref<ActionReques
 
     Ref<Element> response;
     response = UpnpXML_CreateResponse(request->getActionName(), _(DESC_CDS_SERVICE_TYPE));
-    response->appendTextChild(_("SearchCaps"), _(""));
+    response->appendTextChild(_("SearchCaps"), SearchCriteria::getCapabilities());
 
     request->setResponse(response);
 
@@ -164,7 +267,7 @@ void ContentDirectoryService::upnp_action_GetSortCapabilities(Ref<ActionRequest>
 
     Ref<Element> response;
     response = UpnpXML_CreateResponse(request->getActionName(), _(DESC_CDS_SERVICE_TYPE));
-    response->appendTextChild(_("SortCaps"), _(""));
+    response->appendTextChild(_("SortCaps"), SortCriteria::getCapabilities());
 
     request->setResponse(response);
 
@@ -190,6 +293,8 @@ void ContentDirectoryService::process_action_request(Ref<ActionRequest> request)
 
     if (request->getActionName() == "Browse") {
         upnp_action_Browse(request);
+    } else if (request->getActionName() == "Search") {
+        upnp_action_Search(request);
     } else if (request->getActionName() == "GetSearchCapabilities") {
         upnp_action_GetSearchCapabilities(request);
     } else if (request->getActionName() == "GetSortCapabilities") {
@@ -229,7 +334,7 @@ void ContentDirectoryService::process_subscription_request(zmm::Ref<Subscription
     }
 
     UpnpAcceptSubscriptionExt(deviceHandle,
-        ConfigManager::getInstance()->getOption(CFG_SERVER_UDN).c_str(),
+        ConfigManager::getSnapshot()->udn.c_str(),
         DESC_CDS_SERVICE_ID, event, request->getSubscriptionID().c_str());
 
     ixmlDocument_free(event);
@@ -261,7 +366,7 @@ void ContentDirectoryService::subscription_update(String containerUpdateIDs_CSV)
     }
 
     UpnpNotifyExt(deviceHandle,
-        ConfigManager::getInstance()->getOption(CFG_SERVER_UDN).c_str(),
+        ConfigManager::getSnapshot()->udn.c_str(),
         DESC_CDS_SERVICE_ID, event);
 
     ixmlDocument_free(event);
@@ -32,7 +32,11 @@
 #ifndef __UPNP_CDS_H__
 #define __UPNP_CDS_H__
 
+#include <atomic>
+
 #include "action_request.h"
+#include "browse_cache.h"
+#include "cds_objects.h"
 #include "common.h"
 #include "singleton.h"
 #include "subscription_request.h"
@@ -49,11 +53,22 @@ protected:
     /// devices.
     /// Also, this variable is returned by the upnp_action_GetSystemUpdateID()
     /// action.
-    int systemUpdateID;
+    std::atomic<int> systemUpdateID;
+
+    /// \brief Results of recent Browse actions, nullptr if the cache is
+    /// disabled.
+    zmm::Ref<BrowseCache> browseCache;
 
     /// \brief All strings in the XML will be cut at this length.
     int stringLimit;
 
+    /// \brief renders the objects of a Browse or Search result as DIDL-Lite,
+    /// limited to the properties of the Filter argument
+    /// \param generation generation of the DIDL cache before the objects
+    /// were loaded
+    /// \return the DIDL-Lite already escaped for the Result element
+    zmm::String renderDIDL(zmm::Ref<zmm::Array<CdsObject> > objects, zmm::String filter, unsigned long long generation);
+
     /// \brief UPnP standard defined action: Browse()
     /// \param request Incoming ActionRequest.
     ///
@@ -62,6 +77,17 @@ protected:
     /// ui4 TotalMatches, ui4 UpdateID)
     void upnp_action_Browse(zmm::Ref<ActionRequest> request);
 
+    /// \brief sets the response of a Browse action
+    void respondBrowse(zmm::Ref<ActionRequest> request, const BrowseCache::Result& result, int updateID);
+
+    /// \brief UPnP standard defined action: Search()
+    /// \param request Incoming ActionRequest.
+    ///
+    /// Search(string ContainerID, string SearchCriteria, string Filter,
+    /// ui4 StartingIndex, ui4 RequestedCount, string SortCriteria,
+    /// string Result, ui4 NumberReturned, ui4 TotalMatches, ui4 UpdateID)
+    void upnp_action_Search(zmm::Ref<ActionRequest> request);
+
     /// \brief UPnP standard defined action: GetSearchCapabilities()
     /// \param request Incoming ActionRequest.
     ///
@@ -109,6 +135,8 @@ public:
     /// an event to all subscribed devices. Container updates are supported,
     /// and of course the mimimum required - systemUpdateID.
     void subscription_update(zmm::String containerUpdateIDs_CSV);
+
+    zmm::Ref<BrowseCache> getBrowseCache() { return browseCache; }
 };
 
 #endif // __UPNP_CDS_H__
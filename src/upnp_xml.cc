@@ -48,8 +48,12 @@ Ref<Element> UpnpXML_CreateResponse(String actionName, String serviceType)
     return response; 
 }
 
-Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, int stringLimit)
+Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, int stringLimit, Ref<DIDLFilter> filter)
 {
+    String albumArtURI = MetadataHandler::getMetaFieldName(M_ALBUMARTURI);
+    bool renderRes = (filter == nullptr || filter->has(_("res")));
+    bool renderAlbumArt = (filter == nullptr || filter->has(albumArtURI));
+
     Ref<Element> result(new Element(_("")));
     
     result->setAttribute(_("id"), String::from(obj->getID()));
@@ -84,6 +88,8 @@ Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, in
         {
             Ref<DictionaryElement> el = elements->get(i);
             key = el->getKey();
+            if (filter != nullptr && !filter->has(key))
+                continue;
             if (key == MetadataHandler::getMetaFieldName(M_DESCRIPTION))
             {
                 tmp = el->getValue();
@@ -106,9 +112,16 @@ Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, in
                 result->appendTextChild(key, el->getValue());
         }
 
-        CdsResourceManager::addResources(item, result);
+        // the album art of the item is rendered with its resources
+        if (renderRes || renderAlbumArt) {
+            CdsResourceManager::addResources(item, result);
+            if (!renderRes)
+                result->removeElementChild(_("res"), true);
+            if (!renderAlbumArt)
+                result->removeElementChild(albumArtURI, true);
+        }
         
-        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_TRACK) {
+        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_TRACK && renderAlbumArt) {
             Ref<Storage> storage = Storage::getInstance();
             // extract extension-less, lowercase track name to search for corresponding
             // image as cover alternative
@@ -120,15 +133,7 @@ Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, in
             } 
             String aa_id = storage->findFolderImage(item->getParentID(), trackArtBase);
             if (aa_id != nullptr) {
-                String url;
-                Ref<Dictionary> dict(new Dictionary());
-                dict->put(_(URL_OBJECT_ID), aa_id);
-
-                url = Server::getInstance()->getVirtualURL() +
-                        _(_URL_PARAM_SEPARATOR) +
-                        CONTENT_MEDIA_HANDLER + _(_URL_PARAM_SEPARATOR) +
-                        dict->encodeSimple() + _(_URL_PARAM_SEPARATOR) +
-                        _(URL_RESOURCE_ID) + _(_URL_PARAM_SEPARATOR) + "0";
+                String url = UpnpXML_DIDLFolderImageURL(aa_id);
                 log_debug("UpnpXML_DIDLRenderObject: url: %s\n", url.c_str());
                 Ref<Element> aa(new Element(MetadataHandler::getMetaFieldName(M_ALBUMARTURI)));
                 aa->setText(url);
@@ -148,7 +153,7 @@ Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, in
 
         String upnp_class = obj->getClass();
         log_debug("container is class: %s\n", upnp_class.c_str());
-        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM) {
+        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM && (filter == nullptr || filter->has(_("dc:creator")))) {
             Ref<Dictionary> meta = obj->getMetadata();
 
             String creator = meta->get(MetadataHandler::getMetaFieldName(M_ALBUMARTIST));
@@ -160,60 +165,21 @@ Ref<Element> UpnpXML_DIDLRenderObject(Ref<CdsObject> obj, bool renderActions, in
                 result->appendElementChild(UpnpXML_DIDLRenderCreator(creator));
             }
         }
-        if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM || upnp_class == UPNP_DEFAULT_CLASS_CONTAINER) {
+        if ((upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM || upnp_class == UPNP_DEFAULT_CLASS_CONTAINER) && renderAlbumArt) {
             Ref<Storage> storage = Storage::getInstance();
             String aa_id = storage->findFolderImage(cont->getID(), String());
 
             if (aa_id != nullptr) {
                 log_debug("Using folder image as artwork for container\n");
 
-                String url;
-                Ref<Dictionary> dict(new Dictionary());
-                dict->put(_(URL_OBJECT_ID), aa_id);
-
-                url = Server::getInstance()->getVirtualURL() +
-                    _(_URL_PARAM_SEPARATOR) +
-                    CONTENT_MEDIA_HANDLER + _(_URL_PARAM_SEPARATOR) +
-                    dict->encodeSimple() + _(_URL_PARAM_SEPARATOR) +
-                    _(URL_RESOURCE_ID) + _(_URL_PARAM_SEPARATOR) + "0";
-
-                result->appendElementChild(UpnpXML_DIDLRenderAlbumArtURI(url));
+                result->appendElementChild(UpnpXML_DIDLRenderAlbumArtURI(UpnpXML_DIDLFolderImageURL(aa_id)));
 
             } else if (upnp_class == UPNP_DEFAULT_CLASS_MUSIC_ALBUM) {
                 // try to find the first track and use its artwork
-                auto items = storage->getObjects(cont->getID(), true);
-                if (items != nullptr) {
-
-                    bool artAdded = false;
-                    for (const auto &id : *items) {
-                        if (artAdded)
-                            break;
-
-                        Ref<CdsObject> obj = storage->loadObject(id);
-                        if (obj->getClass() != UPNP_DEFAULT_CLASS_MUSIC_TRACK)
-                            continue;
-
-                        Ref<CdsItem> item = RefCast(obj, CdsItem);
-
-                        auto resources = item->getResources();
-
-                        for (int i = 1; i < resources->size(); i++) {
-                            auto res = resources->get(i);
-                            // only add upnp:AlbumArtURI if we have an AA, skip the resource
-                            if ((res->getHandlerType() == CH_ID3) ||
-                                (res->getHandlerType() == CH_MP4) ||
-                                (res->getHandlerType() == CH_FLAC) ||
-                                (res->getHandlerType() == CH_FANART) ||
-                                (res->getHandlerType() == CH_EXTURL)) {
-
-                                String url = CdsResourceManager::getArtworkUrl(item);
-                                result->appendElementChild(UpnpXML_DIDLRenderAlbumArtURI(url));
-
-                                artAdded = true;
-                                break;
-                            }
-                        }
-                    }
+                Ref<CdsItem> item = storage->findEmbeddedArtItem(cont->getID());
+                if (item != nullptr) {
+                    String url = CdsResourceManager::getArtworkUrl(item);
+                    result->appendElementChild(UpnpXML_DIDLRenderAlbumArtURI(url));
                 }
             }
         }
@@ -498,6 +464,18 @@ Ref<Element> UpnpXML_DIDLRenderCreator(String creator) {
     return out;
 }
 
+String UpnpXML_DIDLFolderImageURL(String imageID)
+{
+    Ref<Dictionary> dict(new Dictionary());
+    dict->put(_(URL_OBJECT_ID), imageID);
+
+    return Server::getInstance()->getVirtualURL() +
+        _(_URL_PARAM_SEPARATOR) +
+        CONTENT_MEDIA_HANDLER + _(_URL_PARAM_SEPARATOR) +
+        dict->encodeSimple() + _(_URL_PARAM_SEPARATOR) +
+        _(URL_RESOURCE_ID) + _(_URL_PARAM_SEPARATOR) + "0";
+}
+
 Ref<Element> UpnpXML_DIDLRenderAlbumArtURI(String uri) {
     Ref<Element> out(new Element(_("upnp:albumArtURI")));
     out->setText(uri);
@@ -35,6 +35,7 @@
 #include "common.h"
 #include "mxml/mxml.h"
 #include "cds_objects.h"
+#include "didl_filter.h"
 
 /// \brief Renders XML for the action response header.
 /// \param actionName Name of the action.
@@ -50,13 +51,16 @@ zmm::Ref<mxml::Element> UpnpXML_CreateResponse(zmm::String actionName, zmm::Stri
 /// \brief Renders the DIDL-Lite representation of an object in the content directory.
 /// \param obj Object to be rendered as XML.
 /// \param renderActions If true, also render special elements of an active item.
+/// \param filter Optional properties to render, nullptr renders all of them.
 /// \return mxml::Element representing the newly created XML.
 ///
 /// This function looks at the object, and renders the DIDL-Lite representation of it - 
 /// either a container or an item. The renderActions parameter tells us whether to also
 /// show the special fields of an active item in the XML. This is currently used when
 /// providing the XML representation of an active item to a trigger/toggle script.
-zmm::Ref<mxml::Element> UpnpXML_DIDLRenderObject(zmm::Ref<CdsObject> obj, bool renderActions = false, int stringLimit = -1);
+/// Properties left out by the filter are not looked up at all, apart from
+/// dc:title and upnp:class which are always required.
+zmm::Ref<mxml::Element> UpnpXML_DIDLRenderObject(zmm::Ref<CdsObject> obj, bool renderActions = false, int stringLimit = -1, zmm::Ref<DIDLFilter> filter = nullptr);
 
 /// \todo change the text string to element, parsing should be done outside
 void UpnpXML_DIDLUpdateObject(zmm::Ref<CdsObject> obj, zmm::String text);
@@ -84,4 +88,8 @@ zmm::Ref<mxml::Element> UpnpXML_DIDLRenderCaptionInfo(zmm::String URL);
 zmm::Ref<mxml::Element> UpnpXML_DIDLRenderCreator(zmm::String creator);
 
 zmm::Ref<mxml::Element> UpnpXML_DIDLRenderAlbumArtURI(zmm::String uri);
+
+/// \brief URL of a folder image used as upnp:albumArtURI
+/// \param imageID object id of the image item
+zmm::String UpnpXML_DIDLFolderImageURL(zmm::String imageID);
 #endif // __UPNP_XML_H__
@@ -0,0 +1,68 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  cache_stats.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file cache_stats.cc
+
+#include "pages.h"
+#include "server.h"
+#include "storage.h"
+
+using namespace zmm;
+using namespace mxml;
+
+static Ref<Element> renderCache(String name, bool enabled)
+{
+    Ref<Element> cache(new Element(name));
+    cache->setAttribute(_("enabled"), enabled ? _("1") : _("0"), mxml_bool_type);
+    return cache;
+}
+
+static void setCounter(Ref<Element> cache, String name, unsigned long long value)
+{
+    cache->setAttribute(name, String::from((long long)value), mxml_int_type);
+}
+
+void web::cacheStats::process()
+{
+    check_request();
+
+    Ref<BrowseCache> browseCache = Server::getInstance()->getBrowseCache();
+    Ref<Element> browse = renderCache(_("browse_cache"), browseCache != nullptr);
+    if (browseCache != nullptr) {
+        setCounter(browse, _("hits"), browseCache->getHits());
+        setCounter(browse, _("misses"), browseCache->getMisses());
+        setCounter(browse, _("evictions"), browseCache->getEvictions());
+        setCounter(browse, _("entries"), browseCache->getEntryCount());
+        setCounter(browse, _("memory"), browseCache->getMemoryUsage());
+    }
+    root->appendElementChild(browse);
+
+    Ref<DIDLCache> didlCache = Storage::getInstance()->getDIDLCache();
+    Ref<Element> fragments = renderCache(_("fragment_cache"), didlCache != nullptr);
+    if (didlCache != nullptr) {
+        setCounter(fragments, _("hits"), didlCache->getHits());
+        setCounter(fragments, _("misses"), didlCache->getMisses());
+        setCounter(fragments, _("evictions"), didlCache->getEvictions());
+        setCounter(fragments, _("memory"), didlCache->getMemoryUsage());
+    }
+    root->appendElementChild(fragments);
+}
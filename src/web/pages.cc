@@ -49,6 +49,8 @@ WebRequestHandler *create_web_request_handler(String page)
     if (page == "void") return new web::voidType();
     if (page == "tasks") return new web::tasks();
     if (page == "action") return new web::action();
+    if (page == "query_stats") return new web::queryStats();
+    if (page == "cache_stats") return new web::cacheStats();
     
     throw _Exception(_("Unknown page: ") + page);
 }
@@ -152,6 +152,20 @@ public:
     virtual void process();
 };
 
+/// \brief query latency statistics and slow query log
+class queryStats : public WebRequestHandler
+{
+public:
+    virtual void process();
+};
+
+/// \brief hits and memory of the Browse caches
+class cacheStats : public WebRequestHandler
+{
+public:
+    virtual void process();
+};
+
 /// \brief UI action button
 class action : public WebRequestHandler
 {
@@ -0,0 +1,92 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  query_stats.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+
+/// \file query_stats.cc
+
+#include "pages.h"
+#include "storage.h"
+
+using namespace zmm;
+using namespace mxml;
+
+void web::queryStats::process()
+{
+    check_request();
+    String action = param(_("action"));
+    if (!string_ok(action))
+        action = _("list");
+
+    Ref<Storage> storage = Storage::getInstance();
+    Ref<QueryStats> stats = storage->getQueryStats();
+    root->setAttribute(_("enabled"), stats != nullptr ? _("1") : _("0"), mxml_bool_type);
+    if (stats == nullptr)
+        return;
+
+    if (action == "reset") {
+        stats->reset();
+        return;
+    }
+    if (action != "list")
+        throw _Exception(_("web:query_stats called with illegal action"));
+
+    // all times in microseconds
+    Ref<Element> queries(new Element(_("queries")));
+    queries->setArrayName(_("query"));
+    root->appendElementChild(queries);
+    for (auto const& shape : stats->getShapes()) {
+        Ref<Element> query(new Element(_("query")));
+        query->setAttribute(_("count"), String::from((long long)shape.count), mxml_int_type);
+        query->setAttribute(_("rows"), String::from((long long)shape.rows), mxml_int_type);
+        query->setAttribute(_("total"), String::from(shape.totalMicros), mxml_int_type);
+        query->setAttribute(_("p50"), String::from(shape.p50Micros), mxml_int_type);
+        query->setAttribute(_("p99"), String::from(shape.p99Micros), mxml_int_type);
+        query->setAttribute(_("max"), String::from(shape.maxMicros), mxml_int_type);
+        query->appendTextChild(_("sql"), String(shape.fingerprint.c_str(), shape.fingerprint.length()));
+        queries->appendElementChild(query);
+    }
+
+    Ref<Element> slowQueries(new Element(_("slow_queries")));
+    slowQueries->setArrayName(_("query"));
+    root->appendElementChild(slowQueries);
+    for (auto& slow : stats->getSlowQueries()) {
+        String sql(slow.query.c_str(), slow.query.length());
+        // explained when first shown, the plan is kept with the entry
+        if (slow.plan == nullptr) {
+            try {
+                slow.plan = storage->explainQuery(sql);
+            } catch (const Exception& e) {
+                slow.plan = e.getMessage();
+            }
+            if (slow.plan == nullptr)
+                slow.plan = _("");
+            stats->setPlan(slow.id, slow.plan);
+        }
+        Ref<Element> query(new Element(_("query")));
+        query->setAttribute(_("time"), String::from((long)slow.time), mxml_int_type);
+        query->setAttribute(_("duration"), String::from(slow.micros), mxml_int_type);
+        query->setAttribute(_("rows"), String::from((long long)slow.rows), mxml_int_type);
+        query->appendTextChild(_("sql"), sql);
+        if (string_ok(slow.plan))
+            query->appendTextChild(_("plan"), slow.plan);
+        slowQueries->appendElementChild(query);
+    }
+}
@@ -53,3 +53,25 @@ TEST_F(DictionaryTest, PutWithExistingKeyReplacesValue)
     EXPECT_EQ(3, dictionary2.size());
     EXPECT_EQ(dictionary2.get(String("keyTwo")), String("replacementValue"));
 }
+
+TEST_F(DictionaryTest, CompactEncodingRoundTrip)
+{
+    dictionary2.put(String("key=&4"), String("value with spaces, % and | ~"));
+    dictionary2.put(String("empty"), String(""));
+
+    String encoded = dictionary2.encodeCompact();
+    EXPECT_TRUE(encoded.startsWith(String(DICTIONARY_COMPACT_PREFIX)));
+
+    dictionary1.decodeCompact(encoded);
+    EXPECT_EQ(5, dictionary1.size());
+    EXPECT_EQ(dictionary1.get(String("keyOne")), String("valueOne"));
+    EXPECT_EQ(dictionary1.get(String("empty")), String(""));
+    EXPECT_EQ(dictionary1.get(String("key=&4")), String("value with spaces, % and | ~"));
+}
+
+TEST_F(DictionaryTest, DecodeCompactAcceptsUrlEncoding)
+{
+    dictionary1.decodeCompact(dictionary2.encode());
+    EXPECT_EQ(3, dictionary1.size());
+    EXPECT_EQ(dictionary1.get(String("keyTwo")), String("valueTwo"));
+}
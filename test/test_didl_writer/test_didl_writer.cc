@@ -0,0 +1,250 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  test_didl_writer.cc - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+#include "test_didl_writer.h"
+#include "didl_writer.h"
+#include "upnp_xml.h"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace zmm;
+using namespace mxml;
+
+// objects per page and pages rendered by the benchmark
+#define PAGE_SIZE 500
+#define BENCHMARK_ROUNDS 50
+
+void DIDLWriterTest::SetUp()
+{
+    page = Ref<Array<CdsObject>>(new Array<CdsObject>());
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        if (i % 10 == 0) {
+            Ref<CdsContainer> album(new CdsContainer());
+            album->setID(i + 100);
+            album->setParentID(10);
+            album->setTitle(_("Album <") + i + "> & 'Friends' \"live\"");
+            album->setClass(_(UPNP_DEFAULT_CLASS_MUSIC_ALBUM));
+            album->setChildCount(i % 20 == 0 ? -1 : 12);
+            album->setMetadata(_("upnp:artist"), _("Simon & Garfunkel"));
+            page->append(RefCast(album, CdsObject));
+        } else {
+            Ref<CdsItem> track(new CdsItem());
+            track->setID(i + 100);
+            track->setParentID(10);
+            track->setTitle(_("Tr\xc3\xa4" "ck ") + i + " <remix>\x01");
+            track->setClass(_(UPNP_DEFAULT_CLASS_MUSIC_TRACK));
+            track->setMetadata(_("upnp:artist"), _("Bj\xc3\xb6rk \"Live\""));
+            track->setMetadata(_("upnp:album"), _("Homogenic"));
+            track->setMetadata(_("upnp:artist@role[AlbumArtist]"), _("Bj\xc3\xb6rk"));
+            track->setMetadata(_("upnp:originalTrackNumber"), String::from(i % 12));
+            track->setMetadata(_("dc:description"), _("a\tdescription\nover two lines"));
+            track->setMetadata(_("dc:date"), _(""));
+            page->append(RefCast(track, CdsObject));
+        }
+    }
+    filter = DIDLFilter::parse(_("dc:title,upnp:class,upnp:artist,upnp:album,upnp:originalTrackNumber,dc:description,dc:date,dc:creator"));
+}
+
+String DIDLWriterTest::renderTree(bool escaped)
+{
+    Ref<Element> didl(new Element(_("DIDL-Lite")));
+    didl->setAttribute(_(XML_NAMESPACE_ATTR), _(XML_DIDL_LITE_NAMESPACE));
+    didl->setAttribute(_(XML_DC_NAMESPACE_ATTR), _(XML_DC_NAMESPACE));
+    didl->setAttribute(_(XML_UPNP_NAMESPACE_ATTR), _(XML_UPNP_NAMESPACE));
+    for (int i = 0; i < page->size(); i++)
+        didl->appendElementChild(UpnpXML_DIDLRenderObject(page->get(i), false, -1, filter));
+    if (!escaped)
+        return didl->print();
+
+    Ref<Element> result(new Element(_("Result")));
+    result->setText(didl->print());
+    return result->print();
+}
+
+String DIDLWriterTest::renderWriter(bool escaped)
+{
+    Ref<DIDLWriter> writer(new DIDLWriter(escaped));
+    writer->startDIDL(false);
+    for (int i = 0; i < page->size(); i++)
+        writer->writeObject(page->get(i), -1, filter);
+    writer->endDIDL();
+    if (!escaped)
+        return writer->toString();
+
+    Ref<Element> result(new Element(_("Result")));
+    result->setText(writer->toString(), mxml_raw_type);
+    return result->print();
+}
+
+String DIDLWriterTest::renderCached(Ref<DIDLCache> cache)
+{
+    Ref<DIDLWriter> writer(new DIDLWriter(true));
+    unsigned long long generation = cache->getGeneration();
+    writer->startDIDL(false);
+    for (int i = 0; i < page->size(); i++) {
+        Ref<CdsObject> obj = page->get(i);
+        String fragment = cache->get(obj, "filter");
+        if (fragment != nullptr)
+            writer->writeCachedObject(obj, fragment, filter);
+        else
+            cache->put(obj, "filter", writer->writeObjectFragment(obj, -1, filter), generation);
+    }
+    writer->endDIDL();
+
+    Ref<Element> result(new Element(_("Result")));
+    result->setText(writer->toString(), mxml_raw_type);
+    return result->print();
+}
+
+TEST_F(DIDLWriterTest, SameOutputAsTree)
+{
+    EXPECT_EQ(renderTree(false), renderWriter(false));
+}
+
+TEST_F(DIDLWriterTest, SameOutputAsTreeEscaped)
+{
+    EXPECT_EQ(renderTree(true), renderWriter(true));
+}
+
+TEST_F(DIDLWriterTest, EmptyPage)
+{
+    page = Ref<Array<CdsObject>>(new Array<CdsObject>());
+    EXPECT_EQ(renderTree(true), renderWriter(true));
+}
+
+TEST_F(DIDLWriterTest, CachedFragments)
+{
+    Ref<DIDLCache> cache(new DIDLCache(16 * 1024 * 1024));
+    EXPECT_EQ(renderWriter(true), renderCached(cache));
+    EXPECT_EQ(0u, cache->getHits());
+    EXPECT_EQ(renderWriter(true), renderCached(cache));
+    EXPECT_EQ((unsigned long long)PAGE_SIZE, cache->getHits());
+
+    // an updated object is rendered again
+    page->get(1)->setTitle(_("Changed"));
+    cache->invalidate(page->get(1)->getID());
+    EXPECT_EQ(renderWriter(true), renderCached(cache));
+
+    // so is a container with another child count
+    RefCast(page->get(0), CdsContainer)->setChildCount(3);
+    EXPECT_EQ(renderWriter(true), renderCached(cache));
+}
+
+TEST_F(DIDLWriterTest, CachedFragmentsOfOlderGeneration)
+{
+    Ref<DIDLCache> cache(new DIDLCache(16 * 1024 * 1024));
+    unsigned long long generation = cache->getGeneration();
+    cache->invalidate(page->get(1)->getID());
+    cache->put(page->get(1), "filter", _("stale"), generation);
+    EXPECT_TRUE(cache->get(page->get(1), "filter") == nullptr);
+}
+
+TEST_F(DIDLWriterTest, CachedFragmentsOfReferences)
+{
+    Ref<DIDLCache> cache(new DIDLCache(16 * 1024 * 1024));
+    page->get(1)->setRefID(page->get(2)->getID());
+    renderCached(cache);
+    EXPECT_TRUE(cache->get(page->get(1), "filter") != nullptr);
+    cache->invalidate(page->get(2)->getID());
+    EXPECT_TRUE(cache->get(page->get(1), "filter") == nullptr);
+}
+
+TEST_F(DIDLWriterTest, Resources)
+{
+    Ref<Dictionary> audio(new Dictionary());
+    audio->put(_("protocolInfo"), _("http-get:*:audio/mpeg:DLNA.ORG_PN=MP3;DLNA.ORG_OP=01;DLNA.ORG_FLAGS=01700000000000000000000000000000"));
+    audio->put(_("size"), _("4711"));
+    audio->put(_("duration"), _("0:03:25.000"));
+    Ref<Dictionary> thumbnail(new Dictionary());
+    thumbnail->put(_("protocolInfo"), _("http-get:*:image/jpeg:*"));
+    thumbnail->put(_("resolution"), _("160x120"));
+    String url = _("http://10.0.0.1:49152/content/media/object_id/101/res_id/0/ext/file.mp3?a=1&b=\"2\"");
+
+    for (int escaped = 0; escaped < 2; escaped++) {
+        Ref<Element> didl(new Element(_("DIDL-Lite")));
+        didl->setAttribute(_(XML_NAMESPACE_ATTR), _(XML_DIDL_LITE_NAMESPACE));
+        didl->setAttribute(_(XML_DC_NAMESPACE_ATTR), _(XML_DC_NAMESPACE));
+        didl->setAttribute(_(XML_UPNP_NAMESPACE_ATTR), _(XML_UPNP_NAMESPACE));
+        didl->appendElementChild(UpnpXML_DIDLRenderResource(url, audio));
+        didl->appendElementChild(UpnpXML_DIDLRenderResource(url + "&thumb", thumbnail));
+
+        Ref<DIDLWriter> writer(new DIDLWriter(escaped));
+        writer->startDIDL(false);
+        writer->writeResource(url, audio);
+        writer->writeResource(url + "&thumb", thumbnail);
+        writer->endDIDL();
+
+        if (escaped) {
+            Ref<Element> result(new Element(_("Result")));
+            result->setText(didl->print());
+            Ref<Element> written(new Element(_("Result")));
+            written->setText(writer->toString(), mxml_raw_type);
+            EXPECT_EQ(result->print(), written->print());
+        } else
+            EXPECT_EQ(didl->print(), writer->toString());
+    }
+}
+
+TEST_F(DIDLWriterTest, ResourceProtocolInfo)
+{
+    Ref<Dictionary> attributes(new Dictionary());
+    attributes->put(_("protocolInfo"), _("http-get:*:video/mpeg:DLNA.ORG_PN=MPEG_PS_PAL;DLNA.ORG_OP=01"));
+    Ref<DIDLWriter> writer(new DIDLWriter(false));
+    writer->writeResource(_("http://host/a&b"), attributes);
+    EXPECT_STREQ("<res protocolInfo=\"http-get:*:video/mpeg:DLNA.ORG_PN=MPEG_PS_PAL;DLNA.ORG_OP=01\">http://host/a&amp;b</res>",
+        writer->toString().c_str());
+}
+
+TEST_F(DIDLWriterTest, ResourcesLeftOutByFilter)
+{
+    Ref<Dictionary> attributes(new Dictionary());
+    attributes->put(_("protocolInfo"), _("http-get:*:audio/mpeg:*"));
+    Ref<DIDLWriter> writer(new DIDLWriter(false));
+    String fragment = writer->writeObjectFragment(page->get(1), -1, filter);
+    writer->writeResource(_("http://host/track.mp3"), attributes);
+    EXPECT_TRUE(writer->toString().find("<res") < 0);
+    EXPECT_TRUE(fragment.find("<res") < 0);
+}
+
+// compares the time per page with the mxml tree, it is not part of the
+// normal run: testdidlwriter --gtest_also_run_disabled_tests
+TEST_F(DIDLWriterTest, DISABLED_Benchmark)
+{
+    String tree;
+    String writer;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++)
+        tree = renderTree(true);
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++)
+        writer = renderWriter(true);
+    auto end = std::chrono::steady_clock::now();
+
+    double treeMs = std::chrono::duration<double, std::milli>(middle - start).count() / BENCHMARK_ROUNDS;
+    double writerMs = std::chrono::duration<double, std::milli>(end - middle).count() / BENCHMARK_ROUNDS;
+    printf("%d objects: mxml tree %.2f ms, DIDLWriter %.2f ms per page\n",
+        PAGE_SIZE, treeMs, writerMs);
+    RecordProperty("tree_us", (int)(treeMs * 1000));
+    RecordProperty("writer_us", (int)(writerMs * 1000));
+    EXPECT_EQ(tree, writer);
+}
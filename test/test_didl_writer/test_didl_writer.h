@@ -0,0 +1,55 @@
+/*GRB*
+  Gerbera - https://gerbera.io/
+
+  test_didl_writer.h - this file is part of Gerbera.
+
+  Copyright (C) 2016-2018 Gerbera Contributors
+
+  Gerbera is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2
+  as published by the Free Software Foundation.
+
+  Gerbera is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Gerbera.  If not, see <http://www.gnu.org/licenses/>.
+
+  $Id$
+*/
+#ifndef __DIDL_WRITER_TEST_H__
+#define __DIDL_WRITER_TEST_H__
+
+#include "cds_objects.h"
+#include "didl_cache.h"
+#include "didl_filter.h"
+#include "gtest/gtest.h"
+
+class DIDLWriterTest : public ::testing::Test {
+protected:
+
+    inline DIDLWriterTest(){};
+
+    inline virtual ~DIDLWriterTest(){};
+
+    // Builds a page of albums and tracks with text that needs escaping.
+    virtual void SetUp();
+
+    inline virtual void TearDown() {};
+
+    // DIDL-Lite of the page as the mxml tree gives it
+    zmm::String renderTree(bool escaped);
+    // DIDL-Lite of the page as DIDLWriter gives it
+    zmm::String renderWriter(bool escaped);
+    // escaped DIDL-Lite of the page, the objects are taken from the cache
+    // when possible and added to it otherwise
+    zmm::String renderCached(zmm::Ref<DIDLCache> cache);
+
+    zmm::Ref<zmm::Array<CdsObject> > page;
+    // leaves out the resources and the album art, which need a running server
+    zmm::Ref<DIDLFilter> filter;
+};
+
+#endif // __DIDL_WRITER_TEST_H__